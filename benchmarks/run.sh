@@ -0,0 +1,26 @@
+#!/bin/bash
+# usage: benchmarks/run.sh [path/to/compiler]
+# runs every benchmark in interpreter mode with each engine and prints the wall clock times
+
+COMPILER=${1:-./build/compiler}
+DIR=$(dirname "$0")
+
+milliseconds() {
+    local start=$(date +%s%N)
+    "$@" > /dev/null
+    local end=$(date +%s%N)
+    echo $(((end - start) / 1000000))
+}
+
+speedup() {
+    awk "BEGIN { print $1 / ($2 > 0 ? $2 : 1) }"
+}
+
+printf "%-12s %10s %10s %13s %10s %8s %8s %8s\n" "benchmark" "tree (ms)" "vm (ms)" "closure (ms)" "jit (ms)" "vm" "closure" "jit"
+for file in "$DIR"/*.bird; do
+    tree=$(milliseconds "$COMPILER" -i "$file")
+    vm=$(milliseconds "$COMPILER" -i "$file" --engine=vm)
+    closure=$(milliseconds "$COMPILER" -i "$file" --engine=closure)
+    jit=$(milliseconds "$COMPILER" -i "$file" --jit)
+    printf "%-12s %10d %10d %13d %10d %7.1fx %7.1fx %7.1fx\n" "$(basename "$file" .bird)" "$tree" "$vm" "$closure" "$jit" "$(speedup $tree $vm)" "$(speedup $tree $closure)" "$(speedup $tree $jit)"
+done
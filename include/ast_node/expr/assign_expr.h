@@ -5,6 +5,7 @@
 #include "expr.h"
 #include "lexer.h"
 #include "visitors/visitor.h"
+#include "quickened.h"
 
 /*
  * Assignment statement AST Node that represents variable assignments
@@ -18,6 +19,8 @@ public:
     Token identifier;
     Token assign_operator;
     std::unique_ptr<Expr> value;
+    int slot = -1;                            // set by the slot resolver, -1 when the identifier is looked up by name
+    Quickened quickened = Quickened::NOT_YET; // set by the interpreter
 
     AssignExpr(Token identifier, Token assign_operator, std::unique_ptr<Expr> value)
     {
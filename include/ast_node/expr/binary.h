@@ -5,6 +5,7 @@
 #include "lexer.h"
 #include "visitors/visitor.h"
 #include "expr.h"
+#include "quickened.h"
 
 /*
  *
@@ -20,6 +21,13 @@ public:
     Token op;
     std::unique_ptr<Expr> right;
 
+    // set by the range analyzer
+    bool int_operands = false;          // both operands are always ints
+    bool nonzero_divisor = false;       // the right operand is never zero
+    bool non_negative_operands = false; // both operands are never negative
+
+    Quickened quickened = Quickened::NOT_YET; // set by the interpreter
+
     Binary(std::unique_ptr<Expr> left, Token op, std::unique_ptr<Expr> right)
     {
         this->left = std::move(left);
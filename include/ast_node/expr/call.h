@@ -10,6 +10,7 @@
 // forward declaration
 class Visitor;
 class Expr;
+class Callable;
 
 /*
  * Interface:
@@ -22,6 +23,11 @@ class Call : public Expr
 public:
     Token identifier;
     std::vector<std::shared_ptr<Expr>> args;
+    bool arguments_checked = false; // set by the type checker when every argument has the exact type of its parameter
+
+    // inline cache of the interpreter, valid while its call table still has this version
+    Callable *callee = nullptr;
+    unsigned int callee_version = 0;
 
     Call(Token identifier,
          std::vector<std::shared_ptr<Expr>> args)
@@ -14,6 +14,7 @@ class Primary : public Expr
 {
 public:
     Token value; // must be i32 literal
+    int slot = -1; // set by the slot resolver, -1 when the identifier is looked up by name
     Primary(Token value)
     {
         this->value = value;
@@ -4,6 +4,7 @@
 #include "lexer.h"
 #include "visitors/visitor.h"
 #include "expr.h"
+#include "quickened.h"
 
 /*
  * Unary class AST node representing unary operations
@@ -16,6 +17,7 @@ class Unary : public Expr
 public:
     Token op; // must be of type -
     std::unique_ptr<Expr> expr;
+    Quickened quickened = Quickened::NOT_YET; // set by the interpreter
 
     Unary(Token op, std::unique_ptr<Expr> expr)
     {
@@ -23,6 +23,7 @@ public:
     std::optional<Token> type_token;
     bool type_is_literal;
     std::unique_ptr<Expr> value;
+    int slot = -1; // set by the slot resolver, -1 when the variable is declared by name
 
     DeclStmt(Token identifier, std::optional<Token> type_token, bool type_is_literal, std::unique_ptr<Expr> value)
     {
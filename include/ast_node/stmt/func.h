@@ -27,6 +27,8 @@ public:
     // the first item in the pair is an identifier, the second is a type
     std::vector<std::pair<Token, Token>> param_list; // TODO: make this an actual type
     std::shared_ptr<Stmt> block;
+    bool is_pure = false; // set by the effect analyzer
+    int frame_size = -1;  // set by the slot resolver, -1 when the variables are looked up by name
 
     Func(Token identifier,
          std::optional<Token> return_type,
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <functional>
+
+/*
+ * The text of a string Value, immutable and shared by every Value that holds it.
+ *
+ * Values count their references so copying a string is a pointer copy. The hash
+ * is computed the first time it is needed and kept. Literals are interned, the
+ * table keeps one reference to each so they are never freed, and two interned
+ * strings are equal only when they are the same object.
+ *
+ * A string with a single reference is not shared yet, appending to it grows its
+ * text in place like a string builder, so concatenation loops stay linear.
+ */
+class BirdString
+{
+public:
+    std::string text;
+    int references = 1;
+    bool interned = false;
+
+    BirdString(std::string text) : text(std::move(text)) {}
+
+    size_t hash() const
+    {
+        if (!this->hashed)
+        {
+            this->cached_hash = std::hash<std::string>()(this->text);
+            this->hashed = true;
+        }
+
+        return this->cached_hash;
+    }
+
+    void append(const std::string &suffix)
+    {
+        this->text += suffix;
+        this->hashed = false;
+    }
+
+    bool equals(const BirdString *other) const
+    {
+        if (this == other)
+        {
+            return true;
+        }
+
+        if ((this->interned && other->interned) || this->text.size() != other->text.size() || this->hash() != other->hash())
+        {
+            return false;
+        }
+
+        return this->text == other->text;
+    }
+
+    /*
+     * The one shared copy of `text`
+     */
+    static BirdString *intern(const std::string &text)
+    {
+        auto &table = BirdString::table();
+
+        auto found = table.find(text);
+        if (found != table.end())
+        {
+            return found->second;
+        }
+
+        auto string = new BirdString(text);
+        string->interned = true;
+        table[string->text] = string;
+
+        return string;
+    }
+
+private:
+    mutable size_t cached_hash = 0;
+    mutable bool hashed = false;
+
+    static std::unordered_map<std::string_view, BirdString *> &table()
+    {
+        static std::unordered_map<std::string_view, BirdString *> table;
+        return table;
+    }
+};
@@ -3,7 +3,8 @@
 #include <vector>
 
 /*
- * Enum for the types of the language, used for type checking
+ * Enum for the types of the language, used for type checking,
+ * the first four are in the order of Value::index
  */
 enum class BirdType
 {
@@ -5,17 +5,32 @@
 #include <optional>
 
 #include "lexer.h"
+#include "memo_cache.h"
+#include "bird_type.h"
 
 class Stmt;
 class Expr;
 class Interpreter;
+class JitFunction;
 
 class Callable
 {
 public:
+    std::string name;
     std::vector<std::pair<Token, Token>> param_list;
     std::shared_ptr<Stmt> block;
     std::optional<Token> return_type;
+    std::shared_ptr<MemoCache> memo; // set when calls to a pure function are memoized
+    int frame_size = -1;             // slots of a call frame, -1 when the variables are looked up by name
+
+    // resolved when the function is declared, aliases included, ERROR for a parameter that is not checked
+    std::vector<BirdType> param_types;
+    BirdType resolved_return_type = BirdType::VOID;
+
+    // calls and loop iterations run so far, the JIT compiles the function once it is hot
+    long hotness = 0;
+    std::shared_ptr<JitFunction> native;
+    bool jit_failed = false;
 
     Callable(
         std::vector<std::pair<Token, Token>> param_list,
@@ -25,13 +40,24 @@ public:
           block(std::move(block)),
           return_type(return_type) {}
     Callable() = default;
-    Callable(const Callable &other) : param_list(other.param_list),
+    Callable(const Callable &other) : name(other.name),
+                                      param_list(other.param_list),
                                       block(std::move(other.block)),
-                                      return_type(other.return_type)
+                                      return_type(other.return_type),
+                                      memo(other.memo),
+                                      frame_size(other.frame_size),
+                                      param_types(other.param_types),
+                                      resolved_return_type(other.resolved_return_type),
+                                      hotness(other.hotness),
+                                      native(other.native),
+                                      jit_failed(other.jit_failed)
     {
     }
 
-    void call(Interpreter *Interpreter, std::vector<std::shared_ptr<Expr>>);
+    void call(Interpreter *Interpreter, const std::vector<std::shared_ptr<Expr>> &, bool arguments_checked = false);
+
+    // whether the arguments have the types the compiled code takes
+    bool native_arguments(const Value *args, int count);
 };
 
 struct SemanticCallable
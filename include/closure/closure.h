@@ -0,0 +1,199 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+#include "value.h"
+#include "visitors/interpreter.h"
+#include "exceptions/bird_exception.h"
+
+struct ClosureRuntime;
+
+/*
+ * A binary operator on two ints or two floats, computed in place
+ */
+template <Token::Type op, typename T>
+inline Value compute(T left, T right)
+{
+    if constexpr (op == Token::Type::PLUS)
+        return Value(left + right);
+    else if constexpr (op == Token::Type::MINUS)
+        return Value(left - right);
+    else if constexpr (op == Token::Type::STAR)
+        return Value(left * right);
+    else if constexpr (op == Token::Type::SLASH)
+    {
+        if (right == 0)
+            throw BirdException("Division by zero.");
+
+        return Value(left / right);
+    }
+    else if constexpr (op == Token::Type::PERCENT)
+    {
+        if (right == 0)
+            throw BirdException("Modulo by zero.");
+
+        return Value(left % right);
+    }
+    else if constexpr (op == Token::Type::LESS)
+        return Value(left < right);
+    else if constexpr (op == Token::Type::LESS_EQUAL)
+        return Value(left <= right);
+    else if constexpr (op == Token::Type::GREATER)
+        return Value(left > right);
+    else if constexpr (op == Token::Type::GREATER_EQUAL)
+        return Value(left >= right);
+    else if constexpr (op == Token::Type::EQUAL_EQUAL)
+        return Value(left == right);
+    else
+        return Value(left != right);
+}
+
+/*
+ * A binary operator on any values, two ints or two floats are computed in place and
+ * everything else goes through the Value operators, so errors and results match the
+ * tree walking interpreter
+ */
+template <Token::Type op>
+inline Value apply(const Value &left, const Value &right)
+{
+    if (left.is_int() && right.is_int())
+        return compute<op, int>(left.as_int(), right.as_int());
+
+    if constexpr (op != Token::Type::PERCENT)
+    {
+        if (left.is_double() && right.is_double())
+            return compute<op, double>(left.as_double(), right.as_double());
+    }
+
+    if constexpr (op == Token::Type::PLUS)
+        return left + right;
+    else if constexpr (op == Token::Type::MINUS)
+        return left - right;
+    else if constexpr (op == Token::Type::STAR)
+        return left * right;
+    else if constexpr (op == Token::Type::SLASH)
+        return left / right;
+    else if constexpr (op == Token::Type::PERCENT)
+        return left % right;
+    else if constexpr (op == Token::Type::LESS)
+        return left < right;
+    else if constexpr (op == Token::Type::LESS_EQUAL)
+        return left <= right;
+    else if constexpr (op == Token::Type::GREATER)
+        return left > right;
+    else if constexpr (op == Token::Type::GREATER_EQUAL)
+        return left >= right;
+    else if constexpr (op == Token::Type::EQUAL_EQUAL)
+        return left == right;
+    else
+        return left != right;
+}
+
+// a compiled expression returns its value, a compiled statement how it finished
+using ExprClosure = std::function<Value(ClosureRuntime &)>;
+using StmtClosure = std::function<Completion(ClosureRuntime &)>;
+
+/*
+ * A compiled function, its parameters are the first slots of its frame.
+ * Top level statements are compiled into a function named main
+ */
+struct ClosureFunction
+{
+    std::string name;
+    std::vector<int> param_tags; // the Value alternative each parameter must hold, -1 when unchecked
+    int frame_size = 0;
+    StmtClosure body;
+
+    ClosureFunction(std::string name) : name(name) {}
+};
+
+/*
+ * Functions are never moved once compiled, calls point straight at them
+ */
+struct ClosureProgram
+{
+    std::vector<std::unique_ptr<ClosureFunction>> functions;
+    ClosureFunction *main = nullptr;
+
+    ClosureFunction *get(std::string name)
+    {
+        for (auto &function : this->functions)
+        {
+            if (function->name == name)
+            {
+                return function.get();
+            }
+        }
+
+        return nullptr;
+    }
+};
+
+/*
+ * The state a closure program runs with.
+ *
+ * Frames are windows into one slot file that grows with the calls, the frame of
+ * main starts at 0 so globals are plain indexes. `frame` points at the slots of
+ * the running call and is reloaded whenever the slot file may have moved, so
+ * closures never keep a reference to a slot across a call.
+ */
+struct ClosureRuntime
+{
+    std::vector<Value> slots;
+    Value *frame = nullptr;
+    int base = 0; // the first slot of the running call
+    int top = 0;  // the first free slot
+    Value result; // the value of the last return
+
+    void run(ClosureProgram *program)
+    {
+        this->slots.assign(std::max(program->main->frame_size, 1024), Value(0));
+        this->base = 0;
+        this->top = program->main->frame_size;
+        this->frame = this->slots.data();
+
+        program->main->body(*this);
+    }
+
+    /*
+     * Runs a call whose frame was pushed at `base` with the arguments in its
+     * first slots, and pops the frame
+     */
+    Value call(ClosureFunction *function, int base)
+    {
+        auto caller_base = this->base;
+
+        this->base = base;
+        this->frame = this->slots.data() + base;
+        this->result = Value();
+
+        function->body(*this);
+
+        this->base = caller_base;
+        this->top = base;
+        this->frame = this->slots.data() + caller_base;
+
+        return std::move(this->result);
+    }
+
+    /*
+     * Takes the slots of a new frame above everything that is live
+     */
+    int push_frame(int size)
+    {
+        auto base = this->top;
+        this->top += size;
+
+        if (this->slots.size() < this->top)
+        {
+            this->slots.resize(std::max((size_t)this->top, this->slots.size() * 2));
+            this->frame = this->slots.data() + this->base;
+        }
+
+        return base;
+    }
+};
@@ -0,0 +1,839 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <optional>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <iostream>
+
+#include "ast_node/index.h"
+#include "sym_table.h"
+#include "closure/closure.h"
+
+/*
+ * Thrown while compiling a construct the closure engine does not support
+ */
+struct ClosureUnsupported
+{
+    std::string reason;
+
+    ClosureUnsupported(std::string reason) : reason(reason) {}
+};
+
+// operands a binary closure reads without calling another closure
+struct SlotOperand
+{
+    int slot;
+
+    Value get(ClosureRuntime &runtime) const { return runtime.frame[this->slot]; }
+};
+
+struct ConstantOperand
+{
+    Value value;
+
+    const Value &get(ClosureRuntime &runtime) const { return this->value; }
+};
+
+struct ClosureOperand
+{
+    ExprClosure closure;
+
+    Value get(ClosureRuntime &runtime) const { return this->closure(runtime); }
+};
+
+// the variable an assignment writes, looked up again after its value is evaluated
+struct LocalVariable
+{
+    int slot;
+
+    Value &get(ClosureRuntime &runtime) const { return runtime.frame[this->slot]; }
+};
+
+struct GlobalVariable
+{
+    int slot;
+
+    Value &get(ClosureRuntime &runtime) const { return runtime.slots[this->slot]; }
+};
+
+/*
+ * Visitor that compiles a type checked AST into a tree of closures, runs last.
+ *
+ * Every node is turned into a closure once, with its variables resolved to slots
+ * and its operator picked when it is compiled, so running the program never goes
+ * through accept, the value stack or a lookup by name. Binary operators read
+ * local variables and literals directly instead of calling a closure for them.
+ *
+ * Variables are resolved like the bytecode compiler does: every variable gets the
+ * next free slot of its function when it is declared and gives it back at the end
+ * of its block. Functions can read their own variables and the ones of the top level
+ * code, a function reading the variables of a function it is nested in is rejected
+ * and `unsupported` says why.
+ */
+class ClosureCompiler : public Visitor
+{
+public:
+    ClosureProgram program;
+    std::string unsupported;
+
+    std::map<std::string, ClosureFunction *> functions;
+    Environment<std::string> type_table; // alias -> primitive type
+
+    /*
+     * The state of a function while its body is compiled
+     */
+    struct FunctionState
+    {
+        ClosureFunction *function = nullptr;
+        Environment<int> variables; // name -> slot
+        int top = 0;                // the first free slot
+    };
+
+    FunctionState state;
+    std::vector<FunctionState> enclosing;
+
+    // the closure of the node visited last
+    ExprClosure expr_result;
+    StmtClosure stmt_result;
+
+    ClosureCompiler()
+    {
+        this->type_table.push_env();
+    }
+
+    bool compile(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        try
+        {
+            this->program.main = this->begin_function("main");
+
+            std::vector<StmtClosure> closures;
+            for (auto &stmt : *stmts)
+            {
+                closures.push_back(this->lower_stmt(stmt.get()));
+            }
+
+            this->program.main->body = this->sequence(std::move(closures));
+        }
+        catch (ClosureUnsupported &error)
+        {
+            this->unsupported = error.reason;
+            return false;
+        }
+
+        return true;
+    }
+
+    ClosureFunction *begin_function(std::string name)
+    {
+        this->program.functions.push_back(std::make_unique<ClosureFunction>(name));
+
+        this->state = FunctionState();
+        this->state.function = this->program.functions.back().get();
+        this->state.variables.push_env();
+
+        return this->state.function;
+    }
+
+    ExprClosure lower_expr(Expr *expr)
+    {
+        expr->accept(this);
+        return std::move(this->expr_result);
+    }
+
+    StmtClosure lower_stmt(Stmt *stmt)
+    {
+        stmt->accept(this);
+        return std::move(this->stmt_result);
+    }
+
+    /*
+     * Runs statements in order until one does not finish normally
+     */
+    StmtClosure sequence(std::vector<StmtClosure> stmts)
+    {
+        return [stmts](ClosureRuntime &runtime)
+        {
+            for (auto &stmt : stmts)
+            {
+                auto completion = stmt(runtime);
+                if (completion != Completion::NORMAL)
+                {
+                    return completion;
+                }
+            }
+
+            return Completion::NORMAL;
+        };
+    }
+
+    int allocate()
+    {
+        auto slot = this->state.top++;
+        this->state.function->frame_size = std::max(this->state.function->frame_size, this->state.top);
+
+        return slot;
+    }
+
+    void declare(std::string name, int slot)
+    {
+        if (this->state.variables.current_contains(name))
+        {
+            this->state.variables.envs.back()[name] = slot;
+        }
+        else
+        {
+            this->state.variables.declare(name, slot);
+        }
+    }
+
+    /*
+     * The slot of a variable of the function being compiled,
+     * or -1 when it belongs to the top level code
+     */
+    int local(Token identifier)
+    {
+        if (this->state.variables.contains(identifier.lexeme))
+        {
+            return this->state.variables.get(identifier.lexeme);
+        }
+
+        return -1;
+    }
+
+    int global(Token identifier)
+    {
+        for (int i = 1; i < this->enclosing.size(); i++)
+        {
+            if (this->enclosing[i].variables.contains(identifier.lexeme))
+            {
+                throw ClosureUnsupported(this->state.function->name + " uses " + identifier.lexeme + " of the function it is nested in");
+            }
+        }
+
+        if (this->enclosing.empty() || !this->enclosing[0].variables.contains(identifier.lexeme))
+        {
+            throw ClosureUnsupported(this->state.function->name + " uses " + identifier.lexeme + " which is not declared before it");
+        }
+
+        return this->enclosing[0].variables.get(identifier.lexeme);
+    }
+
+    /*
+     * The Value alternative of a primitive type, -1 for other types
+     */
+    int tag(std::string type)
+    {
+        if (type == "int")
+            return 0;
+        if (type == "float")
+            return 1;
+        if (type == "str")
+            return 2;
+        if (type == "bool")
+            return 3;
+
+        return -1;
+    }
+
+    std::string primitive_type(Token type_token, bool type_is_literal)
+    {
+        if (type_is_literal || !this->type_table.contains(type_token.lexeme))
+        {
+            return type_token.lexeme;
+        }
+
+        return this->type_table.get(type_token.lexeme);
+    }
+
+    /*
+     * The value of a literal, nothing for other expressions
+     */
+    std::optional<Value> literal(Expr *expr)
+    {
+        auto primary = dynamic_cast<Primary *>(expr);
+        if (!primary)
+        {
+            return std::nullopt;
+        }
+
+        switch (primary->value.token_type)
+        {
+        case Token::Type::INT_LITERAL:
+            return Value(std::stoi(primary->value.lexeme));
+        case Token::Type::FLOAT_LITERAL:
+            return Value(std::stod(primary->value.lexeme));
+        case Token::Type::BOOL_LITERAL:
+            return Value(primary->value.lexeme == "true");
+        case Token::Type::STR_LITERAL:
+            return Value::intern(primary->value.lexeme);
+        default:
+            return std::nullopt;
+        }
+    }
+
+    /*
+     * The slot of an expression that reads a variable of the function being compiled, -1 otherwise
+     */
+    int local_read(Expr *expr)
+    {
+        auto primary = dynamic_cast<Primary *>(expr);
+        if (!primary || primary->value.token_type != Token::Type::IDENTIFIER)
+        {
+            return -1;
+        }
+
+        return this->local(primary->value);
+    }
+
+    /*
+     * Declarations convert between int and float like the interpreter does
+     */
+    StmtClosure declaration(int slot, ExprClosure value, std::optional<Token> type_token, bool type_is_literal)
+    {
+        auto type = type_token.has_value() ? this->primitive_type(type_token.value(), type_is_literal) : "";
+
+        if (type == "int")
+        {
+            return [slot, value](ClosureRuntime &runtime)
+            {
+                auto result = value(runtime);
+                runtime.frame[slot] = result.is_double() ? Value((int)result.as_double()) : std::move(result);
+                return Completion::NORMAL;
+            };
+        }
+
+        if (type == "float")
+        {
+            return [slot, value](ClosureRuntime &runtime)
+            {
+                auto result = value(runtime);
+                runtime.frame[slot] = result.is_int() ? Value((double)result.as_int()) : std::move(result);
+                return Completion::NORMAL;
+            };
+        }
+
+        return [slot, value](ClosureRuntime &runtime)
+        {
+            runtime.frame[slot] = value(runtime);
+            return Completion::NORMAL;
+        };
+    }
+
+    /*
+     * Binary closures specialized for where their operands come from
+     */
+    template <Token::Type op, typename Left, typename Right>
+    ExprClosure binary(Left left, Right right)
+    {
+        return [left, right](ClosureRuntime &runtime)
+        {
+            auto &&left_value = left.get(runtime);
+            auto &&right_value = right.get(runtime);
+
+            return apply<op>(left_value, right_value);
+        };
+    }
+
+    template <Token::Type op, typename Left>
+    ExprClosure binary(Left left, Expr *right)
+    {
+        auto slot = this->local_read(right);
+        if (slot >= 0)
+        {
+            return this->binary<op>(left, SlotOperand{slot});
+        }
+
+        auto value = this->literal(right);
+        if (value.has_value())
+        {
+            return this->binary<op>(left, ConstantOperand{value.value()});
+        }
+
+        return this->binary<op>(left, ClosureOperand{this->lower_expr(right)});
+    }
+
+    template <Token::Type op>
+    ExprClosure binary(Binary *binary)
+    {
+        // a variable on the left is copied before the right side runs, which may assign it
+        auto slot = this->local_read(binary->left.get());
+        if (slot >= 0)
+        {
+            return this->binary<op>(SlotOperand{slot}, binary->right.get());
+        }
+
+        return this->binary<op>(ClosureOperand{this->lower_expr(binary->left.get())}, binary->right.get());
+    }
+
+    /*
+     * A compound assignment, the variable is read before the value is evaluated
+     * like the interpreter does
+     */
+    template <Token::Type op, typename Variable>
+    ExprClosure compound(Variable variable, ExprClosure value)
+    {
+        return [variable, value](ClosureRuntime &runtime)
+        {
+            auto previous = variable.get(runtime);
+            auto right = value(runtime);
+
+            if constexpr (op == Token::Type::PLUS)
+            {
+                if (previous.is_string() && right.is_string() && variable.get(runtime).bits == previous.bits)
+                {
+                    // drop this copy so the variable may hold the only reference and grow in place
+                    previous = Value();
+                    variable.get(runtime).append(right);
+                    return Value();
+                }
+            }
+
+            variable.get(runtime) = apply<op>(previous, right);
+            return Value();
+        };
+    }
+
+    template <typename Variable>
+    ExprClosure assignment(Variable variable, Token assign_operator, ExprClosure value)
+    {
+        switch (assign_operator.token_type)
+        {
+        case Token::Type::EQUAL:
+            return [variable, value](ClosureRuntime &runtime)
+            {
+                auto result = value(runtime);
+                variable.get(runtime) = std::move(result);
+                return Value();
+            };
+        case Token::Type::PLUS_EQUAL:
+            return this->compound<Token::Type::PLUS>(variable, value);
+        case Token::Type::MINUS_EQUAL:
+            return this->compound<Token::Type::MINUS>(variable, value);
+        case Token::Type::STAR_EQUAL:
+            return this->compound<Token::Type::STAR>(variable, value);
+        case Token::Type::SLASH_EQUAL:
+            return this->compound<Token::Type::SLASH>(variable, value);
+        case Token::Type::PERCENT_EQUAL:
+            return this->compound<Token::Type::PERCENT>(variable, value);
+        default:
+            throw BirdException("Unidentified assignment operator " + assign_operator.lexeme);
+        }
+    }
+
+    void visit_block(Block *block)
+    {
+        auto top = this->state.top;
+        this->state.variables.push_env();
+
+        std::vector<StmtClosure> stmts;
+        for (auto &stmt : block->stmts)
+        {
+            stmts.push_back(this->lower_stmt(stmt.get()));
+        }
+
+        this->state.variables.pop_env();
+        this->state.top = top;
+
+        this->stmt_result = this->sequence(std::move(stmts));
+    }
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        auto value = this->lower_expr(decl_stmt->value.get());
+        auto slot = this->allocate();
+
+        this->declare(decl_stmt->identifier.lexeme, slot);
+        this->stmt_result = this->declaration(slot, std::move(value), decl_stmt->type_token, decl_stmt->type_is_literal);
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        auto value = this->lower_expr(const_stmt->value.get());
+        auto slot = this->allocate();
+
+        this->declare(const_stmt->identifier.lexeme, slot);
+        this->stmt_result = this->declaration(slot, std::move(value), const_stmt->type_token, const_stmt->type_is_literal);
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        auto value = this->lower_expr(assign_expr->value.get());
+
+        auto slot = this->local(assign_expr->identifier);
+        if (slot >= 0)
+        {
+            this->expr_result = this->assignment(LocalVariable{slot}, assign_expr->assign_operator, std::move(value));
+            return;
+        }
+
+        auto global = this->global(assign_expr->identifier);
+        this->expr_result = this->assignment(GlobalVariable{global}, assign_expr->assign_operator, std::move(value));
+    }
+
+    void visit_expr_stmt(ExprStmt *expr_stmt)
+    {
+        auto expr = this->lower_expr(expr_stmt->expr.get());
+
+        this->stmt_result = [expr](ClosureRuntime &runtime)
+        {
+            expr(runtime);
+            return Completion::NORMAL;
+        };
+    }
+
+    void visit_print_stmt(PrintStmt *print_stmt)
+    {
+        std::vector<ExprClosure> args;
+        for (auto &arg : print_stmt->args)
+        {
+            args.push_back(this->lower_expr(arg.get()));
+        }
+
+        this->stmt_result = [args](ClosureRuntime &runtime)
+        {
+            for (auto &arg : args)
+            {
+                std::cout << arg(runtime);
+            }
+            std::cout << std::endl;
+
+            return Completion::NORMAL;
+        };
+    }
+
+    void visit_if_stmt(IfStmt *if_stmt)
+    {
+        auto condition = this->lower_expr(if_stmt->condition.get());
+        auto then_branch = this->lower_stmt(if_stmt->then_branch.get());
+
+        if (!if_stmt->else_branch.has_value())
+        {
+            this->stmt_result = [condition, then_branch](ClosureRuntime &runtime)
+            {
+                return as_type<bool>(condition(runtime)) ? then_branch(runtime) : Completion::NORMAL;
+            };
+            return;
+        }
+
+        auto else_branch = this->lower_stmt(if_stmt->else_branch.value().get());
+        this->stmt_result = [condition, then_branch, else_branch](ClosureRuntime &runtime)
+        {
+            return as_type<bool>(condition(runtime)) ? then_branch(runtime) : else_branch(runtime);
+        };
+    }
+
+    void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        auto condition = this->lower_expr(while_stmt->condition.get());
+        auto body = this->lower_stmt(while_stmt->stmt.get());
+
+        this->stmt_result = [condition, body](ClosureRuntime &runtime)
+        {
+            while (as_type<bool>(condition(runtime)))
+            {
+                auto completion = body(runtime);
+
+                if (completion == Completion::BREAK)
+                    break;
+
+                if (completion == Completion::RETURN)
+                    return completion;
+            }
+
+            return Completion::NORMAL;
+        };
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        auto top = this->state.top;
+        this->state.variables.push_env();
+
+        std::optional<StmtClosure> initializer;
+        if (for_stmt->initializer.has_value())
+        {
+            initializer = this->lower_stmt(for_stmt->initializer.value().get());
+        }
+
+        std::optional<ExprClosure> condition;
+        if (for_stmt->condition.has_value())
+        {
+            condition = this->lower_expr(for_stmt->condition.value().get());
+        }
+
+        std::optional<ExprClosure> increment;
+        if (for_stmt->increment.has_value())
+        {
+            increment = this->lower_expr(for_stmt->increment.value().get());
+        }
+
+        auto body = this->lower_stmt(for_stmt->body.get());
+
+        this->state.variables.pop_env();
+        this->state.top = top;
+
+        this->stmt_result = [initializer, condition, increment, body](ClosureRuntime &runtime)
+        {
+            if (initializer.has_value())
+            {
+                initializer.value()(runtime);
+            }
+
+            while (!condition.has_value() || as_type<bool>(condition.value()(runtime)))
+            {
+                auto completion = body(runtime);
+
+                if (completion == Completion::BREAK)
+                    break;
+
+                if (completion == Completion::RETURN)
+                    return completion;
+
+                if (increment.has_value())
+                {
+                    increment.value()(runtime);
+                }
+            }
+
+            return Completion::NORMAL;
+        };
+    }
+
+    void visit_binary(Binary *binary)
+    {
+        switch (binary->op.token_type)
+        {
+        case Token::Type::PLUS:
+            this->expr_result = this->binary<Token::Type::PLUS>(binary);
+            break;
+        case Token::Type::MINUS:
+            this->expr_result = this->binary<Token::Type::MINUS>(binary);
+            break;
+        case Token::Type::STAR:
+            this->expr_result = this->binary<Token::Type::STAR>(binary);
+            break;
+        case Token::Type::SLASH:
+            this->expr_result = this->binary<Token::Type::SLASH>(binary);
+            break;
+        case Token::Type::PERCENT:
+            this->expr_result = this->binary<Token::Type::PERCENT>(binary);
+            break;
+        case Token::Type::LESS:
+            this->expr_result = this->binary<Token::Type::LESS>(binary);
+            break;
+        case Token::Type::LESS_EQUAL:
+            this->expr_result = this->binary<Token::Type::LESS_EQUAL>(binary);
+            break;
+        case Token::Type::GREATER:
+            this->expr_result = this->binary<Token::Type::GREATER>(binary);
+            break;
+        case Token::Type::GREATER_EQUAL:
+            this->expr_result = this->binary<Token::Type::GREATER_EQUAL>(binary);
+            break;
+        case Token::Type::EQUAL_EQUAL:
+            this->expr_result = this->binary<Token::Type::EQUAL_EQUAL>(binary);
+            break;
+        case Token::Type::BANG_EQUAL:
+            this->expr_result = this->binary<Token::Type::BANG_EQUAL>(binary);
+            break;
+        default:
+            throw BirdException("undefined binary operator " + binary->op.lexeme);
+        }
+    }
+
+    void visit_unary(Unary *unary)
+    {
+        auto expr = this->lower_expr(unary->expr.get());
+
+        this->expr_result = [expr](ClosureRuntime &runtime)
+        {
+            auto value = expr(runtime);
+
+            if (value.is_int())
+                return Value(-value.as_int());
+
+            if (value.is_double())
+                return Value(-value.as_double());
+
+            return -value;
+        };
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        auto value = this->literal(primary);
+        if (value.has_value())
+        {
+            this->expr_result = [value = value.value()](ClosureRuntime &runtime)
+            {
+                return value;
+            };
+            return;
+        }
+
+        if (primary->value.token_type != Token::Type::IDENTIFIER)
+        {
+            throw BirdException("undefined primary value: " + primary->value.lexeme);
+        }
+
+        auto slot = this->local(primary->value);
+        if (slot >= 0)
+        {
+            this->expr_result = [slot](ClosureRuntime &runtime)
+            {
+                return runtime.frame[slot];
+            };
+            return;
+        }
+
+        auto global = this->global(primary->value);
+        this->expr_result = [global](ClosureRuntime &runtime)
+        {
+            return runtime.slots[global];
+        };
+    }
+
+    void visit_ternary(Ternary *ternary)
+    {
+        auto condition = this->lower_expr(ternary->condition.get());
+        auto true_expr = this->lower_expr(ternary->true_expr.get());
+        auto false_expr = this->lower_expr(ternary->false_expr.get());
+
+        this->expr_result = [condition, true_expr, false_expr](ClosureRuntime &runtime)
+        {
+            return as_type<bool>(condition(runtime)) ? true_expr(runtime) : false_expr(runtime);
+        };
+    }
+
+    void visit_func(Func *func)
+    {
+        auto name = func->identifier.lexeme;
+
+        this->enclosing.push_back(std::move(this->state));
+        auto function = this->begin_function(name);
+        this->functions[name] = function;
+
+        for (auto &param : func->param_list)
+        {
+            function->param_tags.push_back(this->tag(this->primitive_type(param.second, false)));
+            this->declare(param.first.lexeme, this->allocate());
+        }
+
+        std::vector<StmtClosure> stmts;
+        for (auto &stmt : dynamic_cast<Block *>(func->block.get())->stmts)
+        {
+            stmts.push_back(this->lower_stmt(stmt.get()));
+        }
+
+        function->body = this->sequence(std::move(stmts));
+
+        this->state = std::move(this->enclosing.back());
+        this->enclosing.pop_back();
+
+        // the function is compiled already, declaring it does nothing at run time
+        this->stmt_result = [](ClosureRuntime &runtime)
+        {
+            return Completion::NORMAL;
+        };
+    }
+
+    void visit_call(Call *call)
+    {
+        auto found = this->functions.find(call->identifier.lexeme);
+        if (found == this->functions.end())
+        {
+            throw ClosureUnsupported("call to " + call->identifier.lexeme + " before it is declared");
+        }
+
+        auto function = found->second;
+        auto arguments_checked = call->arguments_checked;
+
+        std::vector<ExprClosure> args;
+        for (auto &arg : call->args)
+        {
+            args.push_back(this->lower_expr(arg.get()));
+        }
+
+        this->expr_result = [function, arguments_checked, args](ClosureRuntime &runtime)
+        {
+            // the arguments go straight into the slots of the new frame, calls made while evaluating them get frames above it
+            auto base = runtime.push_frame(std::max(function->frame_size, (int)args.size()));
+            for (int i = 0; i < args.size(); i++)
+            {
+                auto value = args[i](runtime);
+                runtime.slots[base + i] = std::move(value);
+            }
+
+            if (!arguments_checked)
+            {
+                for (int i = 0; i < function->param_tags.size(); i++)
+                {
+                    auto tag = function->param_tags[i];
+                    if (tag >= 0 && runtime.slots[base + i].index() != tag)
+                    {
+                        throw BirdException("Type mismatch");
+                    }
+                }
+            }
+
+            return runtime.call(function, base);
+        };
+    }
+
+    void visit_return_stmt(ReturnStmt *return_stmt)
+    {
+        if (!return_stmt->expr.has_value())
+        {
+            this->stmt_result = [](ClosureRuntime &runtime)
+            {
+                return Completion::RETURN;
+            };
+            return;
+        }
+
+        auto expr = this->lower_expr(return_stmt->expr.value().get());
+        this->stmt_result = [expr](ClosureRuntime &runtime)
+        {
+            runtime.result = expr(runtime);
+            return Completion::RETURN;
+        };
+    }
+
+    void visit_break_stmt(BreakStmt *break_stmt)
+    {
+        this->stmt_result = [](ClosureRuntime &runtime)
+        {
+            return Completion::BREAK;
+        };
+    }
+
+    void visit_continue_stmt(ContinueStmt *continue_stmt)
+    {
+        this->stmt_result = [](ClosureRuntime &runtime)
+        {
+            return Completion::CONTINUE;
+        };
+    }
+
+    void visit_type_stmt(TypeStmt *type_stmt)
+    {
+        auto type = this->primitive_type(type_stmt->type_token, type_stmt->type_is_literal);
+        if (this->type_table.current_contains(type_stmt->identifier.lexeme))
+        {
+            this->type_table.envs.back()[type_stmt->identifier.lexeme] = type;
+        }
+        else
+        {
+            this->type_table.declare(type_stmt->identifier.lexeme, type);
+        }
+
+        this->stmt_result = [](ClosureRuntime &runtime)
+        {
+            return Completion::NORMAL;
+        };
+    }
+};
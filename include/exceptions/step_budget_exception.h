@@ -0,0 +1,15 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+/*
+ * Step budget exception that should be thrown when the interpreter has done
+ * more work than it was allowed to, which stops the evaluation.
+ */
+class StepBudgetException : public std::exception
+{
+private:
+public:
+    StepBudgetException() {}
+};
@@ -147,6 +147,15 @@ public:
         this->errors.push_back(std::make_tuple(this->format_message("semantic error: " + message, token.line_num, token.char_num), token));
     }
 
+    /*
+     * Inserts the errors of another tracker at the given position,
+     * used to merge errors that were found in a separate pass
+     */
+    void merge(const UserErrorTracker &other, size_t position)
+    {
+        this->errors.insert(this->errors.begin() + position, other.errors.begin(), other.errors.end());
+    }
+
     const std::vector<std::tuple<std::string, Token>> get_errors() const
     {
         return this->errors;
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "bird_type.h"
+#include "value.h"
+
+/*
+ * The operations of the Bird IR.
+ *
+ * Operands of arithmetic and comparison operations always have the same type,
+ * conversions between int and float are explicit TO_FLOAT and TO_INT operations
+ */
+enum class IrOp
+{
+    CONST,
+    PARAM,
+    PHI,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    NEG,
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE,
+    TO_FLOAT,
+    TO_INT,
+    CALL,
+    PRINT,
+};
+
+static std::string ir_op_to_string(IrOp op)
+{
+    switch (op)
+    {
+    case IrOp::CONST:
+        return "const";
+    case IrOp::PARAM:
+        return "param";
+    case IrOp::PHI:
+        return "phi";
+    case IrOp::ADD:
+        return "add";
+    case IrOp::SUB:
+        return "sub";
+    case IrOp::MUL:
+        return "mul";
+    case IrOp::DIV:
+        return "div";
+    case IrOp::MOD:
+        return "mod";
+    case IrOp::NEG:
+        return "neg";
+    case IrOp::EQ:
+        return "eq";
+    case IrOp::NE:
+        return "ne";
+    case IrOp::LT:
+        return "lt";
+    case IrOp::LE:
+        return "le";
+    case IrOp::GT:
+        return "gt";
+    case IrOp::GE:
+        return "ge";
+    case IrOp::TO_FLOAT:
+        return "to_float";
+    case IrOp::TO_INT:
+        return "to_int";
+    case IrOp::CALL:
+        return "call";
+    case IrOp::PRINT:
+        return "print";
+    default:
+        return "unknown";
+    }
+}
+
+/*
+ * An instruction defines at most one SSA value, values are numbered per function
+ * and every value is defined exactly once
+ */
+struct IrInstruction
+{
+    IrOp op;
+    int result = -1; // -1 when the instruction defines no value
+    BirdType type = BirdType::VOID;
+    std::vector<int> operands;
+    std::vector<int> incoming; // the predecessor block of each phi operand
+    Value constant;            // CONST
+    int index = 0;             // PARAM
+    std::string callee;        // CALL
+
+    IrInstruction(IrOp op, int result, BirdType type) : op(op), result(result), type(type) {}
+
+    bool has_side_effects()
+    {
+        return this->op == IrOp::CALL || this->op == IrOp::PRINT;
+    }
+};
+
+enum class IrTerminatorKind
+{
+    NONE, // the block is still being built
+    JUMP,
+    BRANCH,
+    RETURN,
+    UNREACHABLE,
+};
+
+/*
+ * How control leaves a basic block,
+ * a branch goes to targets[0] when the condition is true and targets[1] otherwise
+ */
+struct IrTerminator
+{
+    IrTerminatorKind kind = IrTerminatorKind::NONE;
+    std::vector<int> targets;
+    int condition = -1;
+    int value = -1; // the returned value, -1 for void returns
+};
+
+/*
+ * A basic block, the phis run in parallel when the block is entered
+ */
+struct IrBlock
+{
+    int id;
+    std::vector<IrInstruction> phis;
+    std::vector<IrInstruction> instructions;
+    IrTerminator terminator;
+    std::vector<int> predecessors;
+
+    IrBlock(int id) : id(id) {}
+};
+
+/*
+ * A function as a control flow graph, the first block is the entry.
+ * Top level statements are lowered into a function named main
+ */
+struct IrFunction
+{
+    std::string name;
+    std::vector<BirdType> params;
+    BirdType return_type = BirdType::VOID;
+    std::vector<IrBlock> blocks;
+    std::vector<BirdType> value_types;
+
+    IrFunction(std::string name) : name(name) {}
+
+    int new_value(BirdType type)
+    {
+        this->value_types.push_back(type);
+        return this->value_types.size() - 1;
+    }
+
+    int new_block()
+    {
+        this->blocks.push_back(IrBlock(this->blocks.size()));
+        return this->blocks.size() - 1;
+    }
+
+    int instruction_count()
+    {
+        int count = 0;
+        for (auto &block : this->blocks)
+        {
+            count += block.phis.size() + block.instructions.size();
+        }
+
+        return count;
+    }
+};
+
+struct IrModule
+{
+    std::vector<IrFunction> functions;
+
+    IrFunction *get(std::string name)
+    {
+        for (auto &function : this->functions)
+        {
+            if (function.name == name)
+            {
+                return &function;
+            }
+        }
+
+        return nullptr;
+    }
+};
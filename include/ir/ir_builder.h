@@ -0,0 +1,835 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <optional>
+#include <string>
+#include <map>
+#include <set>
+
+#include "ast_node/index.h"
+#include "sym_table.h"
+#include "ir/ir.h"
+
+/*
+ * Thrown while lowering a construct the IR does not support yet
+ */
+struct IrUnsupported
+{
+    std::string reason;
+
+    IrUnsupported(std::string reason) : reason(reason) {}
+};
+
+/*
+ * Visitor that lowers a type checked AST into the Bird IR, runs after type checking.
+ *
+ * SSA values are built directly from the AST: every variable keeps its current value
+ * per basic block and reading it in a block without a definition looks through the
+ * predecessors, placing a phi where they merge. Loop headers are sealed once their
+ * back edges are known, phis created before that get their operands when sealed.
+ *
+ * Variables have the type they are declared with and values assigned to them are
+ * converted like the code generator does. Programs with constructs the IR cannot
+ * express yet, such as nested functions, strings operators or functions reading
+ * variables they do not declare, are rejected and `unsupported` says why.
+ */
+class IrBuilder : public Visitor
+{
+public:
+    IrModule module;
+    std::string unsupported;
+
+    std::map<std::string, BirdType> return_types;
+    std::map<std::string, std::vector<BirdType>> param_types;
+    Environment<BirdType> type_table;
+
+    // state of the function being built
+    IrFunction *function;
+    int current_block;
+    int result;
+    int variable_count = 0;
+    Environment<std::string> variables; // source names to unique variable names
+    std::map<std::string, BirdType> variable_types;
+    std::map<std::string, std::map<int, int>> definitions; // variable -> block -> value
+    std::map<int, std::map<std::string, int>> incomplete_phis;
+    std::set<int> sealed_blocks;
+    std::vector<std::pair<int, int>> loops; // continue and break targets
+
+    IrBuilder()
+    {
+        this->type_table.push_env();
+    }
+
+    bool build(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        try
+        {
+            this->declare_top_level(stmts);
+
+            for (auto &stmt : *stmts)
+            {
+                if (auto func = dynamic_cast<Func *>(stmt.get()))
+                {
+                    this->build_function(func);
+                }
+            }
+
+            this->build_main(stmts);
+        }
+        catch (IrUnsupported &error)
+        {
+            this->unsupported = error.reason;
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+     * Functions and type aliases are declared first, the semantic analyzer
+     * already checked that nothing is used before it is declared
+     */
+    void declare_top_level(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        for (auto &stmt : *stmts)
+        {
+            if (auto type_stmt = dynamic_cast<TypeStmt *>(stmt.get()))
+            {
+                type_stmt->accept(this);
+            }
+            else if (auto func = dynamic_cast<Func *>(stmt.get()))
+            {
+                auto name = func->identifier.lexeme;
+                if (name == "main" || this->return_types.count(name))
+                {
+                    throw IrUnsupported("function " + name + " is declared more than once");
+                }
+
+                this->return_types[name] = func->return_type.has_value()
+                                               ? this->bird_type(func->return_type.value())
+                                               : BirdType::VOID;
+
+                auto &params = this->param_types[name];
+                for (auto &param : func->param_list)
+                {
+                    params.push_back(this->bird_type(param.second));
+                }
+            }
+        }
+    }
+
+    void build_function(Func *func)
+    {
+        auto name = func->identifier.lexeme;
+        this->begin_function(name);
+        this->function->params = this->param_types[name];
+        this->function->return_type = this->return_types[name];
+
+        for (int i = 0; i < func->param_list.size(); i++)
+        {
+            auto type = this->function->params[i];
+            auto param = this->emit(IrOp::PARAM, type, {});
+            this->function->blocks[this->current_block].instructions.back().index = i;
+
+            this->declare(func->param_list[i].first.lexeme, type, param);
+        }
+
+        func->block->accept(this);
+        this->end_function();
+    }
+
+    void build_main(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        this->begin_function("main");
+
+        for (auto &stmt : *stmts)
+        {
+            if (!dynamic_cast<Func *>(stmt.get()) && !dynamic_cast<TypeStmt *>(stmt.get()))
+            {
+                stmt->accept(this);
+            }
+        }
+
+        this->end_function();
+    }
+
+    void begin_function(std::string name)
+    {
+        this->module.functions.push_back(IrFunction(name));
+        this->function = &this->module.functions.back();
+
+        this->variables = Environment<std::string>();
+        this->variables.push_env();
+        this->variable_types.clear();
+        this->definitions.clear();
+        this->incomplete_phis.clear();
+        this->sealed_blocks.clear();
+        this->loops.clear();
+
+        this->current_block = this->function->new_block();
+        this->seal(this->current_block);
+    }
+
+    void end_function()
+    {
+        auto &terminator = this->function->blocks[this->current_block].terminator;
+        if (terminator.kind == IrTerminatorKind::NONE)
+        {
+            // only void functions can reach their end, the type checker makes the others return
+            terminator.kind = this->function->return_type == BirdType::VOID
+                                  ? IrTerminatorKind::RETURN
+                                  : IrTerminatorKind::UNREACHABLE;
+        }
+    }
+
+    /*
+     * Instructions and control flow
+     */
+    int emit(IrOp op, BirdType type, std::vector<int> operands)
+    {
+        int value = type == BirdType::VOID ? -1 : this->function->new_value(type);
+
+        IrInstruction instruction(op, value, type);
+        instruction.operands = operands;
+        this->function->blocks[this->current_block].instructions.push_back(instruction);
+
+        return value;
+    }
+
+    int emit_constant(Value constant, BirdType type)
+    {
+        auto value = this->emit(IrOp::CONST, type, {});
+        this->function->blocks[this->current_block].instructions.back().constant = constant;
+
+        return value;
+    }
+
+    bool terminated()
+    {
+        return this->function->blocks[this->current_block].terminator.kind != IrTerminatorKind::NONE;
+    }
+
+    /*
+     * Only the entry block is reachable without predecessors
+     */
+    bool reachable()
+    {
+        return this->current_block == 0 || !this->function->blocks[this->current_block].predecessors.empty();
+    }
+
+    void add_edge(int from, int to)
+    {
+        this->function->blocks[from].terminator.targets.push_back(to);
+        this->function->blocks[to].predecessors.push_back(from);
+    }
+
+    void jump(int target)
+    {
+        if (this->terminated() || !this->reachable())
+        {
+            return;
+        }
+
+        this->function->blocks[this->current_block].terminator.kind = IrTerminatorKind::JUMP;
+        this->add_edge(this->current_block, target);
+    }
+
+    void branch(int condition, int then_block, int else_block)
+    {
+        auto &terminator = this->function->blocks[this->current_block].terminator;
+        terminator.kind = IrTerminatorKind::BRANCH;
+        terminator.condition = condition;
+
+        this->add_edge(this->current_block, then_block);
+        this->add_edge(this->current_block, else_block);
+    }
+
+    /*
+     * Code after a return, break or continue goes into a block without predecessors
+     */
+    void start_unreachable_block()
+    {
+        this->current_block = this->function->new_block();
+        this->seal(this->current_block);
+    }
+
+    /*
+     * Variables in SSA form
+     */
+    void declare(std::string name, BirdType type, int value)
+    {
+        auto variable = name + "#" + std::to_string(this->variable_count++);
+        this->variables.declare(name, variable);
+        this->variable_types[variable] = type;
+        this->write_variable(variable, this->current_block, value);
+    }
+
+    std::string lookup(Token identifier)
+    {
+        if (!this->variables.contains(identifier.lexeme))
+        {
+            throw IrUnsupported(this->function->name + " uses " + identifier.lexeme + " which it does not declare");
+        }
+
+        return this->variables.get(identifier.lexeme);
+    }
+
+    void write_variable(std::string variable, int block, int value)
+    {
+        this->definitions[variable][block] = value;
+    }
+
+    int read_variable(std::string variable, int block)
+    {
+        auto &block_definitions = this->definitions[variable];
+        auto found = block_definitions.find(block);
+        if (found != block_definitions.end())
+        {
+            return found->second;
+        }
+
+        auto predecessors = this->function->blocks[block].predecessors;
+        int value;
+
+        if (!this->sealed_blocks.count(block))
+        {
+            // more predecessors may still be added
+            value = this->add_phi(variable, block);
+            this->incomplete_phis[block][variable] = value;
+        }
+        else if (predecessors.empty())
+        {
+            // the block is unreachable, any value will do
+            value = this->function->new_value(this->variable_types[variable]);
+            IrInstruction undefined(IrOp::CONST, value, this->variable_types[variable]);
+            undefined.constant = this->zero(this->variable_types[variable]);
+
+            auto &instructions = this->function->blocks[block].instructions;
+            instructions.insert(instructions.begin(), undefined);
+        }
+        else if (predecessors.size() == 1)
+        {
+            value = this->read_variable(variable, predecessors[0]);
+        }
+        else
+        {
+            // the phi is defined before its operands are read in case a loop leads back here
+            value = this->add_phi(variable, block);
+            this->write_variable(variable, block, value);
+            this->add_phi_operands(variable, block, value);
+        }
+
+        this->write_variable(variable, block, value);
+        return value;
+    }
+
+    int add_phi(std::string variable, int block)
+    {
+        auto type = this->variable_types[variable];
+        auto value = this->function->new_value(type);
+        this->function->blocks[block].phis.push_back(IrInstruction(IrOp::PHI, value, type));
+
+        return value;
+    }
+
+    void add_phi_operands(std::string variable, int block, int phi)
+    {
+        auto predecessors = this->function->blocks[block].predecessors;
+
+        std::vector<int> operands;
+        for (auto predecessor : predecessors)
+        {
+            operands.push_back(this->read_variable(variable, predecessor));
+        }
+
+        // reading the operands can add phis to this block, so it is looked up afterwards
+        for (auto &instruction : this->function->blocks[block].phis)
+        {
+            if (instruction.result == phi)
+            {
+                instruction.operands = operands;
+                instruction.incoming = predecessors;
+            }
+        }
+    }
+
+    void seal(int block)
+    {
+        for (auto &incomplete : this->incomplete_phis[block])
+        {
+            this->add_phi_operands(incomplete.first, block, incomplete.second);
+        }
+
+        this->incomplete_phis.erase(block);
+        this->sealed_blocks.insert(block);
+    }
+
+    /*
+     * Types
+     */
+    BirdType bird_type(Token token)
+    {
+        if (token.lexeme == "int")
+            return BirdType::INT;
+        if (token.lexeme == "float")
+            return BirdType::FLOAT;
+        if (token.lexeme == "bool")
+            return BirdType::BOOL;
+        if (token.lexeme == "str")
+            return BirdType::STRING;
+        if (token.lexeme == "void")
+            return BirdType::VOID;
+
+        if (this->type_table.contains(token.lexeme))
+        {
+            return this->type_table.get(token.lexeme);
+        }
+
+        throw IrUnsupported("unknown type " + token.lexeme);
+    }
+
+    BirdType type_of(int value)
+    {
+        if (value < 0)
+        {
+            return BirdType::VOID;
+        }
+
+        return this->function->value_types[value];
+    }
+
+    Value zero(BirdType type)
+    {
+        switch (type)
+        {
+        case BirdType::FLOAT:
+            return Value(0.0);
+        case BirdType::BOOL:
+            return Value(false);
+        case BirdType::STRING:
+            return Value(std::string(""));
+        default:
+            return Value(0);
+        }
+    }
+
+    /*
+     * Converts between int and float, other types are left alone
+     */
+    int convert(int value, BirdType type)
+    {
+        auto from = this->type_of(value);
+        if (from == BirdType::INT && type == BirdType::FLOAT)
+        {
+            return this->emit(IrOp::TO_FLOAT, BirdType::FLOAT, {value});
+        }
+
+        if (from == BirdType::FLOAT && type == BirdType::INT)
+        {
+            return this->emit(IrOp::TO_INT, BirdType::INT, {value});
+        }
+
+        return value;
+    }
+
+    int lower(Expr *expr)
+    {
+        expr->accept(this);
+        return this->result;
+    }
+
+    /*
+     * Applies an arithmetic or comparison operator, converting int operands to float
+     * when either operand is a float
+     */
+    int apply(Token op, int left, int right)
+    {
+        auto left_type = this->type_of(left);
+        auto right_type = this->type_of(right);
+
+        if (left_type == BirdType::STRING || right_type == BirdType::STRING)
+        {
+            throw IrUnsupported("operator " + op.lexeme + " on strings");
+        }
+
+        auto type = left_type;
+        if (left_type == BirdType::FLOAT || right_type == BirdType::FLOAT)
+        {
+            type = BirdType::FLOAT;
+            left = this->convert(left, type);
+            right = this->convert(right, type);
+        }
+
+        switch (op.token_type)
+        {
+        case Token::Type::PLUS:
+        case Token::Type::PLUS_EQUAL:
+            return this->emit(IrOp::ADD, type, {left, right});
+        case Token::Type::MINUS:
+        case Token::Type::MINUS_EQUAL:
+            return this->emit(IrOp::SUB, type, {left, right});
+        case Token::Type::STAR:
+        case Token::Type::STAR_EQUAL:
+            return this->emit(IrOp::MUL, type, {left, right});
+        case Token::Type::SLASH:
+        case Token::Type::SLASH_EQUAL:
+            return this->emit(IrOp::DIV, type, {left, right});
+        case Token::Type::PERCENT:
+        case Token::Type::PERCENT_EQUAL:
+            if (type == BirdType::FLOAT)
+            {
+                throw IrUnsupported("modulo of floats");
+            }
+
+            return this->emit(IrOp::MOD, type, {left, right});
+        case Token::Type::EQUAL_EQUAL:
+            return this->emit(IrOp::EQ, BirdType::BOOL, {left, right});
+        case Token::Type::BANG_EQUAL:
+            return this->emit(IrOp::NE, BirdType::BOOL, {left, right});
+        case Token::Type::LESS:
+            return this->emit(IrOp::LT, BirdType::BOOL, {left, right});
+        case Token::Type::LESS_EQUAL:
+            return this->emit(IrOp::LE, BirdType::BOOL, {left, right});
+        case Token::Type::GREATER:
+            return this->emit(IrOp::GT, BirdType::BOOL, {left, right});
+        case Token::Type::GREATER_EQUAL:
+            return this->emit(IrOp::GE, BirdType::BOOL, {left, right});
+        default:
+            throw BirdException("undefined binary operator " + op.lexeme);
+        }
+    }
+
+    void visit_block(Block *block)
+    {
+        this->variables.push_env();
+        this->type_table.push_env();
+
+        for (auto &stmt : block->stmts)
+        {
+            stmt->accept(this);
+        }
+
+        this->type_table.pop_env();
+        this->variables.pop_env();
+    }
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        auto value = this->lower(decl_stmt->value.get());
+        auto type = decl_stmt->type_token.has_value()
+                        ? this->bird_type(decl_stmt->type_token.value())
+                        : this->type_of(value);
+
+        if (type == BirdType::VOID)
+        {
+            throw IrUnsupported("declaration of " + decl_stmt->identifier.lexeme + " without a value");
+        }
+
+        this->declare(decl_stmt->identifier.lexeme, type, this->convert(value, type));
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        auto value = this->lower(const_stmt->value.get());
+        auto type = const_stmt->type_token.has_value()
+                        ? this->bird_type(const_stmt->type_token.value())
+                        : this->type_of(value);
+
+        if (type == BirdType::VOID)
+        {
+            throw IrUnsupported("declaration of " + const_stmt->identifier.lexeme + " without a value");
+        }
+
+        this->declare(const_stmt->identifier.lexeme, type, this->convert(value, type));
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        auto variable = this->lookup(assign_expr->identifier);
+        auto type = this->variable_types[variable];
+
+        auto value = this->convert(this->lower(assign_expr->value.get()), type);
+        if (assign_expr->assign_operator.token_type != Token::Type::EQUAL)
+        {
+            auto current = this->read_variable(variable, this->current_block);
+            value = this->apply(assign_expr->assign_operator, current, value);
+        }
+
+        this->write_variable(variable, this->current_block, value);
+        this->result = value;
+    }
+
+    void visit_expr_stmt(ExprStmt *expr_stmt)
+    {
+        this->lower(expr_stmt->expr.get());
+    }
+
+    void visit_print_stmt(PrintStmt *print_stmt)
+    {
+        for (auto &arg : print_stmt->args)
+        {
+            auto value = this->lower(arg.get());
+            if (this->type_of(value) == BirdType::VOID)
+            {
+                throw IrUnsupported("print of a void value");
+            }
+
+            this->emit(IrOp::PRINT, BirdType::VOID, {value});
+        }
+    }
+
+    void visit_if_stmt(IfStmt *if_stmt)
+    {
+        auto condition = this->lower(if_stmt->condition.get());
+
+        auto then_block = this->function->new_block();
+        auto merge_block = this->function->new_block();
+        auto else_block = if_stmt->else_branch.has_value() ? this->function->new_block() : merge_block;
+
+        this->branch(condition, then_block, else_block);
+
+        this->seal(then_block);
+        this->current_block = then_block;
+        if_stmt->then_branch->accept(this);
+        this->jump(merge_block);
+
+        if (if_stmt->else_branch.has_value())
+        {
+            this->seal(else_block);
+            this->current_block = else_block;
+            if_stmt->else_branch.value()->accept(this);
+            this->jump(merge_block);
+        }
+
+        this->seal(merge_block);
+        this->current_block = merge_block;
+    }
+
+    void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        auto header_block = this->function->new_block();
+        auto body_block = this->function->new_block();
+        auto exit_block = this->function->new_block();
+
+        this->jump(header_block);
+
+        // the header is sealed after the body adds its back edges
+        this->current_block = header_block;
+        auto condition = this->lower(while_stmt->condition.get());
+        this->branch(condition, body_block, exit_block);
+
+        this->seal(body_block);
+        this->current_block = body_block;
+        this->loops.push_back({header_block, exit_block});
+        while_stmt->stmt->accept(this);
+        this->loops.pop_back();
+        this->jump(header_block);
+
+        this->seal(header_block);
+        this->seal(exit_block);
+        this->current_block = exit_block;
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        this->variables.push_env();
+
+        if (for_stmt->initializer.has_value())
+        {
+            for_stmt->initializer.value()->accept(this);
+        }
+
+        auto header_block = this->function->new_block();
+        auto body_block = this->function->new_block();
+        auto increment_block = this->function->new_block();
+        auto exit_block = this->function->new_block();
+
+        this->jump(header_block);
+
+        this->current_block = header_block;
+        if (for_stmt->condition.has_value())
+        {
+            auto condition = this->lower(for_stmt->condition.value().get());
+            this->branch(condition, body_block, exit_block);
+        }
+        else
+        {
+            this->jump(body_block);
+        }
+
+        this->seal(body_block);
+        this->current_block = body_block;
+        this->loops.push_back({increment_block, exit_block});
+        for_stmt->body->accept(this);
+        this->loops.pop_back();
+        this->jump(increment_block);
+
+        this->seal(increment_block);
+        this->current_block = increment_block;
+        if (for_stmt->increment.has_value())
+        {
+            this->lower(for_stmt->increment.value().get());
+        }
+        this->jump(header_block);
+
+        this->seal(header_block);
+        this->seal(exit_block);
+        this->current_block = exit_block;
+
+        this->variables.pop_env();
+    }
+
+    void visit_break_stmt(BreakStmt *break_stmt)
+    {
+        this->jump(this->loops.back().second);
+        this->start_unreachable_block();
+    }
+
+    void visit_continue_stmt(ContinueStmt *continue_stmt)
+    {
+        this->jump(this->loops.back().first);
+        this->start_unreachable_block();
+    }
+
+    void visit_return_stmt(ReturnStmt *return_stmt)
+    {
+        int value = -1;
+        if (return_stmt->expr.has_value())
+        {
+            if (this->function->return_type == BirdType::VOID)
+            {
+                throw IrUnsupported("return with a value from " + this->function->name);
+            }
+
+            value = this->convert(this->lower(return_stmt->expr.value().get()), this->function->return_type);
+        }
+
+        auto &terminator = this->function->blocks[this->current_block].terminator;
+        terminator.kind = IrTerminatorKind::RETURN;
+        terminator.value = value;
+        this->start_unreachable_block();
+    }
+
+    void visit_func(Func *func)
+    {
+        throw IrUnsupported("nested function " + func->identifier.lexeme);
+    }
+
+    void visit_type_stmt(TypeStmt *type_stmt)
+    {
+        this->type_table.declare(type_stmt->identifier.lexeme, this->bird_type(type_stmt->type_token));
+    }
+
+    void visit_binary(Binary *binary)
+    {
+        auto left = this->lower(binary->left.get());
+        auto right = this->lower(binary->right.get());
+
+        this->result = this->apply(binary->op, left, right);
+    }
+
+    void visit_unary(Unary *unary)
+    {
+        auto value = this->lower(unary->expr.get());
+        this->result = this->emit(IrOp::NEG, this->type_of(value), {value});
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        switch (primary->value.token_type)
+        {
+        case Token::Type::INT_LITERAL:
+            this->result = this->emit_constant(Value(std::stoi(primary->value.lexeme)), BirdType::INT);
+            break;
+        case Token::Type::FLOAT_LITERAL:
+            this->result = this->emit_constant(Value(std::stod(primary->value.lexeme)), BirdType::FLOAT);
+            break;
+        case Token::Type::BOOL_LITERAL:
+            this->result = this->emit_constant(Value(primary->value.lexeme == "true"), BirdType::BOOL);
+            break;
+        case Token::Type::STR_LITERAL:
+            this->result = this->emit_constant(Value(primary->value.lexeme), BirdType::STRING);
+            break;
+        case Token::Type::IDENTIFIER:
+            this->result = this->read_variable(this->lookup(primary->value), this->current_block);
+            break;
+        default:
+            throw BirdException("undefined primary value: " + primary->value.lexeme);
+        }
+    }
+
+    /*
+     * Only the chosen side of a ternary runs, so it becomes a branch and a phi
+     */
+    void visit_ternary(Ternary *ternary)
+    {
+        auto condition = this->lower(ternary->condition.get());
+
+        auto true_block = this->function->new_block();
+        auto false_block = this->function->new_block();
+        auto merge_block = this->function->new_block();
+
+        this->branch(condition, true_block, false_block);
+        this->seal(true_block);
+        this->seal(false_block);
+
+        this->current_block = true_block;
+        auto true_value = this->lower(ternary->true_expr.get());
+        auto true_end = this->current_block;
+
+        this->current_block = false_block;
+        auto false_value = this->lower(ternary->false_expr.get());
+        auto false_end = this->current_block;
+
+        auto type = this->type_of(true_value);
+        if (type != this->type_of(false_value))
+        {
+            type = BirdType::FLOAT;
+
+            this->current_block = true_end;
+            true_value = this->convert(true_value, type);
+            this->current_block = false_end;
+            false_value = this->convert(false_value, type);
+        }
+
+        if (type == BirdType::VOID)
+        {
+            throw IrUnsupported("ternary without a value");
+        }
+
+        this->current_block = true_end;
+        this->jump(merge_block);
+        this->current_block = false_end;
+        this->jump(merge_block);
+
+        this->seal(merge_block);
+        this->current_block = merge_block;
+
+        IrInstruction phi(IrOp::PHI, this->function->new_value(type), type);
+        phi.operands = {true_value, false_value};
+        phi.incoming = {true_end, false_end};
+        this->function->blocks[merge_block].phis.push_back(phi);
+
+        this->result = phi.result;
+    }
+
+    void visit_call(Call *call)
+    {
+        auto name = call->identifier.lexeme;
+        if (!this->return_types.count(name))
+        {
+            throw IrUnsupported("call to undeclared function " + name);
+        }
+
+        auto &params = this->param_types[name];
+        std::vector<int> args;
+        for (int i = 0; i < call->args.size(); i++)
+        {
+            args.push_back(this->convert(this->lower(call->args[i].get()), params[i]));
+        }
+
+        this->result = this->emit(IrOp::CALL, this->return_types[name], args);
+        this->function->blocks[this->current_block].instructions.back().callee = name;
+    }
+};
@@ -0,0 +1,614 @@
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include <map>
+#include <set>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <algorithm>
+
+#include "ir/ir.h"
+
+/*
+ * Runs the optimization passes over every function of the Bird IR until none of them change anything:
+ *
+ * - phis whose operands are all the same value are replaced by that value
+ * - operations on constants are folded, and branches on constants become jumps
+ * - blocks that cannot be reached from the entry are removed
+ * - a block that is the only way into its successor absorbs it
+ * - values nothing depends on are removed
+ */
+class IrOptimizer
+{
+public:
+    int removed_phis = 0;
+    int folded_instructions = 0;
+    int folded_branches = 0;
+    int removed_blocks = 0;
+    int merged_blocks = 0;
+    int removed_instructions = 0;
+
+    std::map<int, int> replacements;
+
+    void optimize(IrModule *module)
+    {
+        for (auto &function : module->functions)
+        {
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+                changed |= this->remove_trivial_phis(function);
+                changed |= this->fold_constants(function);
+                changed |= this->remove_unreachable_blocks(function);
+                changed |= this->merge_blocks(function);
+                changed |= this->remove_dead_values(function);
+            }
+        }
+    }
+
+    void print_stats()
+    {
+        std::cout << "ir:" << std::endl;
+        std::cout << "  removed phis: " << this->removed_phis << std::endl;
+        std::cout << "  folded instructions: " << this->folded_instructions << std::endl;
+        std::cout << "  folded branches: " << this->folded_branches << std::endl;
+        std::cout << "  removed blocks: " << this->removed_blocks << std::endl;
+        std::cout << "  merged blocks: " << this->merged_blocks << std::endl;
+        std::cout << "  removed instructions: " << this->removed_instructions << std::endl;
+    }
+
+    /*
+     * Replacing values
+     */
+    int resolve(int value)
+    {
+        auto found = this->replacements.find(value);
+        while (found != this->replacements.end())
+        {
+            value = found->second;
+            found = this->replacements.find(value);
+        }
+
+        return value;
+    }
+
+    void apply_replacements(IrFunction &function)
+    {
+        if (this->replacements.empty())
+        {
+            return;
+        }
+
+        for (auto &block : function.blocks)
+        {
+            for (auto &phi : block.phis)
+            {
+                for (auto &operand : phi.operands)
+                    operand = this->resolve(operand);
+            }
+
+            for (auto &instruction : block.instructions)
+            {
+                for (auto &operand : instruction.operands)
+                    operand = this->resolve(operand);
+            }
+
+            if (block.terminator.condition >= 0)
+                block.terminator.condition = this->resolve(block.terminator.condition);
+
+            if (block.terminator.value >= 0)
+                block.terminator.value = this->resolve(block.terminator.value);
+        }
+
+        this->replacements.clear();
+    }
+
+    /*
+     * Removes one edge between two blocks along with the phi operands that came through it
+     */
+    void remove_edge(IrFunction &function, int from, int to)
+    {
+        auto &block = function.blocks[to];
+        for (int i = 0; i < block.predecessors.size(); i++)
+        {
+            if (block.predecessors[i] != from)
+            {
+                continue;
+            }
+
+            block.predecessors.erase(block.predecessors.begin() + i);
+            for (auto &phi : block.phis)
+            {
+                phi.operands.erase(phi.operands.begin() + i);
+                phi.incoming.erase(phi.incoming.begin() + i);
+            }
+
+            return;
+        }
+    }
+
+    /*
+     * A phi whose operands are itself or one other value is that value
+     */
+    bool remove_trivial_phis(IrFunction &function)
+    {
+        int removed = 0;
+        for (auto &block : function.blocks)
+        {
+            for (int i = 0; i < block.phis.size(); i++)
+            {
+                auto &phi = block.phis[i];
+
+                int same = -1;
+                bool trivial = true;
+                for (auto operand : phi.operands)
+                {
+                    operand = this->resolve(operand);
+                    if (operand == phi.result || operand == same)
+                    {
+                        continue;
+                    }
+
+                    if (same != -1)
+                    {
+                        trivial = false;
+                        break;
+                    }
+
+                    same = operand;
+                }
+
+                if (!trivial || same == -1)
+                {
+                    continue;
+                }
+
+                this->replacements[phi.result] = same;
+                block.phis.erase(block.phis.begin() + i--);
+                removed++;
+            }
+        }
+
+        this->apply_replacements(function);
+        this->removed_phis += removed;
+
+        return removed > 0;
+    }
+
+    bool fold_constants(IrFunction &function)
+    {
+        std::map<int, Value> constants;
+        int folded = 0;
+        int branches = 0;
+
+        for (auto &block : function.blocks)
+        {
+            for (auto &instruction : block.instructions)
+            {
+                if (instruction.op == IrOp::CONST)
+                {
+                    constants[instruction.result] = instruction.constant;
+                    continue;
+                }
+
+                std::vector<Value> operands;
+                for (auto operand : instruction.operands)
+                {
+                    auto found = constants.find(operand);
+                    if (found == constants.end())
+                    {
+                        break;
+                    }
+
+                    operands.push_back(found->second);
+                }
+
+                if (instruction.result < 0 || operands.empty() || operands.size() != instruction.operands.size())
+                {
+                    continue;
+                }
+
+                auto value = this->evaluate(instruction, operands);
+                if (!value.has_value())
+                {
+                    continue;
+                }
+
+                instruction.op = IrOp::CONST;
+                instruction.operands.clear();
+                instruction.constant = value.value();
+                constants[instruction.result] = value.value();
+                folded++;
+            }
+
+            auto &terminator = block.terminator;
+            if (terminator.kind != IrTerminatorKind::BRANCH)
+            {
+                continue;
+            }
+
+            int taken;
+            if (terminator.targets[0] == terminator.targets[1])
+            {
+                taken = 0;
+            }
+            else if (constants.count(terminator.condition))
+            {
+                auto &condition = constants[terminator.condition];
+                bool truthy = condition.is_bool() ? condition.as_bool() : condition.as_int() != 0;
+                taken = truthy ? 0 : 1;
+            }
+            else
+            {
+                continue;
+            }
+
+            this->remove_edge(function, block.id, terminator.targets[1 - taken]);
+            terminator.kind = IrTerminatorKind::JUMP;
+            terminator.targets = {terminator.targets[taken]};
+            terminator.condition = -1;
+            branches++;
+        }
+
+        this->folded_instructions += folded;
+        this->folded_branches += branches;
+
+        return folded > 0 || branches > 0;
+    }
+
+    /*
+     * Computes an operation on constants the way the wasm module would,
+     * nullopt when the operation traps at runtime
+     */
+    std::optional<Value> evaluate(IrInstruction &instruction, std::vector<Value> &operands)
+    {
+        if (operands[0].is_double())
+        {
+            double left = operands[0].as_double();
+            double right = operands.size() > 1 ? operands[1].as_double() : 0;
+
+            switch (instruction.op)
+            {
+            case IrOp::ADD:
+                return Value(left + right);
+            case IrOp::SUB:
+                return Value(left - right);
+            case IrOp::MUL:
+                return Value(left * right);
+            case IrOp::DIV:
+                return Value(left / right);
+            case IrOp::NEG:
+                return Value(-left);
+            case IrOp::EQ:
+                return Value(left == right);
+            case IrOp::NE:
+                return Value(left != right);
+            case IrOp::LT:
+                return Value(left < right);
+            case IrOp::LE:
+                return Value(left <= right);
+            case IrOp::GT:
+                return Value(left > right);
+            case IrOp::GE:
+                return Value(left >= right);
+            case IrOp::TO_INT:
+                return Value(this->truncate(left));
+            default:
+                return std::nullopt;
+            }
+        }
+
+        if (operands[0].is_bool())
+        {
+            bool left = operands[0].as_bool();
+            bool right = operands.size() > 1 ? operands[1].as_bool() : false;
+
+            switch (instruction.op)
+            {
+            case IrOp::EQ:
+                return Value(left == right);
+            case IrOp::NE:
+                return Value(left != right);
+            default:
+                return std::nullopt;
+            }
+        }
+
+        if (!operands[0].is_int())
+        {
+            return std::nullopt;
+        }
+
+        // ints wrap around like i32 does
+        uint32_t left = operands[0].as_int();
+        uint32_t right = operands.size() > 1 ? operands[1].as_int() : 0;
+        int32_t signed_left = left;
+        int32_t signed_right = right;
+        int32_t min = std::numeric_limits<int32_t>::min();
+
+        switch (instruction.op)
+        {
+        case IrOp::ADD:
+            return Value((int32_t)(left + right));
+        case IrOp::SUB:
+            return Value((int32_t)(left - right));
+        case IrOp::MUL:
+            return Value((int32_t)(left * right));
+        case IrOp::DIV:
+            if (signed_right == 0 || (signed_left == min && signed_right == -1))
+                return std::nullopt;
+            return Value(signed_left / signed_right);
+        case IrOp::MOD:
+            if (signed_right == 0)
+                return std::nullopt;
+            if (signed_right == -1)
+                return Value(0);
+            return Value(signed_left % signed_right);
+        case IrOp::NEG:
+            return Value((int32_t)(0 - left));
+        case IrOp::EQ:
+            return Value(signed_left == signed_right);
+        case IrOp::NE:
+            return Value(signed_left != signed_right);
+        case IrOp::LT:
+            return Value(signed_left < signed_right);
+        case IrOp::LE:
+            return Value(signed_left <= signed_right);
+        case IrOp::GT:
+            return Value(signed_left > signed_right);
+        case IrOp::GE:
+            return Value(signed_left >= signed_right);
+        case IrOp::TO_FLOAT:
+            return Value((double)signed_left);
+        default:
+            return std::nullopt;
+        }
+    }
+
+    /*
+     * Saturating conversion, matches i32.trunc_sat_f64_s
+     */
+    int truncate(double value)
+    {
+        if (std::isnan(value))
+            return 0;
+        if (value <= (double)std::numeric_limits<int32_t>::min())
+            return std::numeric_limits<int32_t>::min();
+        if (value >= (double)std::numeric_limits<int32_t>::max())
+            return std::numeric_limits<int32_t>::max();
+
+        return (int)value;
+    }
+
+    bool remove_unreachable_blocks(IrFunction &function)
+    {
+        std::vector<bool> reachable(function.blocks.size(), false);
+        std::vector<int> worklist = {0};
+        reachable[0] = true;
+
+        while (!worklist.empty())
+        {
+            auto block = worklist.back();
+            worklist.pop_back();
+
+            for (auto target : function.blocks[block].terminator.targets)
+            {
+                if (!reachable[target])
+                {
+                    reachable[target] = true;
+                    worklist.push_back(target);
+                }
+            }
+        }
+
+        int removed = std::count(reachable.begin(), reachable.end(), false);
+        if (removed == 0)
+        {
+            return false;
+        }
+
+        for (int block = 0; block < function.blocks.size(); block++)
+        {
+            if (reachable[block])
+            {
+                continue;
+            }
+
+            for (auto target : function.blocks[block].terminator.targets)
+            {
+                this->remove_edge(function, block, target);
+            }
+        }
+
+        // renumber the remaining blocks so the id of a block stays its index
+        std::vector<int> ids(function.blocks.size(), -1);
+        std::vector<IrBlock> blocks;
+        for (auto &block : function.blocks)
+        {
+            if (reachable[block.id])
+            {
+                ids[block.id] = blocks.size();
+                blocks.push_back(std::move(block));
+            }
+        }
+
+        for (auto &block : blocks)
+        {
+            block.id = ids[block.id];
+            for (auto &target : block.terminator.targets)
+                target = ids[target];
+            for (auto &predecessor : block.predecessors)
+                predecessor = ids[predecessor];
+            for (auto &phi : block.phis)
+            {
+                for (auto &incoming : phi.incoming)
+                    incoming = ids[incoming];
+            }
+        }
+
+        function.blocks = std::move(blocks);
+        this->removed_blocks += removed;
+
+        return true;
+    }
+
+    /*
+     * Appends a block to the block that jumps to it when nothing else can enter it
+     */
+    bool merge_blocks(IrFunction &function)
+    {
+        int merged = 0;
+        for (auto &block : function.blocks)
+        {
+            while (block.terminator.kind == IrTerminatorKind::JUMP)
+            {
+                auto &next = function.blocks[block.terminator.targets[0]];
+                if (next.id == 0 || next.id == block.id || next.predecessors.size() != 1)
+                {
+                    break;
+                }
+
+                // phis with a single predecessor are just their operand
+                for (auto &phi : next.phis)
+                {
+                    this->replacements[phi.result] = phi.operands[0];
+                }
+                next.phis.clear();
+
+                block.instructions.insert(
+                    block.instructions.end(),
+                    next.instructions.begin(),
+                    next.instructions.end());
+                block.terminator = next.terminator;
+
+                for (auto target : next.terminator.targets)
+                {
+                    for (auto &predecessor : function.blocks[target].predecessors)
+                    {
+                        if (predecessor == next.id)
+                            predecessor = block.id;
+                    }
+
+                    for (auto &phi : function.blocks[target].phis)
+                    {
+                        for (auto &incoming : phi.incoming)
+                        {
+                            if (incoming == next.id)
+                                incoming = block.id;
+                        }
+                    }
+                }
+
+                // the absorbed block is left without predecessors and removed as unreachable
+                next.instructions.clear();
+                next.terminator = IrTerminator();
+                next.predecessors.clear();
+                merged++;
+            }
+        }
+
+        this->apply_replacements(function);
+        this->merged_blocks += merged;
+
+        return merged > 0;
+    }
+
+    /*
+     * Keeps the values that side effects, branches and returns depend on
+     */
+    bool remove_dead_values(IrFunction &function)
+    {
+        std::map<int, IrInstruction *> definitions;
+        std::map<int, Value> constants;
+        for (auto &block : function.blocks)
+        {
+            for (auto &phi : block.phis)
+                definitions[phi.result] = &phi;
+
+            for (auto &instruction : block.instructions)
+            {
+                if (instruction.result >= 0)
+                    definitions[instruction.result] = &instruction;
+                if (instruction.op == IrOp::CONST)
+                    constants[instruction.result] = instruction.constant;
+            }
+        }
+
+        std::set<int> live;
+        std::vector<int> worklist;
+        auto use = [&](int value)
+        {
+            if (value >= 0 && live.insert(value).second)
+                worklist.push_back(value);
+        };
+
+        for (auto &block : function.blocks)
+        {
+            for (auto &instruction : block.instructions)
+            {
+                if (instruction.has_side_effects() || this->may_trap(instruction, constants))
+                {
+                    if (instruction.result >= 0)
+                        use(instruction.result);
+
+                    for (auto operand : instruction.operands)
+                        use(operand);
+                }
+            }
+
+            use(block.terminator.condition);
+            use(block.terminator.value);
+        }
+
+        while (!worklist.empty())
+        {
+            auto value = worklist.back();
+            worklist.pop_back();
+
+            for (auto operand : definitions[value]->operands)
+                use(operand);
+        }
+
+        int removed = 0;
+        auto is_dead = [&](IrInstruction &instruction)
+        {
+            bool dead = instruction.result >= 0 && !live.count(instruction.result);
+            removed += dead;
+            return dead;
+        };
+
+        for (auto &block : function.blocks)
+        {
+            block.phis.erase(std::remove_if(block.phis.begin(), block.phis.end(), is_dead), block.phis.end());
+            block.instructions.erase(
+                std::remove_if(block.instructions.begin(), block.instructions.end(), is_dead),
+                block.instructions.end());
+        }
+
+        this->removed_instructions += removed;
+        return removed > 0;
+    }
+
+    /*
+     * Integer division traps on a zero divisor and on the smallest int divided by -1
+     */
+    bool may_trap(IrInstruction &instruction, std::map<int, Value> &constants)
+    {
+        if ((instruction.op != IrOp::DIV && instruction.op != IrOp::MOD) || instruction.type != BirdType::INT)
+        {
+            return false;
+        }
+
+        auto divisor = constants.find(instruction.operands[1]);
+        if (divisor == constants.end())
+        {
+            return true;
+        }
+
+        int value = divisor->second.as_int();
+        return value == 0 || (instruction.op == IrOp::DIV && value == -1);
+    }
+};
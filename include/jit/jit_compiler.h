@@ -0,0 +1,688 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <set>
+#include <cstdint>
+#include <cstring>
+
+#include "ast_node/index.h"
+#include "callable.h"
+#include "sym_table.h"
+#include "value.h"
+#include "exceptions/bird_exception.h"
+#include "jit/x86_64_assembler.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define BIRD_JIT 1
+#include <sys/mman.h>
+#else
+#define BIRD_JIT 0
+#endif
+
+/*
+ * Thrown while compiling a construct the JIT does not support
+ */
+struct JitUnsupported
+{
+    std::string reason;
+
+    JitUnsupported(std::string reason) : reason(reason) {}
+};
+
+/*
+ * The machine code of a compiled function in its own executable mapping,
+ * called with its int and bool arguments like a C function
+ */
+class JitFunction
+{
+public:
+    using Entry = int64_t (*)(int64_t, int64_t, int64_t, int64_t, int64_t, int64_t);
+
+    // set by compiled code that stopped on an error, the code returns right away and the caller throws
+    static constexpr int DIVISION_BY_ZERO = 1;
+    static constexpr int MODULO_BY_ZERO = 2;
+
+    void *memory = nullptr;
+    size_t size = 0;
+
+    JitFunction(const std::vector<uint8_t> &code) : size(code.size())
+    {
+#if BIRD_JIT
+        this->memory = mmap(nullptr, this->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (this->memory == MAP_FAILED)
+        {
+            throw JitUnsupported("no executable memory");
+        }
+
+        std::memcpy(this->memory, code.data(), this->size);
+        mprotect(this->memory, this->size, PROT_READ | PROT_EXEC);
+#endif
+    }
+
+    JitFunction(const JitFunction &) = delete;
+
+    ~JitFunction()
+    {
+#if BIRD_JIT
+        munmap(this->memory, this->size);
+#endif
+    }
+
+    static int &error()
+    {
+        static int error = 0;
+        return error;
+    }
+
+    /*
+     * Runs the code with arguments that hold the types of the parameters
+     */
+    Value run(const Value *args, int count, BirdType return_type)
+    {
+        int64_t registers[6] = {0, 0, 0, 0, 0, 0};
+        for (int i = 0; i < count; i++)
+        {
+            registers[i] = args[i].is_int() ? args[i].as_int() : args[i].as_bool();
+        }
+
+        JitFunction::error() = 0;
+        auto result = (int32_t)((Entry)this->memory)(registers[0], registers[1], registers[2], registers[3], registers[4], registers[5]);
+
+        switch (JitFunction::error())
+        {
+        case DIVISION_BY_ZERO:
+            throw BirdException("Division by zero.");
+        case MODULO_BY_ZERO:
+            throw BirdException("Modulo by zero.");
+        }
+
+        if (return_type == BirdType::BOOL)
+        {
+            return Value(result != 0);
+        }
+
+        return Value((int)result);
+    }
+};
+
+/*
+ * Compiles hot interpreted functions to x86-64 machine code, a baseline JIT.
+ *
+ * The code is a direct translation of the AST: every expression leaves its value in
+ * eax, operands wait on the machine stack and variables live in the stack frame at
+ * the slots the slot resolver gave them. The int and bool types of the expressions
+ * follow the rules of the type checker, which has accepted the program already.
+ *
+ * Functions whose parameters, variables and return value are ints or bools and that
+ * only call functions it can compile are supported. Anything else, like floats,
+ * strings, printing or variables of the top level code, leaves the function to the
+ * interpreter and `unsupported` says why.
+ */
+class JitCompiler : public Visitor
+{
+public:
+    static constexpr int max_params = 6; // the arguments passed in registers
+
+    Environment<Callable> *call_table;
+    std::set<Callable *> compiling; // the function being compiled and the ones waiting for it
+    std::string unsupported;
+
+    X86Assembler assembler;
+    Callable *callable = nullptr;
+    std::vector<BirdType> slot_types;
+    BirdType type = BirdType::VOID;                                   // the type of the expression compiled last
+    std::vector<int> exits;                                           // jumps to the epilogue to patch
+    std::vector<std::pair<std::vector<int>, std::vector<int>>> loops; // breaks and continues to patch
+
+    JitCompiler(Environment<Callable> *call_table) : call_table(call_table) {}
+
+    /*
+     * Compiles a function into `callable->native`, or marks it as failed
+     */
+    bool compile(Callable *callable)
+    {
+        try
+        {
+#if !BIRD_JIT
+            throw JitUnsupported("the JIT only targets x86-64 Linux");
+#endif
+            this->begin(callable);
+            callable->native = std::make_shared<JitFunction>(this->assembler.code);
+        }
+        catch (JitUnsupported &error)
+        {
+            this->unsupported = error.reason;
+            callable->jit_failed = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    static int offset(int slot)
+    {
+        return -8 * (slot + 1);
+    }
+
+    bool is_value_type(BirdType type)
+    {
+        return type == BirdType::INT || type == BirdType::BOOL;
+    }
+
+    void begin(Callable *callable)
+    {
+        if (callable->frame_size < 0)
+        {
+            throw JitUnsupported("the function defines functions or reads variables by name");
+        }
+
+        if (callable->memo)
+        {
+            throw JitUnsupported("the function is memoized");
+        }
+
+        if (callable->param_types.size() > max_params)
+        {
+            throw JitUnsupported("the function has more than " + std::to_string(max_params) + " parameters");
+        }
+
+        if (!this->is_value_type(callable->resolved_return_type))
+        {
+            throw JitUnsupported("the function does not return an int or a bool");
+        }
+
+        this->callable = callable;
+        this->compiling.insert(callable);
+        this->slot_types.assign(callable->frame_size, BirdType::ERROR);
+
+        this->assembler.prologue((8 * callable->frame_size + 15) / 16 * 16);
+
+        for (int i = 0; i < callable->param_types.size(); i++)
+        {
+            if (!this->is_value_type(callable->param_types[i]))
+            {
+                throw JitUnsupported("a parameter is not an int or a bool");
+            }
+
+            this->slot_types[i] = callable->param_types[i];
+            this->assembler.store_local(JitCompiler::offset(i), argument_registers[i]);
+        }
+
+        for (auto &stmt : dynamic_cast<Block *>(callable->block.get())->stmts)
+        {
+            stmt->accept(this);
+        }
+
+        // falling off the end returns 0
+        this->assembler.load_immediate(0);
+        for (auto exit : this->exits)
+        {
+            this->assembler.patch(exit, this->assembler.position());
+        }
+
+        this->assembler.epilogue();
+    }
+
+    /*
+     * Compiles an expression into eax and returns its type
+     */
+    BirdType lower(Expr *expr)
+    {
+        expr->accept(this);
+
+        if (!this->is_value_type(this->type))
+        {
+            throw JitUnsupported("an expression is not an int or a bool");
+        }
+
+        return this->type;
+    }
+
+    /*
+     * Stops with an error when eax is zero
+     */
+    void check_divisor(int error)
+    {
+        this->assembler.test();
+        auto nonzero = this->assembler.jump_if(Condition::NOT_EQUAL);
+        this->assembler.store_flag(&JitFunction::error(), error);
+        this->exits.push_back(this->assembler.jump());
+        this->assembler.patch(nonzero, this->assembler.position());
+    }
+
+    /*
+     * eax = ecx <op> eax for two ints
+     */
+    void arithmetic(Token::Type op)
+    {
+        switch (op)
+        {
+        case Token::Type::PLUS:
+        case Token::Type::PLUS_EQUAL:
+            this->assembler.add();
+            break;
+        case Token::Type::MINUS:
+        case Token::Type::MINUS_EQUAL:
+            this->assembler.subtract();
+            break;
+        case Token::Type::STAR:
+        case Token::Type::STAR_EQUAL:
+            this->assembler.multiply();
+            break;
+        case Token::Type::SLASH:
+        case Token::Type::SLASH_EQUAL:
+            this->check_divisor(JitFunction::DIVISION_BY_ZERO);
+            this->assembler.divide(false);
+            break;
+        case Token::Type::PERCENT:
+        case Token::Type::PERCENT_EQUAL:
+            this->check_divisor(JitFunction::MODULO_BY_ZERO);
+            this->assembler.divide(true);
+            break;
+        default:
+            throw JitUnsupported("an operator that is not defined on ints");
+        }
+    }
+
+    std::optional<Condition> condition(Token::Type op)
+    {
+        switch (op)
+        {
+        case Token::Type::EQUAL_EQUAL:
+            return Condition::EQUAL;
+        case Token::Type::BANG_EQUAL:
+            return Condition::NOT_EQUAL;
+        case Token::Type::LESS:
+            return Condition::LESS;
+        case Token::Type::LESS_EQUAL:
+            return Condition::LESS_EQUAL;
+        case Token::Type::GREATER:
+            return Condition::GREATER;
+        case Token::Type::GREATER_EQUAL:
+            return Condition::GREATER_EQUAL;
+        default:
+            return std::nullopt;
+        }
+    }
+
+    void visit_block(Block *block)
+    {
+        for (auto &stmt : block->stmts)
+        {
+            stmt->accept(this);
+        }
+    }
+
+    void declare(int slot, Expr *value, std::optional<Token> type_token)
+    {
+        if (slot < 0)
+        {
+            throw JitUnsupported("a variable without a slot");
+        }
+
+        auto type = this->lower(value);
+        if (type_token.has_value())
+        {
+            auto lexeme = type_token.value().lexeme;
+            if ((lexeme != "int" || type != BirdType::INT) && (lexeme != "bool" || type != BirdType::BOOL))
+            {
+                throw JitUnsupported("a variable declared as " + lexeme);
+            }
+        }
+
+        this->slot_types[slot] = type;
+        this->assembler.store_local(JitCompiler::offset(slot));
+    }
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        this->declare(decl_stmt->slot, decl_stmt->value.get(), decl_stmt->type_token);
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        this->declare(const_stmt->slot, const_stmt->value.get(), const_stmt->type_token);
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        auto slot = assign_expr->slot;
+        if (slot < 0)
+        {
+            throw JitUnsupported("an assignment to " + assign_expr->identifier.lexeme + ", which is not a local");
+        }
+
+        if (assign_expr->assign_operator.token_type == Token::Type::EQUAL)
+        {
+            if (this->lower(assign_expr->value.get()) != this->slot_types[slot])
+            {
+                throw JitUnsupported("an assignment that changes the type of " + assign_expr->identifier.lexeme);
+            }
+        }
+        else
+        {
+            // the variable is read before the value is evaluated, like the interpreter does
+            this->assembler.load_local(JitCompiler::offset(slot));
+            this->assembler.push(Register::RAX);
+
+            if (this->slot_types[slot] != BirdType::INT || this->lower(assign_expr->value.get()) != BirdType::INT)
+            {
+                throw JitUnsupported("a compound assignment that is not on ints");
+            }
+
+            this->assembler.pop(Register::RCX);
+            this->arithmetic(assign_expr->assign_operator.token_type);
+        }
+
+        this->assembler.store_local(JitCompiler::offset(slot));
+        this->type = BirdType::VOID;
+    }
+
+    void visit_expr_stmt(ExprStmt *expr_stmt)
+    {
+        expr_stmt->expr->accept(this);
+    }
+
+    void visit_print_stmt(PrintStmt *print_stmt)
+    {
+        throw JitUnsupported("print");
+    }
+
+    void visit_if_stmt(IfStmt *if_stmt)
+    {
+        if (this->lower(if_stmt->condition.get()) != BirdType::BOOL)
+        {
+            throw JitUnsupported("a condition that is not a bool");
+        }
+
+        this->assembler.test();
+        auto to_else = this->assembler.jump_if(Condition::EQUAL);
+        if_stmt->then_branch->accept(this);
+
+        if (if_stmt->else_branch.has_value())
+        {
+            auto to_end = this->assembler.jump();
+            this->assembler.patch(to_else, this->assembler.position());
+            if_stmt->else_branch.value()->accept(this);
+            this->assembler.patch(to_end, this->assembler.position());
+        }
+        else
+        {
+            this->assembler.patch(to_else, this->assembler.position());
+        }
+    }
+
+    /*
+     * The body of a loop, continues jump to `next` and breaks to the end
+     */
+    void loop(Stmt *body, std::vector<int> &breaks, std::vector<int> &continues)
+    {
+        this->loops.push_back({});
+        body->accept(this);
+
+        breaks = std::move(this->loops.back().first);
+        continues = std::move(this->loops.back().second);
+        this->loops.pop_back();
+    }
+
+    void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        auto start = this->assembler.position();
+
+        if (this->lower(while_stmt->condition.get()) != BirdType::BOOL)
+        {
+            throw JitUnsupported("a condition that is not a bool");
+        }
+
+        this->assembler.test();
+        auto to_exit = this->assembler.jump_if(Condition::EQUAL);
+
+        std::vector<int> breaks, continues;
+        this->loop(while_stmt->stmt.get(), breaks, continues);
+
+        this->assembler.jump_to(start);
+
+        for (auto jump : continues)
+        {
+            this->assembler.patch(jump, start);
+        }
+
+        this->assembler.patch(to_exit, this->assembler.position());
+        for (auto jump : breaks)
+        {
+            this->assembler.patch(jump, this->assembler.position());
+        }
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        if (for_stmt->initializer.has_value())
+        {
+            for_stmt->initializer.value()->accept(this);
+        }
+
+        auto start = this->assembler.position();
+
+        std::optional<int> to_exit;
+        if (for_stmt->condition.has_value())
+        {
+            if (this->lower(for_stmt->condition.value().get()) != BirdType::BOOL)
+            {
+                throw JitUnsupported("a condition that is not a bool");
+            }
+
+            this->assembler.test();
+            to_exit = this->assembler.jump_if(Condition::EQUAL);
+        }
+
+        std::vector<int> breaks, continues;
+        this->loop(for_stmt->body.get(), breaks, continues);
+
+        for (auto jump : continues)
+        {
+            this->assembler.patch(jump, this->assembler.position());
+        }
+
+        if (for_stmt->increment.has_value())
+        {
+            for_stmt->increment.value()->accept(this);
+        }
+
+        this->assembler.jump_to(start);
+
+        if (to_exit.has_value())
+        {
+            this->assembler.patch(to_exit.value(), this->assembler.position());
+        }
+
+        for (auto jump : breaks)
+        {
+            this->assembler.patch(jump, this->assembler.position());
+        }
+    }
+
+    void visit_binary(Binary *binary)
+    {
+        auto left = this->lower(binary->left.get());
+        this->assembler.push(Register::RAX);
+        auto right = this->lower(binary->right.get());
+        this->assembler.pop(Register::RCX);
+
+        if (left != right)
+        {
+            throw JitUnsupported("a binary operator on an int and a bool");
+        }
+
+        auto condition = this->condition(binary->op.token_type);
+        if (condition.has_value())
+        {
+            if (left == BirdType::BOOL && condition != Condition::EQUAL && condition != Condition::NOT_EQUAL)
+            {
+                throw JitUnsupported("an ordering of bools");
+            }
+
+            this->assembler.compare(condition.value());
+            this->type = BirdType::BOOL;
+            return;
+        }
+
+        if (left != BirdType::INT)
+        {
+            throw JitUnsupported("arithmetic on bools");
+        }
+
+        this->arithmetic(binary->op.token_type);
+        this->type = BirdType::INT;
+    }
+
+    void visit_unary(Unary *unary)
+    {
+        if (this->lower(unary->expr.get()) != BirdType::INT)
+        {
+            throw JitUnsupported("a negated bool");
+        }
+
+        this->assembler.negate();
+        this->type = BirdType::INT;
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        switch (primary->value.token_type)
+        {
+        case Token::Type::INT_LITERAL:
+            this->assembler.load_immediate(std::stoi(primary->value.lexeme));
+            this->type = BirdType::INT;
+            break;
+        case Token::Type::BOOL_LITERAL:
+            this->assembler.load_immediate(primary->value.lexeme == "true");
+            this->type = BirdType::BOOL;
+            break;
+        case Token::Type::IDENTIFIER:
+            if (primary->slot < 0)
+            {
+                throw JitUnsupported("a read of " + primary->value.lexeme + ", which is not a local");
+            }
+
+            this->assembler.load_local(JitCompiler::offset(primary->slot));
+            this->type = this->slot_types[primary->slot];
+            break;
+        default:
+            throw JitUnsupported("the literal " + primary->value.lexeme);
+        }
+    }
+
+    void visit_ternary(Ternary *ternary)
+    {
+        if (this->lower(ternary->condition.get()) != BirdType::BOOL)
+        {
+            throw JitUnsupported("a condition that is not a bool");
+        }
+
+        this->assembler.test();
+        auto to_false = this->assembler.jump_if(Condition::EQUAL);
+        auto true_type = this->lower(ternary->true_expr.get());
+        auto to_end = this->assembler.jump();
+
+        this->assembler.patch(to_false, this->assembler.position());
+        if (this->lower(ternary->false_expr.get()) != true_type)
+        {
+            throw JitUnsupported("a ternary with branches of different types");
+        }
+
+        this->assembler.patch(to_end, this->assembler.position());
+        this->type = true_type;
+    }
+
+    void visit_func(Func *func)
+    {
+        throw JitUnsupported("a nested function");
+    }
+
+    void visit_call(Call *call)
+    {
+        auto name = call->identifier.lexeme;
+        if (!this->call_table->contains(name))
+        {
+            throw JitUnsupported("a call to " + name + " before it is declared");
+        }
+
+        auto callee = &this->call_table->get_reference(name);
+        if (callee != this->callable && !callee->native)
+        {
+            if (callee->jit_failed || this->compiling.count(callee))
+            {
+                throw JitUnsupported("a call to " + name + ", which cannot be compiled");
+            }
+
+            JitCompiler compiler(this->call_table);
+            compiler.compiling = this->compiling;
+            if (!compiler.compile(callee))
+            {
+                throw JitUnsupported("a call to " + name + ", which cannot be compiled: " + compiler.unsupported);
+            }
+        }
+
+        if (call->args.size() != callee->param_types.size())
+        {
+            throw JitUnsupported("a call to " + name + " with the wrong number of arguments");
+        }
+
+        for (int i = 0; i < call->args.size(); i++)
+        {
+            // the interpreter throws on an argument that needs a conversion
+            if (this->lower(call->args[i].get()) != callee->param_types[i])
+            {
+                throw JitUnsupported("a call to " + name + " with an argument of another type");
+            }
+
+            this->assembler.push(Register::RAX);
+        }
+
+        for (int i = call->args.size() - 1; i >= 0; i--)
+        {
+            this->assembler.pop(argument_registers[i]);
+        }
+
+        if (callee == this->callable)
+        {
+            this->assembler.call_relative(0);
+        }
+        else
+        {
+            this->assembler.call_absolute(callee->native->memory);
+        }
+
+        this->assembler.test_flag(&JitFunction::error());
+        this->exits.push_back(this->assembler.jump_if(Condition::NOT_EQUAL));
+
+        this->type = callee->resolved_return_type;
+    }
+
+    void visit_return_stmt(ReturnStmt *return_stmt)
+    {
+        if (!return_stmt->expr.has_value() || this->lower(return_stmt->expr.value().get()) != this->callable->resolved_return_type)
+        {
+            throw JitUnsupported("a return of another type");
+        }
+
+        this->exits.push_back(this->assembler.jump());
+    }
+
+    void visit_break_stmt(BreakStmt *break_stmt)
+    {
+        this->loops.back().first.push_back(this->assembler.jump());
+    }
+
+    void visit_continue_stmt(ContinueStmt *continue_stmt)
+    {
+        this->loops.back().second.push_back(this->assembler.jump());
+    }
+
+    void visit_type_stmt(TypeStmt *type_stmt)
+    {
+        throw JitUnsupported("a type declaration");
+    }
+};
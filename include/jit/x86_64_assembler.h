@@ -0,0 +1,254 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+/*
+ * The registers the JIT uses, numbered like their x86-64 encoding
+ */
+enum class Register
+{
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RSI = 6,
+    RDI = 7,
+    R8 = 8,
+    R9 = 9,
+};
+
+// the registers of the first six integer arguments in the System V calling convention
+static const Register argument_registers[] = {Register::RDI, Register::RSI, Register::RDX, Register::RCX, Register::R8, Register::R9};
+
+/*
+ * The condition codes of setcc and jcc
+ */
+enum class Condition
+{
+    EQUAL = 0x4,
+    NOT_EQUAL = 0x5,
+    LESS = 0xC,
+    GREATER_EQUAL = 0xD,
+    LESS_EQUAL = 0xE,
+    GREATER = 0xF,
+};
+
+/*
+ * Encodes the few x86-64 instructions the baseline JIT needs into a byte buffer.
+ *
+ * Values are 32 bit and computed in eax with ecx as the second operand, locals live
+ * in the stack frame below rbp. Jumps take a 32 bit displacement, the ones emitted
+ * before their target is known return the position to patch.
+ */
+class X86Assembler
+{
+public:
+    std::vector<uint8_t> code;
+
+    int position()
+    {
+        return this->code.size();
+    }
+
+    void bytes(std::initializer_list<uint8_t> values)
+    {
+        this->code.insert(this->code.end(), values);
+    }
+
+    void int32(int32_t value)
+    {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &value, 4);
+        this->code.insert(this->code.end(), bytes, bytes + 4);
+    }
+
+    void int64(int64_t value)
+    {
+        uint8_t bytes[8];
+        std::memcpy(bytes, &value, 8);
+        this->code.insert(this->code.end(), bytes, bytes + 8);
+    }
+
+    /*
+     * Points the 32 bit displacement at `at` to `target`
+     */
+    void patch(int at, int target)
+    {
+        int32_t displacement = target - (at + 4);
+        std::memcpy(&this->code[at], &displacement, 4);
+    }
+
+    // push rbp; mov rbp, rsp; sub rsp, frame_bytes
+    void prologue(int32_t frame_bytes)
+    {
+        this->bytes({0x55});
+        this->bytes({0x48, 0x89, 0xE5});
+        this->bytes({0x48, 0x81, 0xEC});
+        this->int32(frame_bytes);
+    }
+
+    // mov rsp, rbp; pop rbp; ret
+    void epilogue()
+    {
+        this->bytes({0x48, 0x89, 0xEC});
+        this->bytes({0x5D});
+        this->bytes({0xC3});
+    }
+
+    // mov eax, value
+    void load_immediate(int32_t value)
+    {
+        this->bytes({0xB8});
+        this->int32(value);
+    }
+
+    // mov eax, [rbp + offset]
+    void load_local(int32_t offset)
+    {
+        this->bytes({0x8B, 0x85});
+        this->int32(offset);
+    }
+
+    // mov [rbp + offset], the low 32 bits of reg
+    void store_local(int32_t offset, Register reg = Register::RAX)
+    {
+        auto number = (int)reg;
+        if (number >= 8)
+        {
+            this->bytes({0x44});
+        }
+
+        this->bytes({0x89, (uint8_t)(0x85 | ((number & 7) << 3))});
+        this->int32(offset);
+    }
+
+    void push(Register reg)
+    {
+        auto number = (int)reg;
+        if (number >= 8)
+        {
+            this->bytes({0x41});
+        }
+
+        this->bytes({(uint8_t)(0x50 + (number & 7))});
+    }
+
+    void pop(Register reg)
+    {
+        auto number = (int)reg;
+        if (number >= 8)
+        {
+            this->bytes({0x41});
+        }
+
+        this->bytes({(uint8_t)(0x58 + (number & 7))});
+    }
+
+    // eax = ecx + eax
+    void add()
+    {
+        this->bytes({0x01, 0xC8});
+    }
+
+    // eax = ecx - eax
+    void subtract()
+    {
+        this->bytes({0x29, 0xC1}); // sub ecx, eax
+        this->bytes({0x89, 0xC8}); // mov eax, ecx
+    }
+
+    // eax = ecx * eax
+    void multiply()
+    {
+        this->bytes({0x0F, 0xAF, 0xC1});
+    }
+
+    // eax = ecx / eax, or the remainder, the divisor is checked for zero before
+    void divide(bool remainder)
+    {
+        this->bytes({0x91});       // xchg eax, ecx
+        this->bytes({0x99});       // cdq
+        this->bytes({0xF7, 0xF9}); // idiv ecx
+
+        if (remainder)
+        {
+            this->bytes({0x89, 0xD0}); // mov eax, edx
+        }
+    }
+
+    // eax = -eax
+    void negate()
+    {
+        this->bytes({0xF7, 0xD8});
+    }
+
+    // eax = ecx <condition> eax
+    void compare(Condition condition)
+    {
+        this->bytes({0x39, 0xC1});                                  // cmp ecx, eax
+        this->bytes({0x0F, (uint8_t)(0x90 | (int)condition), 0xC0}); // setcc al
+        this->bytes({0x0F, 0xB6, 0xC0});                            // movzx eax, al
+    }
+
+    // test eax, eax
+    void test()
+    {
+        this->bytes({0x85, 0xC0});
+    }
+
+    int jump()
+    {
+        this->bytes({0xE9});
+        this->int32(0);
+
+        return this->position() - 4;
+    }
+
+    int jump_if(Condition condition)
+    {
+        this->bytes({0x0F, (uint8_t)(0x80 | (int)condition)});
+        this->int32(0);
+
+        return this->position() - 4;
+    }
+
+    void jump_to(int target)
+    {
+        this->patch(this->jump(), target);
+    }
+
+    // call a position of this code
+    void call_relative(int target)
+    {
+        this->bytes({0xE8});
+        this->int32(0);
+        this->patch(this->position() - 4, target);
+    }
+
+    // mov rax, address; call rax
+    void call_absolute(const void *address)
+    {
+        this->bytes({0x48, 0xB8});
+        this->int64((int64_t)(uintptr_t)address);
+        this->bytes({0xFF, 0xD0});
+    }
+
+    // mov rcx, address; mov dword [rcx], value
+    void store_flag(const int *address, int32_t value)
+    {
+        this->bytes({0x48, 0xB9});
+        this->int64((int64_t)(uintptr_t)address);
+        this->bytes({0xC7, 0x01});
+        this->int32(value);
+    }
+
+    // mov rcx, address; cmp dword [rcx], 0
+    void test_flag(const int *address)
+    {
+        this->bytes({0x48, 0xB9});
+        this->int64((int64_t)(uintptr_t)address);
+        this->bytes({0x83, 0x39, 0x00});
+    }
+};
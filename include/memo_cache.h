@@ -0,0 +1,83 @@
+#pragma once
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <optional>
+
+#include "value.h"
+
+/*
+ * Results of earlier calls to a pure function keyed by their arguments,
+ * holds at most `capacity` results and forgets the oldest one when full
+ */
+class MemoCache
+{
+public:
+    static const size_t default_capacity = 4096;
+
+    size_t capacity;
+    int hits = 0;
+    int misses = 0;
+    std::map<std::vector<uint64_t>, Value> results;
+    std::deque<std::vector<uint64_t>> order;
+
+    MemoCache(size_t capacity = default_capacity) : capacity(capacity) {}
+
+    /*
+     * Only calls with int, float and bool arguments are cached, their bits are the key
+     */
+    static bool is_cacheable(const Value *args, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (is_type<std::string>(args[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static std::vector<uint64_t> key(const Value *args, size_t count)
+    {
+        std::vector<uint64_t> key;
+        for (size_t i = 0; i < count; i++)
+        {
+            key.push_back(args[i].bits);
+        }
+
+        return key;
+    }
+
+    std::optional<Value> get(std::vector<uint64_t> &key)
+    {
+        auto found = this->results.find(key);
+        if (found == this->results.end())
+        {
+            this->misses++;
+            return std::nullopt;
+        }
+
+        this->hits++;
+        return found->second;
+    }
+
+    void put(std::vector<uint64_t> key, Value result)
+    {
+        if (this->capacity == 0 || this->results.count(key))
+        {
+            return;
+        }
+
+        if (this->results.size() >= this->capacity)
+        {
+            this->results.erase(this->order.front());
+            this->order.pop_front();
+        }
+
+        this->results[key] = result;
+        this->order.push_back(key);
+    }
+};
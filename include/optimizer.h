@@ -0,0 +1,101 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <iostream>
+
+#include "ast_node/index.h"
+#include "visitors/constant_folder.h"
+#include "visitors/const_evaluator.h"
+#include "visitors/function_specializer.h"
+#include "visitors/inliner.h"
+#include "visitors/tail_call_eliminator.h"
+#include "visitors/loop_invariant_code_motion.h"
+#include "visitors/common_subexpression_eliminator.h"
+#include "visitors/dead_code_eliminator.h"
+#include "visitors/range_analyzer.h"
+
+/*
+ * Runs the optimization passes over a type checked AST,
+ * the optimized AST can be given to either the interpreter or the code generator
+ */
+class Optimizer
+{
+public:
+    ConstEvaluator const_evaluator;
+    FunctionSpecializer function_specializer;
+    Inliner inliner;
+    TailCallEliminator tail_call_eliminator;
+    LoopInvariantCodeMotion loop_invariant_code_motion;
+    CommonSubexpressionEliminator common_subexpression_eliminator;
+    DeadCodeEliminator dead_code_eliminator;
+    RangeAnalyzer range_analyzer;
+
+    Optimizer(int inline_threshold = Inliner::default_inline_threshold,
+              int step_budget = ConstEvaluator::default_step_budget,
+              int specialize_budget = FunctionSpecializer::default_size_budget)
+        : const_evaluator(step_budget),
+          function_specializer(specialize_budget),
+          inliner(inline_threshold) {}
+
+    void optimize(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        ConstantFolder constant_folder;
+        constant_folder.fold_constants(stmts);
+
+        // constants computed at compile time fold into their uses
+        this->const_evaluator.evaluate_constants(stmts);
+        if (this->const_evaluator.evaluated_constants > 0)
+        {
+            ConstantFolder evaluated_folder;
+            evaluated_folder.fold_constants(stmts);
+        }
+
+        // specialized clones are folded as they are made
+        this->function_specializer.specialize_functions(stmts);
+
+        // inlined bodies can fold with their constant arguments
+        this->inliner.inline_calls(stmts);
+        if (this->inliner.inlined_calls > 0)
+        {
+            ConstantFolder inlined_folder;
+            inlined_folder.fold_constants(stmts);
+        }
+
+        this->tail_call_eliminator.eliminate_tail_calls(stmts);
+        this->loop_invariant_code_motion.move_loop_invariants(stmts);
+        this->common_subexpression_eliminator.eliminate_common_subexpressions(stmts);
+        this->dead_code_eliminator.eliminate_dead_code(stmts);
+
+        // marks the final AST, so it runs after every pass that rewrites it
+        this->range_analyzer.analyze_ranges(stmts);
+    }
+
+    void print_stats()
+    {
+        std::cout << "compile time evaluation:" << std::endl;
+        std::cout << "  evaluated constants: " << this->const_evaluator.evaluated_constants << std::endl;
+        std::cout << "  exhausted step budgets: " << this->const_evaluator.exhausted_budgets << std::endl;
+        std::cout << "function specialization:" << std::endl;
+        std::cout << "  specialized calls: " << this->function_specializer.specialized_calls << std::endl;
+        std::cout << "  clones: " << this->function_specializer.clones << std::endl;
+        std::cout << "inlining:" << std::endl;
+        std::cout << "  inlined calls: " << this->inliner.inlined_calls << std::endl;
+        std::cout << "tail call elimination:" << std::endl;
+        std::cout << "  eliminated calls: " << this->tail_call_eliminator.eliminated_calls << std::endl;
+        std::cout << "  functions turned into loops: " << this->tail_call_eliminator.transformed_functions << std::endl;
+        std::cout << "loop invariant code motion:" << std::endl;
+        std::cout << "  hoisted expressions: " << this->loop_invariant_code_motion.hoisted_expressions << std::endl;
+        std::cout << "common subexpression elimination:" << std::endl;
+        std::cout << "  eliminated expressions: " << this->common_subexpression_eliminator.eliminated_expressions << std::endl;
+        std::cout << "  temporaries: " << this->common_subexpression_eliminator.temporaries << std::endl;
+        std::cout << "dead code elimination:" << std::endl;
+        std::cout << "  removed branches: " << this->dead_code_eliminator.removed_branches << std::endl;
+        std::cout << "  removed unreachable statements: " << this->dead_code_eliminator.removed_unreachable << std::endl;
+        std::cout << "  removed declarations: " << this->dead_code_eliminator.removed_declarations << std::endl;
+        std::cout << "  removed functions: " << this->dead_code_eliminator.removed_functions << std::endl;
+        std::cout << "range analysis:" << std::endl;
+        std::cout << "  int operations: " << this->range_analyzer.int_operations << std::endl;
+        std::cout << "  nonzero divisors: " << this->range_analyzer.nonzero_divisors << std::endl;
+    }
+};
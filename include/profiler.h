@@ -0,0 +1,209 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "ast_node/index.h"
+
+/*
+ * Records where an interpreted program spends its time, set on the interpreter by --profile.
+ *
+ * Every call of a Func is timed, the time of its callees is subtracted for the exclusive
+ * time and recursive calls only add to the inclusive time of the outermost one. Executed
+ * statements are counted per source line, numbered from 1. The exclusive times are also
+ * summed per call stack, printed as the collapsed stacks flame graph tools read, with the
+ * top level code as the root frame.
+ */
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct FunctionProfile
+    {
+        long calls = 0;
+        Clock::duration inclusive = Clock::duration::zero();
+        Clock::duration exclusive = Clock::duration::zero();
+        int active = 0; // calls on the stack, recursive calls nest inside the outermost
+    };
+
+    struct Frame
+    {
+        std::string name;
+        Clock::time_point start;
+        Clock::duration callees;
+        size_t path_size; // the length of the collapsed stack before this frame
+    };
+
+    std::map<std::string, FunctionProfile> functions;
+    std::map<unsigned int, long> lines;
+    std::map<std::string, Clock::duration> stacks;
+    std::unordered_map<Stmt *, int> statement_lines;
+
+    std::vector<Frame> frames;
+    std::string path;
+
+    Profiler()
+    {
+        this->enter("<main>");
+    }
+
+    void enter(const std::string &name)
+    {
+        auto &function = this->functions[name];
+        function.calls++;
+        function.active++;
+
+        this->frames.push_back({name, Clock::now(), Clock::duration::zero(), this->path.size()});
+        this->path += this->path.empty() ? name : ";" + name;
+    }
+
+    void exit()
+    {
+        auto frame = this->frames.back();
+        this->frames.pop_back();
+
+        auto elapsed = Clock::now() - frame.start;
+        auto &function = this->functions[frame.name];
+        function.exclusive += elapsed - frame.callees;
+        if (--function.active == 0)
+        {
+            function.inclusive += elapsed;
+        }
+
+        this->stacks[this->path] += elapsed - frame.callees;
+        this->path.resize(frame.path_size);
+
+        if (!this->frames.empty())
+        {
+            this->frames.back().callees += elapsed;
+        }
+    }
+
+    /*
+     * Ends the calls an error left open and the top level code
+     */
+    void finish()
+    {
+        while (!this->frames.empty())
+        {
+            this->exit();
+        }
+    }
+
+    void line(Stmt *stmt)
+    {
+        auto found = this->statement_lines.find(stmt);
+        if (found == this->statement_lines.end())
+        {
+            found = this->statement_lines.insert({stmt, Profiler::line_of(stmt)}).first;
+        }
+
+        if (found->second >= 0)
+        {
+            this->lines[found->second + 1]++;
+        }
+    }
+
+    static int line_of(Expr *expr)
+    {
+        if (auto binary = dynamic_cast<Binary *>(expr))
+            return Profiler::line_of(binary->left.get());
+        if (auto unary = dynamic_cast<Unary *>(expr))
+            return unary->op.line_num;
+        if (auto primary = dynamic_cast<Primary *>(expr))
+            return primary->value.line_num;
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+            return Profiler::line_of(ternary->condition.get());
+        if (auto call = dynamic_cast<Call *>(expr))
+            return call->identifier.line_num;
+        if (auto assign_expr = dynamic_cast<AssignExpr *>(expr))
+            return assign_expr->identifier.line_num;
+
+        return -1;
+    }
+
+    // the line a statement starts on, -1 for a block, whose statements are counted themselves
+    static int line_of(Stmt *stmt)
+    {
+        if (auto decl_stmt = dynamic_cast<DeclStmt *>(stmt))
+            return decl_stmt->identifier.line_num;
+        if (auto const_stmt = dynamic_cast<ConstStmt *>(stmt))
+            return const_stmt->identifier.line_num;
+        if (auto expr_stmt = dynamic_cast<ExprStmt *>(stmt))
+            return Profiler::line_of(expr_stmt->expr.get());
+        if (auto print_stmt = dynamic_cast<PrintStmt *>(stmt))
+            return print_stmt->args.empty() ? -1 : Profiler::line_of(print_stmt->args[0].get());
+        if (auto if_stmt = dynamic_cast<IfStmt *>(stmt))
+            return if_stmt->if_token.line_num;
+        if (auto while_stmt = dynamic_cast<WhileStmt *>(stmt))
+            return while_stmt->while_token.line_num;
+        if (auto for_stmt = dynamic_cast<ForStmt *>(stmt))
+            return for_stmt->for_token.line_num;
+        if (auto return_stmt = dynamic_cast<ReturnStmt *>(stmt))
+            return return_stmt->return_token.line_num;
+        if (auto break_stmt = dynamic_cast<BreakStmt *>(stmt))
+            return break_stmt->break_token.line_num;
+        if (auto continue_stmt = dynamic_cast<ContinueStmt *>(stmt))
+            return continue_stmt->continue_token.line_num;
+        if (auto func = dynamic_cast<Func *>(stmt))
+            return func->identifier.line_num;
+        if (auto type_stmt = dynamic_cast<TypeStmt *>(stmt))
+            return type_stmt->identifier.line_num;
+
+        return -1;
+    }
+
+    static double milliseconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    /*
+     * The functions by exclusive time and the executed lines in source order
+     */
+    void report(std::ostream &out)
+    {
+        std::vector<std::pair<std::string, FunctionProfile>> functions(this->functions.begin(), this->functions.end());
+        std::stable_sort(functions.begin(), functions.end(), [](auto &left, auto &right)
+                         { return left.second.exclusive > right.second.exclusive; });
+
+        out << "profile:" << std::endl;
+        out << std::left << std::setw(24) << "  function" << std::right
+            << std::setw(12) << "calls" << std::setw(18) << "inclusive (ms)" << std::setw(18) << "exclusive (ms)" << std::endl;
+
+        out << std::fixed << std::setprecision(3);
+        for (auto &[name, function] : functions)
+        {
+            out << "  " << std::left << std::setw(22) << name << std::right
+                << std::setw(12) << function.calls
+                << std::setw(18) << Profiler::milliseconds(function.inclusive)
+                << std::setw(18) << Profiler::milliseconds(function.exclusive) << std::endl;
+        }
+        out << std::defaultfloat;
+
+        out << std::left << std::setw(24) << "  line" << std::right << std::setw(12) << "executions" << std::endl;
+        for (auto &[line, count] : this->lines)
+        {
+            out << "  " << std::left << std::setw(22) << line << std::right << std::setw(12) << count << std::endl;
+        }
+    }
+
+    /*
+     * One `frame;frame;frame microseconds` line per call stack
+     */
+    void write_collapsed(std::ostream &out)
+    {
+        for (auto &[stack, duration] : this->stacks)
+        {
+            out << stack << " " << std::chrono::duration_cast<std::chrono::microseconds>(duration).count() << std::endl;
+        }
+    }
+};
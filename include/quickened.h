@@ -0,0 +1,14 @@
+#pragma once
+
+/*
+ * The operand types an expression node specialized itself for when the
+ * interpreter first ran it. A node whose guard fails once goes back to the
+ * generic operators for good.
+ */
+enum class Quickened
+{
+    NOT_YET,
+    INT,
+    FLOAT,
+    GENERIC,
+};
@@ -88,6 +88,20 @@ public:
         throw BirdException("cannot set undefined identifier in environment: " + identifier);
     }
 
+    T &get_reference(std::string identifier)
+    {
+        for (auto it = envs.rbegin(); it != envs.rend(); it++)
+        {
+            auto found = (*it).find(identifier);
+            if (found != (*it).end())
+            {
+                return found->second;
+            }
+        }
+
+        throw BirdException("cannot get undefined identifier in environment: " + identifier);
+    }
+
     T get(std::string identifier)
     {
         if (envs.empty())
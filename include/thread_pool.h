@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <optional>
+
+/*
+ * A pool of worker threads that runs a batch of independent tasks.
+ * Each worker owns a deque of tasks and works through it from the front,
+ * when it runs dry it steals from the back of another worker's deque
+ */
+class WorkStealingPool
+{
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    unsigned int thread_count;
+
+    std::optional<std::function<void()>> pop(WorkQueue &queue)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+        {
+            return std::nullopt;
+        }
+
+        auto task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return task;
+    }
+
+    std::optional<std::function<void()>> steal(WorkQueue &queue)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+        {
+            return std::nullopt;
+        }
+
+        auto task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return task;
+    }
+
+    void work(std::vector<std::unique_ptr<WorkQueue>> &queues, unsigned int worker)
+    {
+        while (true)
+        {
+            auto task = this->pop(*queues[worker]);
+
+            // no task is ever enqueued after the batch starts,
+            // so once every queue is empty the worker is done
+            for (unsigned int i = 1; !task.has_value() && i < queues.size(); i++)
+            {
+                task = this->steal(*queues[(worker + i) % queues.size()]);
+            }
+
+            if (!task.has_value())
+            {
+                return;
+            }
+
+            task.value()();
+        }
+    }
+
+public:
+    WorkStealingPool(unsigned int thread_count) : thread_count(thread_count == 0 ? 1 : thread_count) {}
+
+    /*
+     * Runs every task and returns once all of them have finished,
+     * tasks are dealt out to the workers in contiguous chunks
+     */
+    void run(std::vector<std::function<void()>> tasks)
+    {
+        unsigned int worker_count = std::min<size_t>(this->thread_count, tasks.size());
+
+        if (worker_count <= 1)
+        {
+            for (auto &task : tasks)
+            {
+                task();
+            }
+
+            return;
+        }
+
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        for (unsigned int i = 0; i < worker_count; i++)
+        {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+
+        for (size_t i = 0; i < tasks.size(); i++)
+        {
+            queues[i * worker_count / tasks.size()]->tasks.push_back(std::move(tasks[i]));
+        }
+
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < worker_count; i++)
+        {
+            workers.emplace_back([this, &queues, i]()
+                                 { this->work(queues, i); });
+        }
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+};
@@ -1,39 +1,170 @@
 #pragma once
 #include <variant>
 #include <string>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <ostream>
+#include <type_traits>
 
 #include "exceptions/bird_exception.h"
+#include "bird_string.h"
 
 class Value;
 
 template <typename T>
-inline bool is_type(Value value);
+inline bool is_type(const Value &value);
 
-inline bool is_numeric(Value value);
+inline bool is_numeric(const Value &value);
 
 template <typename T>
-inline bool is_matching_type(Value left, Value right);
+inline bool is_matching_type(const Value &left, const Value &right);
 
 template <typename T>
-inline T as_type(Value value);
+inline T as_type(const Value &value);
 
 template <typename T, typename U>
-inline T to_type(Value value);
-
-using variant = std::variant<int, double, std::string, bool>;
+inline T to_type(const Value &value);
+
+/*
+ * A Bird runtime value packed into one 64 bit word with NaN-boxing.
+ *
+ * A float is stored as its own bits and every NaN as the same quiet NaN, which leaves
+ * the negative quiet NaNs free for the other types: the top 16 bits are a tag and the
+ * low bits hold the int, the bool or the pointer to the shared BirdString. Mutability
+ * is not stored, the semantic analyzer checks it before anything runs.
+ */
 class Value
 {
 public:
-    variant data;
-    bool is_mutable;
+    uint64_t bits;
+
+    static constexpr uint64_t TAG_MASK = 0xFFFF000000000000;
+    static constexpr uint64_t INT_TAG = 0xFFF9000000000000;
+    static constexpr uint64_t BOOL_TAG = 0xFFFA000000000000;
+    static constexpr uint64_t STRING_TAG = 0xFFFB000000000000;
+    static constexpr uint64_t PAYLOAD_MASK = 0x0000FFFFFFFFFFFF;
+    static constexpr uint64_t CANONICAL_NAN = 0x7FF8000000000000;
+
+    Value() : bits(INT_TAG) {}
+    Value(int value) : bits(INT_TAG | (uint32_t)value) {}
+    Value(bool value) : bits(BOOL_TAG | (uint64_t)value) {}
+    Value(double value) : bits(CANONICAL_NAN)
+    {
+        if (!std::isnan(value))
+        {
+            std::memcpy(&this->bits, &value, sizeof(double));
+        }
+    }
+    Value(std::string value) : bits(STRING_TAG | (uint64_t)(uintptr_t) new BirdString(std::move(value))) {}
+    Value(const char *value) : Value(std::string(value)) {}
+    Value(BirdString *string) : bits(STRING_TAG | (uint64_t)(uintptr_t)string)
+    {
+        string->references++;
+    }
+
+    Value(const Value &other) : bits(other.bits)
+    {
+        if (this->is_string())
+        {
+            this->string()->references++;
+        }
+    }
+    Value(Value &&other) : bits(other.release()) {}
+
+    ~Value()
+    {
+        if (this->is_string() && --this->string()->references == 0)
+        {
+            delete this->string();
+        }
+    }
 
-    Value(variant data, bool is_mutable = false) : data(std::move(data)), is_mutable(is_mutable) {}
-    Value() = default;
+    /*
+     * A string value for a literal, every copy of the same literal shares one BirdString
+     */
+    static Value intern(const std::string &text)
+    {
+        return Value(BirdString::intern(text));
+    }
+
+    Value &operator=(const Value &right)
+    {
+        if (this != &right)
+        {
+            *this = Value(right);
+        }
+
+        return *this;
+    }
 
-    Value operator+(Value right)
+    Value &operator=(Value &&right)
+    {
+        if (this != &right)
+        {
+            this->~Value();
+            this->bits = right.release();
+        }
+
+        return *this;
+    }
+
+    bool is_int() const { return (this->bits & TAG_MASK) == INT_TAG; }
+    bool is_bool() const { return (this->bits & TAG_MASK) == BOOL_TAG; }
+    bool is_string() const { return (this->bits & TAG_MASK) == STRING_TAG; }
+    bool is_double() const { return (this->bits >> 48) < (INT_TAG >> 48); }
+
+    int as_int() const { return (int32_t)(uint32_t)this->bits; }
+    bool as_bool() const { return this->bits & 1; }
+    const std::string &as_string() const { return this->string()->text; }
+    double as_double() const
+    {
+        double value;
+        std::memcpy(&value, &this->bits, sizeof(double));
+        return value;
+    }
+
+    /*
+     * this + right for two strings, appends in place when this value holds
+     * the only reference to its string
+     */
+    void append(const Value &right)
+    {
+        auto string = this->string();
+        if (string->references == 1 && !string->interned)
+        {
+            string->append(right.as_string());
+            return;
+        }
+
+        *this = Value(this->as_string() + right.as_string());
+    }
+
+    /*
+     * The position of the type in int, float, string, bool
+     */
+    int index() const
+    {
+        if (this->is_double())
+        {
+            return 1;
+        }
+
+        switch (this->bits & TAG_MASK)
+        {
+        case INT_TAG:
+            return 0;
+        case STRING_TAG:
+            return 2;
+        default:
+            return 3;
+        }
+    }
+
+    Value operator+(const Value &right) const
     {
         if (is_matching_type<std::string>(*this, right))
-            return Value(as_type<std::string>(*this) + as_type<std::string>(right));
+            return Value(this->as_string() + right.as_string());
 
         if (!is_numeric(*this) || !is_numeric(right))
         {
@@ -53,7 +184,7 @@ public:
         return Value(left_val + right_val);
     }
 
-    Value operator-(Value right)
+    Value operator-(const Value &right) const
     {
         if (!is_numeric(*this) || !is_numeric(right))
         {
@@ -73,7 +204,7 @@ public:
         return Value(left_val - right_val);
     }
 
-    Value operator*(Value right)
+    Value operator*(const Value &right) const
     {
         if (!is_numeric(*this) || !is_numeric(right))
         {
@@ -93,7 +224,7 @@ public:
         return Value(left_val * right_val);
     }
 
-    Value operator/(Value right)
+    Value operator/(const Value &right) const
     {
         if (to_type<double, int>(right) == 0)
             throw BirdException("Division by zero.");
@@ -116,7 +247,7 @@ public:
         return Value(left_val / right_val);
     }
 
-    Value operator%(Value right)
+    Value operator%(const Value &right) const
     {
         if (to_type<double, int>(right) == 0)
             throw BirdException("Modulo by zero.");
@@ -131,7 +262,7 @@ public:
         return Value(left_val % right_val);
     }
 
-    Value operator>(Value right)
+    Value operator>(const Value &right) const
     {
         if (!is_numeric(*this) || !is_numeric(right))
         {
@@ -151,7 +282,7 @@ public:
         return Value(left_val > right_val);
     }
 
-    Value operator>=(Value right)
+    Value operator>=(const Value &right) const
     {
         if (!is_numeric(*this) || !is_numeric(right))
         {
@@ -171,7 +302,7 @@ public:
         return Value(left_val >= right_val);
     }
 
-    Value operator<(Value right)
+    Value operator<(const Value &right) const
     {
         if (is_type<int>(*this) && is_numeric(right))
             return Value(as_type<int>(*this) < to_type<int, double>(right));
@@ -182,7 +313,7 @@ public:
         throw BirdException("The '<' binary operator could not be used to interpret these values.");
     }
 
-    Value operator<=(Value right)
+    Value operator<=(const Value &right) const
     {
         if (is_type<int>(*this) && is_numeric(right))
             return Value(as_type<int>(*this) <= to_type<int, double>(right));
@@ -193,7 +324,7 @@ public:
         throw BirdException("The '<=' binary operator could not be used to interpret these values.");
     }
 
-    Value operator!=(Value right)
+    Value operator!=(const Value &right) const
     {
         if (is_numeric(*this) && is_numeric(right))
         {
@@ -204,7 +335,7 @@ public:
         }
 
         if (is_type<std::string>(*this) && is_type<std::string>(right))
-            return Value(as_type<std::string>(*this) != as_type<std::string>(right));
+            return Value(!this->string()->equals(right.string()));
 
         if (is_type<bool>(*this) && is_type<bool>(right))
             return Value(as_type<bool>(*this) != as_type<bool>(right));
@@ -212,7 +343,7 @@ public:
         throw BirdException("The '!=' binary operator could not be used to interpret these values.");
     }
 
-    Value operator==(Value right)
+    Value operator==(const Value &right) const
     {
         if (is_numeric(*this) && is_numeric(right))
         {
@@ -223,7 +354,7 @@ public:
         }
 
         if (is_type<std::string>(*this) && is_type<std::string>(right))
-            return Value(as_type<std::string>(*this) == as_type<std::string>(right));
+            return Value(this->string()->equals(right.string()));
 
         if (is_type<bool>(*this) && is_type<bool>(right))
             return Value(as_type<bool>(*this) == as_type<bool>(right));
@@ -231,7 +362,7 @@ public:
         throw BirdException("The '==' binary operator could not be used to interpret these values.");
     }
 
-    Value operator!()
+    Value operator!() const
     {
         if (is_type<bool>(*this))
             return Value(!as_type<bool>(*this));
@@ -239,7 +370,7 @@ public:
         throw BirdException("The '!' unary operator could not be used to interpret these values.");
     }
 
-    Value operator-()
+    Value operator-() const
     {
         if (is_type<int>(*this))
             return Value(-as_type<int>(*this));
@@ -250,17 +381,6 @@ public:
         throw BirdException("The '-' unary operator could not be used to interpret these values.");
     }
 
-    Value &operator=(const Value &right)
-    {
-        if (this != &right)
-        {
-            this->data = right.data;
-            this->is_mutable = this->is_mutable ? true : right.is_mutable;
-        }
-
-        return *this;
-    }
-
     friend std::ostream &operator<<(std::ostream &os, const Value &obj)
     {
         if (is_type<int>(obj))
@@ -270,40 +390,75 @@ public:
             os << as_type<double>(obj);
 
         else if (is_type<std::string>(obj))
-            os << as_type<std::string>(obj);
+            os << obj.as_string();
 
         else if (is_type<bool>(obj))
             os << as_type<bool>(obj);
 
         return os;
     }
+
+private:
+    /*
+     * Gives up the reference this value holds, leaving a 0
+     */
+    uint64_t release()
+    {
+        auto bits = this->bits;
+        this->bits = INT_TAG;
+        return bits;
+    }
+
+    BirdString *string() const
+    {
+        return (BirdString *)(uintptr_t)(this->bits & PAYLOAD_MASK);
+    }
 };
 
+static_assert(sizeof(Value) == 8, "a Value is one 64 bit word");
+
 template <typename T>
-inline bool is_type(Value value)
+inline bool is_type(const Value &value)
 {
-    return std::holds_alternative<T>(value.data);
+    if constexpr (std::is_same_v<T, int>)
+        return value.is_int();
+    else if constexpr (std::is_same_v<T, double>)
+        return value.is_double();
+    else if constexpr (std::is_same_v<T, std::string>)
+        return value.is_string();
+    else
+        return value.is_bool();
 }
 
-inline bool is_numeric(Value value)
+inline bool is_numeric(const Value &value)
 {
-    return is_type<int>(value) || is_type<double>(value);
+    return value.is_int() || value.is_double();
 }
 
 template <typename T>
-inline bool is_matching_type(Value left, Value right)
+inline bool is_matching_type(const Value &left, const Value &right)
 {
     return is_type<T>(left) && is_type<T>(right);
 }
 
 template <typename T>
-inline T as_type(Value value)
+inline T as_type(const Value &value)
 {
-    return std::get<T>(value.data);
+    if (!is_type<T>(value))
+        throw std::bad_variant_access();
+
+    if constexpr (std::is_same_v<T, int>)
+        return value.as_int();
+    else if constexpr (std::is_same_v<T, double>)
+        return value.as_double();
+    else if constexpr (std::is_same_v<T, std::string>)
+        return value.as_string();
+    else
+        return value.as_bool();
 }
 
 template <typename T, typename U>
-inline T to_type(Value value)
+inline T to_type(const Value &value)
 {
     return is_type<T>(value) ? as_type<T>(value) : static_cast<T>(as_type<U>(value));
 }
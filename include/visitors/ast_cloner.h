@@ -0,0 +1,179 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <optional>
+
+#include "ast_node/index.h"
+#include "exceptions/bird_exception.h"
+
+/*
+ * Makes deep copies of AST nodes, for passes that need
+ * a second copy of code they do not own
+ */
+class AstCloner
+{
+public:
+    int nodes = 0; // the number of nodes copied so far
+
+    std::unique_ptr<Expr> clone(Expr *expr)
+    {
+        this->nodes += 1;
+
+        if (auto binary = dynamic_cast<Binary *>(expr))
+        {
+            return std::make_unique<Binary>(this->clone(binary->left.get()), binary->op, this->clone(binary->right.get()));
+        }
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+        {
+            return std::make_unique<Unary>(unary->op, this->clone(unary->expr.get()));
+        }
+
+        if (auto primary = dynamic_cast<Primary *>(expr))
+        {
+            return std::make_unique<Primary>(primary->value);
+        }
+
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+        {
+            return std::make_unique<Ternary>(
+                this->clone(ternary->condition.get()),
+                ternary->ternary_token,
+                this->clone(ternary->true_expr.get()),
+                this->clone(ternary->false_expr.get()));
+        }
+
+        if (auto call = dynamic_cast<Call *>(expr))
+        {
+            std::vector<std::shared_ptr<Expr>> args;
+            for (auto &arg : call->args)
+            {
+                args.push_back(this->clone(arg.get()));
+            }
+
+            return std::make_unique<Call>(call->identifier, std::move(args));
+        }
+
+        if (auto assign_expr = dynamic_cast<AssignExpr *>(expr))
+        {
+            return std::make_unique<AssignExpr>(assign_expr->identifier, assign_expr->assign_operator, this->clone(assign_expr->value.get()));
+        }
+
+        throw BirdException("can not clone expression");
+    }
+
+    std::unique_ptr<Stmt> clone(Stmt *stmt)
+    {
+        this->nodes += 1;
+
+        if (auto block = dynamic_cast<Block *>(stmt))
+        {
+            std::vector<std::unique_ptr<Stmt>> stmts;
+            for (auto &child : block->stmts)
+            {
+                stmts.push_back(this->clone(child.get()));
+            }
+
+            return std::make_unique<Block>(std::move(stmts));
+        }
+
+        if (auto decl_stmt = dynamic_cast<DeclStmt *>(stmt))
+        {
+            return std::make_unique<DeclStmt>(decl_stmt->identifier, decl_stmt->type_token, decl_stmt->type_is_literal, this->clone(decl_stmt->value.get()));
+        }
+
+        if (auto const_stmt = dynamic_cast<ConstStmt *>(stmt))
+        {
+            return std::make_unique<ConstStmt>(const_stmt->identifier, const_stmt->type_token, const_stmt->type_is_literal, this->clone(const_stmt->value.get()));
+        }
+
+        if (auto expr_stmt = dynamic_cast<ExprStmt *>(stmt))
+        {
+            return std::make_unique<ExprStmt>(this->clone(expr_stmt->expr.get()));
+        }
+
+        if (auto print_stmt = dynamic_cast<PrintStmt *>(stmt))
+        {
+            std::vector<std::unique_ptr<Expr>> args;
+            for (auto &arg : print_stmt->args)
+            {
+                args.push_back(this->clone(arg.get()));
+            }
+
+            return std::make_unique<PrintStmt>(std::move(args));
+        }
+
+        if (auto while_stmt = dynamic_cast<WhileStmt *>(stmt))
+        {
+            return std::make_unique<WhileStmt>(while_stmt->while_token, this->clone(while_stmt->condition.get()), this->clone(while_stmt->stmt.get()));
+        }
+
+        if (auto for_stmt = dynamic_cast<ForStmt *>(stmt))
+        {
+            std::optional<std::unique_ptr<Stmt>> initializer;
+            if (for_stmt->initializer.has_value())
+            {
+                initializer = this->clone(for_stmt->initializer.value().get());
+            }
+
+            std::optional<std::unique_ptr<Expr>> condition;
+            if (for_stmt->condition.has_value())
+            {
+                condition = this->clone(for_stmt->condition.value().get());
+            }
+
+            std::optional<std::unique_ptr<Expr>> increment;
+            if (for_stmt->increment.has_value())
+            {
+                increment = this->clone(for_stmt->increment.value().get());
+            }
+
+            return std::make_unique<ForStmt>(for_stmt->for_token, std::move(initializer), std::move(condition), std::move(increment), this->clone(for_stmt->body.get()));
+        }
+
+        if (auto if_stmt = dynamic_cast<IfStmt *>(stmt))
+        {
+            std::optional<std::unique_ptr<Stmt>> else_branch;
+            if (if_stmt->else_branch.has_value())
+            {
+                else_branch = this->clone(if_stmt->else_branch.value().get());
+            }
+
+            return std::make_unique<IfStmt>(if_stmt->if_token, this->clone(if_stmt->condition.get()), this->clone(if_stmt->then_branch.get()), std::move(else_branch));
+        }
+
+        if (auto func = dynamic_cast<Func *>(stmt))
+        {
+            return std::make_unique<Func>(func->identifier, func->return_type, func->param_list, this->clone(func->block.get()));
+        }
+
+        if (auto return_stmt = dynamic_cast<ReturnStmt *>(stmt))
+        {
+            std::optional<std::unique_ptr<Expr>> expr;
+            if (return_stmt->expr.has_value())
+            {
+                expr = this->clone(return_stmt->expr.value().get());
+            }
+
+            return std::make_unique<ReturnStmt>(return_stmt->return_token, std::move(expr));
+        }
+
+        if (auto break_stmt = dynamic_cast<BreakStmt *>(stmt))
+        {
+            return std::make_unique<BreakStmt>(break_stmt->break_token);
+        }
+
+        if (auto continue_stmt = dynamic_cast<ContinueStmt *>(stmt))
+        {
+            return std::make_unique<ContinueStmt>(continue_stmt->continue_token);
+        }
+
+        if (auto type_stmt = dynamic_cast<TypeStmt *>(stmt))
+        {
+            return std::make_unique<TypeStmt>(type_stmt->identifier, type_stmt->type_token, type_stmt->type_is_literal);
+        }
+
+        throw BirdException("can not clone statement");
+    }
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "ast_node/index.h"
+
+/*
+ * Visitor that walks every node of the AST and does nothing else,
+ * analyses that only care about a few kinds of nodes inherit from it
+ * and override those visits
+ */
+class AstWalker : public Visitor
+{
+public:
+    void walk(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        for (auto &stmt : *stmts)
+        {
+            stmt->accept(this);
+        }
+    }
+
+    virtual void visit_block(Block *block)
+    {
+        for (auto &stmt : block->stmts)
+        {
+            stmt->accept(this);
+        }
+    }
+
+    virtual void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        decl_stmt->value->accept(this);
+    }
+
+    virtual void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        assign_expr->value->accept(this);
+    }
+
+    virtual void visit_expr_stmt(ExprStmt *expr_stmt)
+    {
+        expr_stmt->expr->accept(this);
+    }
+
+    virtual void visit_print_stmt(PrintStmt *print_stmt)
+    {
+        for (auto &arg : print_stmt->args)
+        {
+            arg->accept(this);
+        }
+    }
+
+    virtual void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        const_stmt->value->accept(this);
+    }
+
+    virtual void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        while_stmt->condition->accept(this);
+        while_stmt->stmt->accept(this);
+    }
+
+    virtual void visit_for_stmt(ForStmt *for_stmt)
+    {
+        if (for_stmt->initializer.has_value())
+        {
+            for_stmt->initializer.value()->accept(this);
+        }
+
+        if (for_stmt->condition.has_value())
+        {
+            for_stmt->condition.value()->accept(this);
+        }
+
+        for_stmt->body->accept(this);
+
+        if (for_stmt->increment.has_value())
+        {
+            for_stmt->increment.value()->accept(this);
+        }
+    }
+
+    virtual void visit_binary(Binary *binary)
+    {
+        binary->left->accept(this);
+        binary->right->accept(this);
+    }
+
+    virtual void visit_unary(Unary *unary)
+    {
+        unary->expr->accept(this);
+    }
+
+    virtual void visit_primary(Primary *primary)
+    {
+        // do nothing
+    }
+
+    virtual void visit_ternary(Ternary *ternary)
+    {
+        ternary->condition->accept(this);
+        ternary->true_expr->accept(this);
+        ternary->false_expr->accept(this);
+    }
+
+    virtual void visit_func(Func *func)
+    {
+        func->block->accept(this);
+    }
+
+    virtual void visit_if_stmt(IfStmt *if_stmt)
+    {
+        if_stmt->condition->accept(this);
+        if_stmt->then_branch->accept(this);
+
+        if (if_stmt->else_branch.has_value())
+        {
+            if_stmt->else_branch.value()->accept(this);
+        }
+    }
+
+    virtual void visit_call(Call *call)
+    {
+        for (auto &arg : call->args)
+        {
+            arg->accept(this);
+        }
+    }
+
+    virtual void visit_return_stmt(ReturnStmt *return_stmt)
+    {
+        if (return_stmt->expr.has_value())
+        {
+            return_stmt->expr.value()->accept(this);
+        }
+    }
+
+    virtual void visit_break_stmt(BreakStmt *break_stmt)
+    {
+        // do nothing
+    }
+
+    virtual void visit_continue_stmt(ContinueStmt *continue_stmt)
+    {
+        // do nothing
+    }
+
+    virtual void visit_type_stmt(TypeStmt *type_stmt)
+    {
+        // do nothing
+    }
+};
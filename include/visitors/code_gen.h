@@ -3,6 +3,8 @@
 #include <fstream>
 #include <ios>
 
+#include "ir/ir.h"
+
 enum CodeGenType
 {
     CodeGenInt,
@@ -77,6 +79,8 @@ public:
                                     // js to identify a string by a higher
                                     // offset, will fix tomorrow
     BinaryenModuleRef mod;
+    std::vector<uint8_t> binary; // the module write_module serialized
+    bool write_file = true;      // prints the module and writes output.wasm, off when the binary is run in process
 
     ~CodeGen()
     {
@@ -299,7 +303,17 @@ public:
             "main",
             "main");
 
-        BinaryenModulePrint(this->mod);
+        this->write_module();
+
+        // this->environment.pop_env();
+    }
+
+    void write_module()
+    {
+        if (this->write_file)
+        {
+            BinaryenModulePrint(this->mod);
+        }
 
         BinaryenModuleAllocateAndWriteResult result =
             BinaryenModuleAllocateAndWrite(this->mod, nullptr);
@@ -310,6 +324,15 @@ public:
             return;
         }
 
+        auto bytes = static_cast<uint8_t *>(result.binary);
+        this->binary.assign(bytes, bytes + result.binaryBytes);
+
+        if (!this->write_file)
+        {
+            free(result.binary);
+            return;
+        }
+
         std::string filename = "output.wasm";
         std::ofstream file(filename, std::ios::binary);
         if (file.is_open())
@@ -324,8 +347,308 @@ public:
         }
 
         free(result.binary);
+    }
 
-        // this->environment.pop_env();
+    /*
+     * Generates the module from the Bird IR instead of the AST.
+     *
+     * Every SSA value is stored in its own local and the relooper rebuilds structured
+     * control flow from the basic blocks. Each phi also gets an incoming local that
+     * its predecessors copy their operand into on the edge, the phi reads it when
+     * its block is entered so phis of the same block cannot overwrite each other.
+     */
+    void generate(IrModule *module)
+    {
+        this->init_std_lib();
+
+        for (auto &function : module->functions)
+        {
+            this->generate_function(function);
+        }
+
+        this->init_static_memory(this->mod);
+        this->write_module();
+    }
+
+    void generate_function(IrFunction &function)
+    {
+        std::vector<BinaryenType> locals;
+        for (auto param : function.params)
+        {
+            locals.push_back(from_ir_type(param));
+        }
+
+        std::vector<BinaryenIndex> value_locals(function.value_types.size());
+        for (int value = 0; value < function.value_types.size(); value++)
+        {
+            value_locals[value] = locals.size();
+            locals.push_back(from_ir_type(function.value_types[value]));
+        }
+
+        std::map<int, BinaryenIndex> incoming_locals;
+        for (auto &block : function.blocks)
+        {
+            for (auto &phi : block.phis)
+            {
+                incoming_locals[phi.result] = locals.size();
+                locals.push_back(from_ir_type(phi.type));
+            }
+        }
+
+        BinaryenIndex label_helper = locals.size();
+        locals.push_back(BinaryenTypeInt32());
+
+        RelooperRef relooper = RelooperCreate(this->mod);
+        std::vector<RelooperBlockRef> relooper_blocks;
+
+        for (auto &block : function.blocks)
+        {
+            std::vector<BinaryenExpressionRef> code;
+            for (auto &phi : block.phis)
+            {
+                code.push_back(
+                    BinaryenLocalSet(
+                        this->mod,
+                        value_locals[phi.result],
+                        BinaryenLocalGet(this->mod, incoming_locals[phi.result], from_ir_type(phi.type))));
+            }
+
+            for (auto &instruction : block.instructions)
+            {
+                code.push_back(this->generate_instruction(function, instruction, value_locals));
+            }
+
+            auto &terminator = block.terminator;
+            if (terminator.kind == IrTerminatorKind::RETURN)
+            {
+                code.push_back(
+                    BinaryenReturn(
+                        this->mod,
+                        terminator.value >= 0 ? this->get_value(function, terminator.value, value_locals) : nullptr));
+            }
+            else if (terminator.kind == IrTerminatorKind::UNREACHABLE)
+            {
+                code.push_back(BinaryenUnreachable(this->mod));
+            }
+
+            relooper_blocks.push_back(
+                RelooperAddBlock(
+                    relooper,
+                    BinaryenBlock(this->mod, nullptr, code.data(), code.size(), BinaryenTypeNone())));
+        }
+
+        for (auto &block : function.blocks)
+        {
+            auto &terminator = block.terminator;
+            if (terminator.kind == IrTerminatorKind::JUMP ||
+                (terminator.kind == IrTerminatorKind::BRANCH && terminator.targets[0] == terminator.targets[1]))
+            {
+                RelooperAddBranch(
+                    relooper_blocks[block.id],
+                    relooper_blocks[terminator.targets[0]],
+                    nullptr,
+                    this->generate_phi_copies(function, block.id, terminator.targets[0], value_locals, incoming_locals));
+            }
+            else if (terminator.kind == IrTerminatorKind::BRANCH)
+            {
+                RelooperAddBranch(
+                    relooper_blocks[block.id],
+                    relooper_blocks[terminator.targets[0]],
+                    this->get_value(function, terminator.condition, value_locals),
+                    this->generate_phi_copies(function, block.id, terminator.targets[0], value_locals, incoming_locals));
+
+                RelooperAddBranch(
+                    relooper_blocks[block.id],
+                    relooper_blocks[terminator.targets[1]],
+                    nullptr,
+                    this->generate_phi_copies(function, block.id, terminator.targets[1], value_locals, incoming_locals));
+            }
+        }
+
+        BinaryenExpressionRef body = RelooperRenderAndDispose(relooper, relooper_blocks[0], label_helper);
+
+        BinaryenType params = BinaryenTypeCreate(locals.data(), function.params.size());
+        std::vector<BinaryenType> vars(locals.begin() + function.params.size(), locals.end());
+
+        BinaryenAddFunction(
+            this->mod,
+            function.name.c_str(),
+            params,
+            from_ir_type(function.return_type),
+            vars.data(),
+            vars.size(),
+            body);
+
+        BinaryenAddFunctionExport(
+            this->mod,
+            function.name.c_str(),
+            function.name.c_str());
+    }
+
+    BinaryenExpressionRef get_value(IrFunction &function, int value, std::vector<BinaryenIndex> &value_locals)
+    {
+        return BinaryenLocalGet(this->mod, value_locals[value], from_ir_type(function.value_types[value]));
+    }
+
+    /*
+     * The copies into the incoming locals of the phis of `to` when coming from `from`
+     */
+    BinaryenExpressionRef generate_phi_copies(
+        IrFunction &function,
+        int from,
+        int to,
+        std::vector<BinaryenIndex> &value_locals,
+        std::map<int, BinaryenIndex> &incoming_locals)
+    {
+        std::vector<BinaryenExpressionRef> copies;
+        for (auto &phi : function.blocks[to].phis)
+        {
+            for (int i = 0; i < phi.incoming.size(); i++)
+            {
+                if (phi.incoming[i] == from)
+                {
+                    copies.push_back(
+                        BinaryenLocalSet(
+                            this->mod,
+                            incoming_locals[phi.result],
+                            this->get_value(function, phi.operands[i], value_locals)));
+                    break;
+                }
+            }
+        }
+
+        if (copies.empty())
+        {
+            return nullptr;
+        }
+
+        return BinaryenBlock(this->mod, nullptr, copies.data(), copies.size(), BinaryenTypeNone());
+    }
+
+    BinaryenExpressionRef generate_instruction(IrFunction &function, IrInstruction &instruction, std::vector<BinaryenIndex> &value_locals)
+    {
+        std::vector<BinaryenExpressionRef> operands;
+        for (auto operand : instruction.operands)
+        {
+            operands.push_back(this->get_value(function, operand, value_locals));
+        }
+
+        bool float_flag = !instruction.operands.empty() &&
+                          function.value_types[instruction.operands[0]] == BirdType::FLOAT;
+
+        BinaryenExpressionRef expr;
+        switch (instruction.op)
+        {
+        case IrOp::CONST:
+            expr = this->generate_constant(instruction);
+            break;
+        case IrOp::PARAM:
+            expr = BinaryenLocalGet(this->mod, instruction.index, from_ir_type(instruction.type));
+            break;
+        case IrOp::ADD:
+            expr = BinaryenBinary(this->mod, float_flag ? BinaryenAddFloat64() : BinaryenAddInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::SUB:
+            expr = BinaryenBinary(this->mod, float_flag ? BinaryenSubFloat64() : BinaryenSubInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::MUL:
+            expr = BinaryenBinary(this->mod, float_flag ? BinaryenMulFloat64() : BinaryenMulInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::DIV:
+            expr = BinaryenBinary(this->mod, float_flag ? BinaryenDivFloat64() : BinaryenDivSInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::MOD:
+            expr = BinaryenBinary(this->mod, BinaryenRemSInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::NEG:
+            expr = float_flag
+                       ? BinaryenUnary(this->mod, BinaryenNegFloat64(), operands[0])
+                       : BinaryenBinary(this->mod, BinaryenSubInt32(), BinaryenConst(this->mod, BinaryenLiteralInt32(0)), operands[0]);
+            break;
+        case IrOp::EQ:
+            expr = BinaryenBinary(this->mod, float_flag ? BinaryenEqFloat64() : BinaryenEqInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::NE:
+            expr = BinaryenBinary(this->mod, float_flag ? BinaryenNeFloat64() : BinaryenNeInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::LT:
+            expr = BinaryenBinary(this->mod, float_flag ? BinaryenLtFloat64() : BinaryenLtSInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::LE:
+            expr = BinaryenBinary(this->mod, float_flag ? BinaryenLeFloat64() : BinaryenLeSInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::GT:
+            expr = BinaryenBinary(this->mod, float_flag ? BinaryenGtFloat64() : BinaryenGtSInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::GE:
+            expr = BinaryenBinary(this->mod, float_flag ? BinaryenGeFloat64() : BinaryenGeSInt32(), operands[0], operands[1]);
+            break;
+        case IrOp::TO_FLOAT:
+            expr = BinaryenUnary(this->mod, BinaryenConvertSInt32ToFloat64(), operands[0]);
+            break;
+        case IrOp::TO_INT:
+            expr = BinaryenUnary(this->mod, BinaryenTruncSatSFloat64ToInt32(), operands[0]);
+            break;
+        case IrOp::CALL:
+            expr = BinaryenCall(
+                this->mod,
+                instruction.callee.c_str(),
+                operands.data(),
+                operands.size(),
+                from_ir_type(instruction.type));
+            break;
+        case IrOp::PRINT:
+        {
+            auto type = function.value_types[instruction.operands[0]];
+            auto print_function = type == BirdType::FLOAT    ? "print_f64"
+                                  : type == BirdType::STRING ? "print_str"
+                                                             : "print_i32";
+
+            return BinaryenCall(this->mod, print_function, operands.data(), 1, BinaryenTypeNone());
+        }
+        default:
+            throw BirdException("unsupported IR instruction " + ir_op_to_string(instruction.op));
+        }
+
+        if (instruction.result < 0)
+        {
+            return expr;
+        }
+
+        return BinaryenLocalSet(this->mod, value_locals[instruction.result], expr);
+    }
+
+    BinaryenExpressionRef generate_constant(IrInstruction &instruction)
+    {
+        switch (instruction.type)
+        {
+        case BirdType::FLOAT:
+            return BinaryenConst(this->mod, BinaryenLiteralFloat64(instruction.constant.as_double()));
+        case BirdType::BOOL:
+            return BinaryenConst(this->mod, BinaryenLiteralInt32(instruction.constant.as_bool() ? 1 : 0));
+        case BirdType::STRING:
+        {
+            // the segment points into the IR, which outlives the module
+            uint32_t str_ptr;
+            add_memory_segment(this->mod, instruction.constant.as_string(), str_ptr);
+            return BinaryenConst(this->mod, BinaryenLiteralInt32(str_ptr));
+        }
+        default:
+            return BinaryenConst(this->mod, BinaryenLiteralInt32(instruction.constant.as_int()));
+        }
+    }
+
+    BinaryenType from_ir_type(BirdType type)
+    {
+        switch (type)
+        {
+        case BirdType::FLOAT:
+            return BinaryenTypeFloat64();
+        case BirdType::VOID:
+            return BinaryenTypeNone();
+        default:
+            return BinaryenTypeInt32();
+        }
     }
 
     bool is_bird_type(Token token)
@@ -902,7 +1225,7 @@ public:
                       TaggedExpression(
                           BinaryenBinary(
                               this->mod,
-                              BinaryenDivSInt32(),
+                              binary->non_negative_operands ? BinaryenDivUInt32() : BinaryenDivSInt32(),
                               left.value,
                               right.value),
                           CodeGenInt));
@@ -961,7 +1284,7 @@ public:
                       TaggedExpression(
                           BinaryenBinary(
                               this->mod,
-                              BinaryenRemSInt32(),
+                              binary->non_negative_operands ? BinaryenRemUInt32() : BinaryenRemSInt32(),
                               left.value,
                               right.value),
                           CodeGenInt));
@@ -1319,6 +1642,13 @@ public:
             current_function_body.push_back(result.value);
         }
 
+        // a function with a return type can not fall off its end,
+        // so a body ending in a loop is still valid
+        if (result_type != BinaryenTypeNone())
+        {
+            current_function_body.push_back(BinaryenUnreachable(this->mod));
+        }
+
         this->environment.pop_env();
 
         BinaryenExpressionRef body = BinaryenBlock(
@@ -0,0 +1,388 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+
+#include "ast_node/index.h"
+#include "visitors/purity_checker.h"
+#include "visitors/effect_analyzer.h"
+
+/*
+ * One evaluation of a pure expression inside a basic block
+ */
+struct Occurrence
+{
+    Expr *expr;
+    std::function<void(std::unique_ptr<Expr>)> replace;
+    int stmt_index;
+    bool valid_at_stmt_start; // no variable it reads changes earlier in its statement
+    int size;
+};
+
+/*
+ * Eliminates repeated pure expressions inside basic blocks, runs after type checking.
+ *
+ * A basic block is a run of declarations, expression statements and prints,
+ * optionally ending in the condition of an if or a return. Expressions made
+ * of binary and unary operators over literals and variables are numbered by
+ * their shape and the version of every variable they read, a variable gets a new
+ * version whenever it is assigned, declared or could be assigned by a call.
+ * Expressions with the same number compute the same value, so when one appears
+ * more than once the first copy is stored in a temporary declared before its
+ * statement and every copy reads the temporary instead.
+ */
+class CommonSubexpressionEliminator
+{
+public:
+    int eliminated_expressions = 0;
+    int temporaries = 0;
+    EffectAnalyzer effects;
+    PurityChecker purity_checker;
+
+    // state while numbering one basic block
+    std::map<std::string, int> versions;
+    std::map<std::string, int> stmt_start_versions;
+    std::map<std::string, std::vector<Occurrence>> occurrences;
+    int stmt_index;
+
+    void eliminate_common_subexpressions(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        this->effects.analyze_effects(stmts);
+        this->eliminate(*stmts);
+    }
+
+    /*
+     * Splits a list of statements into basic blocks and handles the nested statements
+     */
+    void eliminate(std::vector<std::unique_ptr<Stmt>> &stmts)
+    {
+        std::vector<std::unique_ptr<Stmt>> result;
+        std::vector<std::unique_ptr<Stmt>> basic_block;
+
+        for (auto &stmt : stmts)
+        {
+            auto raw = stmt.get();
+
+            if (this->is_straight_line(raw))
+            {
+                basic_block.push_back(std::move(stmt));
+                continue;
+            }
+
+            if (dynamic_cast<IfStmt *>(raw) || dynamic_cast<ReturnStmt *>(raw))
+            {
+                basic_block.push_back(std::move(stmt));
+                this->flush(basic_block, result);
+            }
+            else
+            {
+                this->flush(basic_block, result);
+                result.push_back(std::move(stmt));
+            }
+
+            this->eliminate_nested(raw);
+        }
+
+        this->flush(basic_block, result);
+        stmts = std::move(result);
+    }
+
+    void eliminate_nested(Stmt *stmt)
+    {
+        if (auto block = dynamic_cast<Block *>(stmt))
+        {
+            this->eliminate(block->stmts);
+        }
+        else if (auto if_stmt = dynamic_cast<IfStmt *>(stmt))
+        {
+            this->eliminate_nested(if_stmt->then_branch.get());
+
+            if (if_stmt->else_branch.has_value())
+            {
+                this->eliminate_nested(if_stmt->else_branch.value().get());
+            }
+        }
+        else if (auto while_stmt = dynamic_cast<WhileStmt *>(stmt))
+        {
+            this->eliminate_nested(while_stmt->stmt.get());
+        }
+        else if (auto for_stmt = dynamic_cast<ForStmt *>(stmt))
+        {
+            this->eliminate_nested(for_stmt->body.get());
+        }
+        else if (auto func = dynamic_cast<Func *>(stmt))
+        {
+            this->eliminate(dynamic_cast<Block *>(func->block.get())->stmts);
+        }
+    }
+
+    bool is_straight_line(Stmt *stmt)
+    {
+        return dynamic_cast<DeclStmt *>(stmt) ||
+               dynamic_cast<ConstStmt *>(stmt) ||
+               dynamic_cast<ExprStmt *>(stmt) ||
+               dynamic_cast<PrintStmt *>(stmt);
+    }
+
+    void flush(std::vector<std::unique_ptr<Stmt>> &basic_block, std::vector<std::unique_ptr<Stmt>> &result)
+    {
+        // replace the largest repeated expression first, its parts may still repeat elsewhere
+        while (this->eliminate_largest(basic_block))
+        {
+        }
+
+        for (auto &stmt : basic_block)
+        {
+            result.push_back(std::move(stmt));
+        }
+
+        basic_block.clear();
+    }
+
+    bool eliminate_largest(std::vector<std::unique_ptr<Stmt>> &basic_block)
+    {
+        this->number_block(basic_block);
+
+        std::vector<Occurrence> *best = nullptr;
+        for (auto &group : this->occurrences)
+        {
+            auto &found = group.second;
+            if (found.size() < 2 || !found[0].valid_at_stmt_start)
+            {
+                continue;
+            }
+
+            if (!best || found[0].size > (*best)[0].size ||
+                (found[0].size == (*best)[0].size && found[0].stmt_index < (*best)[0].stmt_index))
+            {
+                best = &found;
+            }
+        }
+
+        if (!best)
+        {
+            return false;
+        }
+
+        auto &first = (*best)[0];
+        auto name = "cse$" + std::to_string(this->temporaries++);
+        auto position = this->first_token(first.expr);
+        Token identifier(Token::Type::IDENTIFIER, name, position.line_num, position.char_num);
+
+        auto temporary = std::make_unique<DeclStmt>(identifier, std::nullopt, false, this->copy(first.expr));
+        auto stmt_index = first.stmt_index;
+
+        for (auto &occurrence : *best)
+        {
+            occurrence.replace(std::make_unique<Primary>(identifier));
+        }
+
+        this->eliminated_expressions += best->size() - 1;
+        basic_block.insert(basic_block.begin() + stmt_index, std::move(temporary));
+
+        return true;
+    }
+
+    /*
+     * Finds every pure expression in a basic block, in evaluation order
+     */
+    void number_block(std::vector<std::unique_ptr<Stmt>> &basic_block)
+    {
+        this->versions.clear();
+        this->occurrences.clear();
+
+        for (this->stmt_index = 0; this->stmt_index < basic_block.size(); this->stmt_index++)
+        {
+            auto stmt = basic_block[this->stmt_index].get();
+            this->stmt_start_versions = this->versions;
+
+            if (auto decl_stmt = dynamic_cast<DeclStmt *>(stmt))
+            {
+                this->number(decl_stmt->value);
+                this->kill(decl_stmt->identifier.lexeme);
+            }
+            else if (auto const_stmt = dynamic_cast<ConstStmt *>(stmt))
+            {
+                this->number(const_stmt->value);
+                this->kill(const_stmt->identifier.lexeme);
+            }
+            else if (auto expr_stmt = dynamic_cast<ExprStmt *>(stmt))
+            {
+                this->number(expr_stmt->expr);
+            }
+            else if (auto print_stmt = dynamic_cast<PrintStmt *>(stmt))
+            {
+                for (auto &arg : print_stmt->args)
+                {
+                    this->number(arg);
+                }
+            }
+            else if (auto if_stmt = dynamic_cast<IfStmt *>(stmt))
+            {
+                this->number(if_stmt->condition);
+            }
+            else if (auto return_stmt = dynamic_cast<ReturnStmt *>(stmt))
+            {
+                if (return_stmt->expr.has_value())
+                {
+                    this->number(return_stmt->expr.value());
+                }
+            }
+        }
+    }
+
+    template <typename Pointer>
+    void number(Pointer &expr, bool record = true)
+    {
+        auto raw = expr.get();
+
+        if (auto binary = dynamic_cast<Binary *>(raw))
+        {
+            this->number(binary->left, record);
+            this->number(binary->right, record);
+        }
+        else if (auto unary = dynamic_cast<Unary *>(raw))
+        {
+            this->number(unary->expr, record);
+        }
+        else if (auto ternary = dynamic_cast<Ternary *>(raw))
+        {
+            // only one branch runs, so expressions in the branches are not reused
+            this->number(ternary->condition, record);
+            this->number(ternary->true_expr, false);
+            this->number(ternary->false_expr, false);
+        }
+        else if (auto call = dynamic_cast<Call *>(raw))
+        {
+            for (auto &arg : call->args)
+            {
+                this->number(arg, record);
+            }
+
+            for (auto &assigned : this->effects.assigned_by(call->identifier.lexeme))
+            {
+                this->kill(assigned);
+            }
+        }
+        else if (auto assign_expr = dynamic_cast<AssignExpr *>(raw))
+        {
+            this->number(assign_expr->value, record);
+            this->kill(assign_expr->identifier.lexeme);
+        }
+
+        if (!record || dynamic_cast<Primary *>(raw))
+        {
+            return;
+        }
+
+        auto key = this->key(raw, this->versions);
+        if (!key.has_value() || !this->purity_checker.is_pure(raw))
+        {
+            return;
+        }
+
+        Occurrence occurrence;
+        occurrence.expr = raw;
+        occurrence.replace = [&expr](std::unique_ptr<Expr> replacement)
+        { expr = std::move(replacement); };
+        occurrence.stmt_index = this->stmt_index;
+        occurrence.valid_at_stmt_start = this->key(raw, this->stmt_start_versions) == key;
+        occurrence.size = this->size(raw);
+
+        this->occurrences[key.value()].push_back(occurrence);
+    }
+
+    void kill(std::string identifier)
+    {
+        this->versions[identifier] += 1;
+    }
+
+    /*
+     * The value number of an expression, nullopt for expressions that are not numbered
+     */
+    std::optional<std::string> key(Expr *expr, std::map<std::string, int> &versions)
+    {
+        if (auto primary = dynamic_cast<Primary *>(expr))
+        {
+            if (primary->value.token_type == Token::Type::IDENTIFIER)
+            {
+                return primary->value.lexeme + "@" + std::to_string(versions[primary->value.lexeme]);
+            }
+
+            return std::to_string((int)primary->value.token_type) + ":" + primary->value.lexeme;
+        }
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+        {
+            auto operand = this->key(unary->expr.get(), versions);
+            if (!operand.has_value())
+            {
+                return std::nullopt;
+            }
+
+            return "(" + unary->op.lexeme + operand.value() + ")";
+        }
+
+        if (auto binary = dynamic_cast<Binary *>(expr))
+        {
+            auto left = this->key(binary->left.get(), versions);
+            auto right = this->key(binary->right.get(), versions);
+            if (!left.has_value() || !right.has_value())
+            {
+                return std::nullopt;
+            }
+
+            // operands of commutative operators are ordered so `a * b` matches `b * a`
+            auto op = binary->op.token_type;
+            bool commutative = op == Token::Type::STAR || op == Token::Type::EQUAL_EQUAL || op == Token::Type::BANG_EQUAL;
+            if (commutative && right.value() < left.value())
+            {
+                std::swap(left, right);
+            }
+
+            return "(" + left.value() + " " + binary->op.lexeme + " " + right.value() + ")";
+        }
+
+        return std::nullopt;
+    }
+
+    int size(Expr *expr)
+    {
+        if (auto binary = dynamic_cast<Binary *>(expr))
+            return 1 + this->size(binary->left.get()) + this->size(binary->right.get());
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+            return 1 + this->size(unary->expr.get());
+
+        return 1;
+    }
+
+    Token first_token(Expr *expr)
+    {
+        if (auto binary = dynamic_cast<Binary *>(expr))
+            return binary->op;
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+            return unary->op;
+
+        return dynamic_cast<Primary *>(expr)->value;
+    }
+
+    std::unique_ptr<Expr> copy(Expr *expr)
+    {
+        if (auto binary = dynamic_cast<Binary *>(expr))
+        {
+            return std::make_unique<Binary>(this->copy(binary->left.get()), binary->op, this->copy(binary->right.get()));
+        }
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+        {
+            return std::make_unique<Unary>(unary->op, this->copy(unary->expr.get()));
+        }
+
+        return std::make_unique<Primary>(dynamic_cast<Primary *>(expr)->value);
+    }
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <set>
+
+#include "ast_node/index.h"
+#include "visitors/ast_walker.h"
+#include "visitors/effect_analyzer.h"
+#include "visitors/constant_folder.h"
+#include "visitors/interpreter.h"
+#include "exceptions/bird_exception.h"
+#include "exceptions/step_budget_exception.h"
+
+/*
+ * Visitor that decides if an expression can be evaluated at compile time,
+ * meaning it only reads known constants and only calls known pure functions
+ */
+class CompileTimeChecker : public AstWalker
+{
+public:
+    std::set<std::string> *constants;
+    std::set<std::string> *functions;
+    bool evaluable = true;
+    bool calls = false;
+
+    CompileTimeChecker(std::set<std::string> *constants, std::set<std::string> *functions)
+        : constants(constants), functions(functions) {}
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        this->evaluable = false;
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        if (primary->value.token_type == Token::Type::IDENTIFIER && !this->constants->count(primary->value.lexeme))
+        {
+            this->evaluable = false;
+        }
+    }
+
+    void visit_call(Call *call)
+    {
+        this->calls = true;
+        if (!this->functions->count(call->identifier.lexeme))
+        {
+            this->evaluable = false;
+            return;
+        }
+
+        for (auto &arg : call->args)
+        {
+            arg->accept(this);
+        }
+    }
+};
+
+/*
+ * Evaluates the initializers of top level constants that call pure functions
+ * and replaces them with literals, runs after constant folding.
+ *
+ * The initializers are run by an interpreter that only knows the top level
+ * functions, types and constants declared before them. The interpreter stops
+ * after `step_budget` calls and loop iterations, an initializer that does not
+ * finish within the budget, or that fails, is left for runtime.
+ */
+class ConstEvaluator
+{
+public:
+    static const int default_step_budget = 10000;
+
+    int step_budget;
+    int evaluated_constants = 0;
+    int exhausted_budgets = 0;
+
+    EffectAnalyzer effects;
+    ConstantFolder constant_folder; // only used to build literals
+    Interpreter interpreter;
+    std::set<std::string> constants;
+    std::set<std::string> functions;
+
+    ConstEvaluator(int step_budget = default_step_budget) : step_budget(step_budget) {}
+
+    void evaluate_constants(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        if (this->step_budget == 0)
+        {
+            return;
+        }
+
+        this->effects.analyze_effects(stmts);
+
+        for (auto &stmt : *stmts)
+        {
+            if (auto func = dynamic_cast<Func *>(stmt.get()))
+            {
+                this->interpreter.visit_func(func);
+                if (func->is_pure && func->return_type.has_value())
+                {
+                    this->functions.insert(func->identifier.lexeme);
+                }
+            }
+            else if (auto type_stmt = dynamic_cast<TypeStmt *>(stmt.get()))
+            {
+                this->interpreter.visit_type_stmt(type_stmt);
+            }
+            else if (auto const_stmt = dynamic_cast<ConstStmt *>(stmt.get()))
+            {
+                this->evaluate_constant(const_stmt);
+            }
+        }
+    }
+
+    void evaluate_constant(ConstStmt *const_stmt)
+    {
+        CompileTimeChecker checker(&this->constants, &this->functions);
+        const_stmt->value->accept(&checker);
+        if (!checker.evaluable)
+        {
+            return;
+        }
+
+        auto num_envs = this->interpreter.env.envs.size();
+        auto stack_size = this->interpreter.stack.stack.size();
+
+        this->interpreter.steps = 0;
+        this->interpreter.step_budget = this->step_budget;
+
+        try
+        {
+            this->interpreter.visit_const_stmt(const_stmt);
+        }
+        catch (StepBudgetException e)
+        {
+            this->exhausted_budgets++;
+            this->restore(num_envs, stack_size);
+            return;
+        }
+        catch (BirdException e)
+        {
+            // left for the runtime to report
+            this->restore(num_envs, stack_size);
+            return;
+        }
+
+        auto result = this->interpreter.env.get(const_stmt->identifier.lexeme);
+        auto literal = this->constant_folder.make_literal(result, const_stmt->identifier);
+        if (!literal)
+        {
+            return;
+        }
+
+        this->constants.insert(const_stmt->identifier.lexeme);
+        if (checker.calls)
+        {
+            const_stmt->value = std::move(literal);
+            this->evaluated_constants++;
+        }
+    }
+
+    void restore(size_t num_envs, size_t stack_size)
+    {
+        this->interpreter.completion = Completion::NORMAL;
+        this->interpreter.frame_base = 0;
+        this->interpreter.pop_frame(0);
+
+        while (this->interpreter.env.envs.size() > num_envs)
+        {
+            this->interpreter.env.pop_env();
+        }
+
+        while (this->interpreter.stack.stack.size() > stack_size)
+        {
+            this->interpreter.stack.pop();
+        }
+    }
+};
@@ -0,0 +1,488 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <optional>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <cmath>
+
+#include "ast_node/index.h"
+
+#include "sym_table.h"
+#include "exceptions/bird_exception.h"
+#include "value.h"
+#include "stack.h"
+#include "type.h"
+
+/*
+ * Visitor that folds constant expressions into literals and propagates
+ * the values of constants into their uses, runs after type checking.
+ *
+ * Values are computed with the same `Value` operators the interpreter uses,
+ * so folding follows the same int/float promotion rules. Anything that would
+ * fail at runtime (division by zero, int overflow) is left for runtime.
+ */
+class ConstantFolder : public Visitor
+{
+public:
+    Environment<std::optional<Value>> env; // the values of constants, nullopt for everything else
+    Environment<Type> type_table;
+    Stack<std::optional<Value>> stack;
+
+    // set by an expression that should be replaced by one of its children
+    std::unique_ptr<Expr> replacement;
+
+    ConstantFolder()
+    {
+        this->env.push_env();
+        this->type_table.push_env();
+    }
+
+    void fold_constants(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        for (auto &stmt : *stmts)
+        {
+            stmt->accept(this);
+        }
+
+        while (!this->stack.empty())
+        {
+            this->stack.pop();
+        }
+    }
+
+    /*
+     * Folds an expression in place, returning its value when it is constant
+     */
+    template <typename Pointer>
+    std::optional<Value> fold(Pointer &expr)
+    {
+        expr->accept(this);
+        auto result = this->stack.pop();
+
+        if (this->replacement)
+        {
+            expr = std::move(this->replacement);
+        }
+
+        if (result.has_value() && !this->is_literal(expr.get()))
+        {
+            auto literal = this->make_literal(result.value(), this->first_token(expr.get()));
+            if (literal)
+            {
+                expr = std::move(literal);
+            }
+        }
+
+        return result;
+    }
+
+    void visit_block(Block *block)
+    {
+        this->env.push_env();
+        this->type_table.push_env();
+
+        for (auto &stmt : block->stmts)
+        {
+            stmt->accept(this);
+        }
+
+        this->type_table.pop_env();
+        this->env.pop_env();
+    }
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        this->fold(decl_stmt->value);
+        this->bind(decl_stmt->identifier.lexeme, std::nullopt);
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        this->fold(assign_expr->value);
+        this->stack.push(std::nullopt);
+    }
+
+    void visit_expr_stmt(ExprStmt *expr_stmt)
+    {
+        this->fold(expr_stmt->expr);
+    }
+
+    void visit_print_stmt(PrintStmt *print_stmt)
+    {
+        for (auto &arg : print_stmt->args)
+        {
+            this->fold(arg);
+        }
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        auto result = this->fold(const_stmt->value);
+
+        if (result.has_value() && const_stmt->type_token.has_value())
+        {
+            std::string type_lexeme = const_stmt->type_is_literal
+                                          ? const_stmt->type_token.value().lexeme
+                                          : this->type_table.get(const_stmt->type_token.value().lexeme).type.lexeme;
+
+            // same conversions as the interpreter
+            if (type_lexeme == "int" && is_numeric(result.value()))
+            {
+                result = Value(to_type<int, double>(result.value()));
+            }
+            else if (type_lexeme == "float" && is_numeric(result.value()))
+            {
+                result = Value(to_type<double, int>(result.value()));
+            }
+        }
+
+        this->bind(const_stmt->identifier.lexeme, result);
+    }
+
+    void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        this->fold(while_stmt->condition);
+        while_stmt->stmt->accept(this);
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        this->env.push_env();
+
+        if (for_stmt->initializer.has_value())
+        {
+            for_stmt->initializer.value()->accept(this);
+        }
+
+        if (for_stmt->condition.has_value())
+        {
+            this->fold(for_stmt->condition.value());
+        }
+
+        if (for_stmt->increment.has_value())
+        {
+            this->fold(for_stmt->increment.value());
+        }
+
+        for_stmt->body->accept(this);
+
+        this->env.pop_env();
+    }
+
+    void visit_binary(Binary *binary)
+    {
+        auto left = this->fold(binary->left);
+        auto right = this->fold(binary->right);
+
+        if (!left.has_value() || !right.has_value())
+        {
+            this->stack.push(std::nullopt);
+            return;
+        }
+
+        this->stack.push(this->evaluate_binary(binary->op.token_type, left.value(), right.value()));
+    }
+
+    void visit_unary(Unary *unary)
+    {
+        auto expr = this->fold(unary->expr);
+
+        if (!expr.has_value() || unary->op.token_type != Token::Type::MINUS)
+        {
+            this->stack.push(std::nullopt);
+            return;
+        }
+
+        if (is_type<int>(expr.value()) && as_type<int>(expr.value()) == std::numeric_limits<int>::min())
+        {
+            this->stack.push(std::nullopt);
+            return;
+        }
+
+        try
+        {
+            this->stack.push(-expr.value());
+        }
+        catch (BirdException e)
+        {
+            this->stack.push(std::nullopt);
+        }
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        switch (primary->value.token_type)
+        {
+        case Token::Type::FLOAT_LITERAL:
+            this->stack.push(Value(std::stod(primary->value.lexeme)));
+            break;
+        case Token::Type::BOOL_LITERAL:
+            this->stack.push(Value(primary->value.lexeme == "true"));
+            break;
+        case Token::Type::STR_LITERAL:
+            this->stack.push(Value(primary->value.lexeme));
+            break;
+        case Token::Type::INT_LITERAL:
+            this->stack.push(Value(std::stoi(primary->value.lexeme)));
+            break;
+        case Token::Type::IDENTIFIER:
+            this->stack.push(this->env.contains(primary->value.lexeme)
+                                 ? this->env.get(primary->value.lexeme)
+                                 : std::nullopt);
+            break;
+        default:
+            this->stack.push(std::nullopt);
+        }
+    }
+
+    void visit_ternary(Ternary *ternary)
+    {
+        auto condition = this->fold(ternary->condition);
+        auto true_expr = this->fold(ternary->true_expr);
+        auto false_expr = this->fold(ternary->false_expr);
+
+        if (!condition.has_value() || !is_type<bool>(condition.value()))
+        {
+            this->stack.push(std::nullopt);
+            return;
+        }
+
+        // only the chosen branch is ever evaluated, so the other one can be dropped
+        if (as_type<bool>(condition.value()))
+        {
+            this->replacement = std::move(ternary->true_expr);
+            this->stack.push(true_expr);
+        }
+        else
+        {
+            this->replacement = std::move(ternary->false_expr);
+            this->stack.push(false_expr);
+        }
+    }
+
+    void visit_func(Func *func)
+    {
+        this->env.push_env();
+
+        for (auto &param : func->param_list)
+        {
+            this->bind(param.first.lexeme, std::nullopt);
+        }
+
+        for (auto &stmt : dynamic_cast<Block *>(func->block.get())->stmts)
+        {
+            stmt->accept(this);
+        }
+
+        this->env.pop_env();
+    }
+
+    void visit_if_stmt(IfStmt *if_stmt)
+    {
+        this->fold(if_stmt->condition);
+        if_stmt->then_branch->accept(this);
+
+        if (if_stmt->else_branch.has_value())
+        {
+            if_stmt->else_branch.value()->accept(this);
+        }
+    }
+
+    void visit_call(Call *call)
+    {
+        for (auto &arg : call->args)
+        {
+            this->fold(arg);
+        }
+
+        this->stack.push(std::nullopt);
+    }
+
+    void visit_return_stmt(ReturnStmt *return_stmt)
+    {
+        if (return_stmt->expr.has_value())
+        {
+            this->fold(return_stmt->expr.value());
+        }
+    }
+
+    void visit_break_stmt(BreakStmt *break_stmt)
+    {
+        // do nothing
+    }
+
+    void visit_continue_stmt(ContinueStmt *continue_stmt)
+    {
+        // do nothing
+    }
+
+    void visit_type_stmt(TypeStmt *type_stmt)
+    {
+        if (type_stmt->type_is_literal)
+        {
+            this->type_table.declare(type_stmt->identifier.lexeme, Type(type_stmt->type_token));
+        }
+        else
+        {
+            this->type_table.declare(type_stmt->identifier.lexeme, Type(this->type_table.get(type_stmt->type_token.lexeme).type));
+        }
+    }
+
+    std::optional<Value> evaluate_binary(Token::Type op, Value left, Value right)
+    {
+        // the backends disagree on how to compare an int with a float,
+        // the interpreter truncates the float and wasm promotes the int
+        if ((op == Token::Type::LESS || op == Token::Type::LESS_EQUAL) &&
+            is_type<int>(left) && is_type<double>(right))
+        {
+            return std::nullopt;
+        }
+
+        if (is_matching_type<int>(left, right) && this->overflows(op, as_type<int>(left), as_type<int>(right)))
+        {
+            return std::nullopt;
+        }
+
+        try
+        {
+            switch (op)
+            {
+            case Token::Type::PLUS:
+                return left + right;
+            case Token::Type::MINUS:
+                return left - right;
+            case Token::Type::SLASH:
+                return left / right;
+            case Token::Type::STAR:
+                return left * right;
+            case Token::Type::GREATER:
+                return left > right;
+            case Token::Type::GREATER_EQUAL:
+                return left >= right;
+            case Token::Type::LESS:
+                return left < right;
+            case Token::Type::LESS_EQUAL:
+                return left <= right;
+            case Token::Type::BANG_EQUAL:
+                return left != right;
+            case Token::Type::EQUAL_EQUAL:
+                return left == right;
+            case Token::Type::PERCENT:
+                return left % right;
+            default:
+                return std::nullopt;
+            }
+        }
+        catch (BirdException e)
+        {
+            // left for the runtime to report
+            return std::nullopt;
+        }
+    }
+
+    bool overflows(Token::Type op, int left, int right)
+    {
+        long long result;
+        switch (op)
+        {
+        case Token::Type::PLUS:
+            result = (long long)left + right;
+            break;
+        case Token::Type::MINUS:
+            result = (long long)left - right;
+            break;
+        case Token::Type::STAR:
+            result = (long long)left * right;
+            break;
+        case Token::Type::SLASH:
+        case Token::Type::PERCENT:
+            return left == std::numeric_limits<int>::min() && right == -1;
+        default:
+            return false;
+        }
+
+        return result < std::numeric_limits<int>::min() || result > std::numeric_limits<int>::max();
+    }
+
+    /*
+     * Creates a literal for a constant value, returns nullptr
+     * when the value has no literal representation
+     */
+    std::unique_ptr<Expr> make_literal(Value value, Token position)
+    {
+        if (is_type<int>(value))
+        {
+            return std::make_unique<Primary>(Token(Token::Type::INT_LITERAL, std::to_string(as_type<int>(value)), position.line_num, position.char_num));
+        }
+
+        if (is_type<double>(value))
+        {
+            if (!std::isfinite(as_type<double>(value)))
+            {
+                return nullptr;
+            }
+
+            std::ostringstream lexeme;
+            lexeme << std::setprecision(std::numeric_limits<double>::max_digits10) << as_type<double>(value);
+            return std::make_unique<Primary>(Token(Token::Type::FLOAT_LITERAL, lexeme.str(), position.line_num, position.char_num));
+        }
+
+        if (is_type<bool>(value))
+        {
+            return std::make_unique<Primary>(Token(Token::Type::BOOL_LITERAL, as_type<bool>(value) ? "true" : "false", position.line_num, position.char_num));
+        }
+
+        if (is_type<std::string>(value))
+        {
+            return std::make_unique<Primary>(Token(Token::Type::STR_LITERAL, as_type<std::string>(value), position.line_num, position.char_num));
+        }
+
+        return nullptr;
+    }
+
+    bool is_literal(Expr *expr)
+    {
+        auto primary = dynamic_cast<Primary *>(expr);
+        return primary && primary->value.token_type != Token::Type::IDENTIFIER;
+    }
+
+    /*
+     * Finds a token to give a folded literal its source position
+     */
+    Token first_token(Expr *expr)
+    {
+        if (auto binary = dynamic_cast<Binary *>(expr))
+            return binary->op;
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+            return unary->op;
+
+        if (auto primary = dynamic_cast<Primary *>(expr))
+            return primary->value;
+
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+            return ternary->ternary_token;
+
+        if (auto call = dynamic_cast<Call *>(expr))
+            return call->identifier;
+
+        if (auto assign_expr = dynamic_cast<AssignExpr *>(expr))
+            return assign_expr->identifier;
+
+        return Token();
+    }
+
+    void bind(std::string identifier, std::optional<Value> value)
+    {
+        if (this->env.current_contains(identifier))
+        {
+            this->env.envs.back()[identifier] = value;
+            return;
+        }
+
+        this->env.declare(identifier, value);
+    }
+};
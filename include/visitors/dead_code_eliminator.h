@@ -0,0 +1,353 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <optional>
+#include <string>
+#include <set>
+#include <map>
+
+#include "ast_node/index.h"
+#include "visitors/ast_walker.h"
+#include "visitors/purity_checker.h"
+
+/*
+ * Visitor that collects the identifiers that are read or assigned,
+ * and which functions can be called from the top level
+ */
+class ReferenceCollector : public AstWalker
+{
+public:
+    std::set<std::string> referenced;
+    std::set<std::string> reachable_functions;
+
+    std::set<std::string> top_level_calls;
+    std::map<std::string, std::set<std::string>> function_calls; // function name -> names it calls
+    std::vector<std::string> function_stack;
+
+    void collect(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        this->walk(stmts);
+
+        std::vector<std::string> worklist(this->top_level_calls.begin(), this->top_level_calls.end());
+        while (!worklist.empty())
+        {
+            auto name = worklist.back();
+            worklist.pop_back();
+
+            if (!this->reachable_functions.insert(name).second)
+            {
+                continue;
+            }
+
+            for (auto &callee : this->function_calls[name])
+            {
+                worklist.push_back(callee);
+            }
+        }
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        this->referenced.insert(assign_expr->identifier.lexeme);
+        assign_expr->value->accept(this);
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        if (primary->value.token_type == Token::Type::IDENTIFIER)
+        {
+            this->referenced.insert(primary->value.lexeme);
+        }
+    }
+
+    void visit_func(Func *func)
+    {
+        this->function_stack.push_back(func->identifier.lexeme);
+        func->block->accept(this);
+        this->function_stack.pop_back();
+    }
+
+    void visit_call(Call *call)
+    {
+        if (this->function_stack.empty())
+        {
+            this->top_level_calls.insert(call->identifier.lexeme);
+        }
+        else
+        {
+            this->function_calls[this->function_stack.back()].insert(call->identifier.lexeme);
+        }
+
+        for (auto &arg : call->args)
+        {
+            arg->accept(this);
+        }
+    }
+};
+
+/*
+ * Visitor that removes code that can never run or whose result is never used:
+ * - branches of if statements and loops with constant conditions
+ * - statements after a return, break or continue
+ * - local variables and constants that are never used and have pure initializers
+ * - functions that can never be called from the top level
+ *
+ * Global variables are kept, they are the observable state of a program.
+ * Runs after constant folding, so constant conditions are already literals.
+ */
+class DeadCodeEliminator : public AstWalker
+{
+public:
+    // statistics on what was removed
+    int removed_branches = 0;
+    int removed_unreachable = 0;
+    int removed_declarations = 0;
+    int removed_functions = 0;
+
+    std::set<std::string> referenced;
+    std::set<std::string> reachable_functions;
+    PurityChecker purity_checker;
+    bool top_level = true;
+
+    // set by a statement that should be replaced, a null replacement removes the statement
+    std::optional<std::unique_ptr<Stmt>> replacement;
+
+    void eliminate_dead_code(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        // removing code can leave more code unused, so repeat until nothing changes
+        int removed;
+        do
+        {
+            removed = this->total_removed();
+
+            ReferenceCollector collector;
+            collector.collect(stmts);
+            this->referenced = collector.referenced;
+            this->reachable_functions = collector.reachable_functions;
+
+            this->top_level = true;
+            this->eliminate(*stmts);
+        } while (this->total_removed() != removed);
+    }
+
+    int total_removed()
+    {
+        return this->removed_branches + this->removed_unreachable + this->removed_declarations + this->removed_functions;
+    }
+
+    /*
+     * Removes dead statements from a list of statements
+     */
+    void eliminate(std::vector<std::unique_ptr<Stmt>> &stmts)
+    {
+        std::vector<std::unique_ptr<Stmt>> kept;
+        bool terminated = false;
+
+        for (auto &stmt : stmts)
+        {
+            if (terminated)
+            {
+                this->removed_unreachable += 1;
+                continue;
+            }
+
+            if (this->is_unused(stmt.get()))
+            {
+                continue;
+            }
+
+            this->replacement = std::nullopt;
+            stmt->accept(this);
+
+            if (this->replacement.has_value())
+            {
+                stmt = std::move(this->replacement.value());
+                this->replacement = std::nullopt;
+
+                if (!stmt)
+                {
+                    continue;
+                }
+            }
+
+            terminated = dynamic_cast<ReturnStmt *>(stmt.get()) ||
+                         dynamic_cast<BreakStmt *>(stmt.get()) ||
+                         dynamic_cast<ContinueStmt *>(stmt.get());
+
+            kept.push_back(std::move(stmt));
+        }
+
+        stmts = std::move(kept);
+    }
+
+    /*
+     * Removes dead code from a statement that is not in a list,
+     * a removed statement is replaced by an empty block
+     */
+    void eliminate(std::unique_ptr<Stmt> &stmt)
+    {
+        this->replacement = std::nullopt;
+        stmt->accept(this);
+
+        if (this->replacement.has_value())
+        {
+            stmt = std::move(this->replacement.value());
+            this->replacement = std::nullopt;
+
+            if (!stmt)
+            {
+                stmt = std::make_unique<Block>(std::vector<std::unique_ptr<Stmt>>());
+            }
+        }
+    }
+
+    bool is_unused(Stmt *stmt)
+    {
+        if (auto func = dynamic_cast<Func *>(stmt))
+        {
+            if (!this->reachable_functions.count(func->identifier.lexeme))
+            {
+                this->removed_functions += 1;
+                return true;
+            }
+
+            return false;
+        }
+
+        if (this->top_level)
+        {
+            return false;
+        }
+
+        std::optional<std::pair<Token, Expr *>> declaration;
+        if (auto decl_stmt = dynamic_cast<DeclStmt *>(stmt))
+        {
+            declaration = {decl_stmt->identifier, decl_stmt->value.get()};
+        }
+        else if (auto const_stmt = dynamic_cast<ConstStmt *>(stmt))
+        {
+            declaration = {const_stmt->identifier, const_stmt->value.get()};
+        }
+
+        if (declaration.has_value() &&
+            !this->referenced.count(declaration.value().first.lexeme) &&
+            this->purity_checker.is_pure(declaration.value().second))
+        {
+            this->removed_declarations += 1;
+            return true;
+        }
+
+        return false;
+    }
+
+    std::optional<bool> bool_literal(Expr *expr)
+    {
+        auto primary = dynamic_cast<Primary *>(expr);
+        if (primary && primary->value.token_type == Token::Type::BOOL_LITERAL)
+        {
+            return primary->value.lexeme == "true";
+        }
+
+        return std::nullopt;
+    }
+
+    void visit_block(Block *block)
+    {
+        auto previous_top_level = this->top_level;
+        this->top_level = false;
+
+        this->eliminate(block->stmts);
+
+        this->top_level = previous_top_level;
+    }
+
+    void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        this->eliminate(while_stmt->stmt);
+
+        auto condition = this->bool_literal(while_stmt->condition.get());
+        if (condition.has_value() && !condition.value())
+        {
+            this->removed_branches += 1;
+            this->replacement = std::unique_ptr<Stmt>();
+        }
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        this->eliminate(for_stmt->body);
+
+        if (!for_stmt->condition.has_value())
+        {
+            return;
+        }
+
+        auto condition = this->bool_literal(for_stmt->condition.value().get());
+        if (condition.has_value() && !condition.value())
+        {
+            this->removed_branches += 1;
+
+            // the initializer still runs once, in its own scope
+            if (for_stmt->initializer.has_value())
+            {
+                std::vector<std::unique_ptr<Stmt>> stmts;
+                stmts.push_back(std::move(for_stmt->initializer.value()));
+                this->replacement = std::make_unique<Block>(std::move(stmts));
+            }
+            else
+            {
+                this->replacement = std::unique_ptr<Stmt>();
+            }
+        }
+    }
+
+    void visit_func(Func *func)
+    {
+        auto previous_top_level = this->top_level;
+        this->top_level = false;
+
+        this->eliminate(dynamic_cast<Block *>(func->block.get())->stmts);
+
+        this->top_level = previous_top_level;
+    }
+
+    void visit_if_stmt(IfStmt *if_stmt)
+    {
+        this->eliminate(if_stmt->then_branch);
+
+        if (if_stmt->else_branch.has_value())
+        {
+            this->eliminate(if_stmt->else_branch.value());
+        }
+
+        auto condition = this->bool_literal(if_stmt->condition.get());
+        if (!condition.has_value())
+        {
+            return;
+        }
+
+        this->removed_branches += 1;
+
+        if (condition.value())
+        {
+            this->replacement = std::move(if_stmt->then_branch);
+        }
+        else if (if_stmt->else_branch.has_value())
+        {
+            this->replacement = std::move(if_stmt->else_branch.value());
+        }
+        else
+        {
+            this->replacement = std::unique_ptr<Stmt>();
+        }
+    }
+
+    // expressions are never changed, only statements
+    void visit_decl_stmt(DeclStmt *decl_stmt) {}
+    void visit_assign_expr(AssignExpr *assign_expr) {}
+    void visit_expr_stmt(ExprStmt *expr_stmt) {}
+    void visit_print_stmt(PrintStmt *print_stmt) {}
+    void visit_const_stmt(ConstStmt *const_stmt) {}
+    void visit_return_stmt(ReturnStmt *return_stmt) {}
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+
+#include "ast_node/index.h"
+#include "visitors/ast_walker.h"
+
+/*
+ * Visitor that collects the names declared directly in a function,
+ * without looking into nested functions
+ */
+class LocalCollector : public AstWalker
+{
+public:
+    std::set<std::string> locals;
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        this->locals.insert(decl_stmt->identifier.lexeme);
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        this->locals.insert(const_stmt->identifier.lexeme);
+    }
+
+    void visit_func(Func *func)
+    {
+        this->locals.insert(func->identifier.lexeme);
+    }
+};
+
+/*
+ * What calling a function can observe and change outside of itself
+ */
+struct FunctionEffects
+{
+    std::set<std::string> locals;  // parameters and variables declared in the function
+    std::set<std::string> reads;   // variables declared outside the function that it reads
+    std::set<std::string> assigns; // variables declared outside the function that it assigns
+    std::set<std::string> calls;
+    bool prints = false;
+};
+
+/*
+ * Visitor that finds the effects of every function, including the effects
+ * of the functions it calls, and marks the pure functions, runs after type checking.
+ *
+ * Variables are tracked by name since the interpreter scopes dynamically:
+ * a function that assigns a name it does not declare assigns whichever
+ * variable with that name its caller can see.
+ */
+class EffectAnalyzer : public AstWalker
+{
+public:
+    std::map<std::string, FunctionEffects> functions;
+    std::vector<std::string> function_stack;
+    std::vector<Func *> declarations;
+
+    void analyze_effects(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        this->walk(stmts);
+
+        // a function has the effects of its callees that its own variables do not hide
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (auto &function : this->functions)
+            {
+                auto &effects = function.second;
+                for (auto &callee : effects.calls)
+                {
+                    auto callee_effects = this->functions.find(callee);
+                    if (callee == function.first || callee_effects == this->functions.end())
+                    {
+                        continue;
+                    }
+
+                    changed |= this->merge(effects.reads, callee_effects->second.reads, effects.locals);
+                    changed |= this->merge(effects.assigns, callee_effects->second.assigns, effects.locals);
+
+                    if (callee_effects->second.prints && !effects.prints)
+                    {
+                        effects.prints = true;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        for (auto func : this->declarations)
+        {
+            func->is_pure = this->is_pure(func->identifier.lexeme);
+        }
+    }
+
+    /*
+     * A function is pure when its result only depends on its arguments and calling it changes nothing
+     */
+    bool is_pure(std::string function)
+    {
+        auto effects = this->functions.find(function);
+        return effects != this->functions.end() &&
+               !effects->second.prints &&
+               effects->second.reads.empty() &&
+               effects->second.assigns.empty();
+    }
+
+    /*
+     * The variables a call to a function can assign
+     */
+    std::set<std::string> assigned_by(std::string function)
+    {
+        auto effects = this->functions.find(function);
+        return effects != this->functions.end() ? effects->second.assigns : std::set<std::string>();
+    }
+
+    bool merge(std::set<std::string> &into, std::set<std::string> &from, std::set<std::string> &hidden)
+    {
+        bool changed = false;
+        for (auto &name : from)
+        {
+            if (!hidden.count(name) && into.insert(name).second)
+            {
+                changed = true;
+            }
+        }
+
+        return changed;
+    }
+
+    void visit_func(Func *func)
+    {
+        // functions with the same name share their effects
+        auto &effects = this->functions[func->identifier.lexeme];
+        this->declarations.push_back(func);
+
+        LocalCollector collector;
+        for (auto &stmt : dynamic_cast<Block *>(func->block.get())->stmts)
+        {
+            stmt->accept(&collector);
+        }
+
+        for (auto &param : func->param_list)
+        {
+            collector.locals.insert(param.first.lexeme);
+        }
+
+        effects.locals.insert(collector.locals.begin(), collector.locals.end());
+
+        this->function_stack.push_back(func->identifier.lexeme);
+        func->block->accept(this);
+        this->function_stack.pop_back();
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        if (primary->value.token_type == Token::Type::IDENTIFIER && !this->function_stack.empty())
+        {
+            auto &effects = this->functions[this->function_stack.back()];
+            if (!effects.locals.count(primary->value.lexeme))
+            {
+                effects.reads.insert(primary->value.lexeme);
+            }
+        }
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        if (!this->function_stack.empty())
+        {
+            auto &effects = this->functions[this->function_stack.back()];
+            if (!effects.locals.count(assign_expr->identifier.lexeme))
+            {
+                effects.assigns.insert(assign_expr->identifier.lexeme);
+            }
+        }
+
+        assign_expr->value->accept(this);
+    }
+
+    void visit_print_stmt(PrintStmt *print_stmt)
+    {
+        if (!this->function_stack.empty())
+        {
+            this->functions[this->function_stack.back()].prints = true;
+        }
+
+        for (auto &arg : print_stmt->args)
+        {
+            arg->accept(this);
+        }
+    }
+
+    void visit_call(Call *call)
+    {
+        if (!this->function_stack.empty())
+        {
+            this->functions[this->function_stack.back()].calls.insert(call->identifier.lexeme);
+        }
+
+        for (auto &arg : call->args)
+        {
+            arg->accept(this);
+        }
+    }
+};
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <optional>
+#include <string>
+#include <map>
+#include <algorithm>
+
+#include "ast_node/index.h"
+#include "visitors/ast_walker.h"
+#include "visitors/ast_cloner.h"
+#include "visitors/constant_folder.h"
+#include "visitors/inliner.h"
+
+/*
+ * Visitor that clones top level functions for calls that pass literals,
+ * runs after constant folding.
+ *
+ * The clone of `f` for `f(x, 4, true)` is named `f$<n>`, drops the constant
+ * parameters and declares them as constants at the start of its body, so
+ * constant folding can specialize the body. Calls passing the same literals
+ * share one clone. A literal is only used when it has exactly the parameter
+ * type, since the interpreter does not convert arguments.
+ *
+ * Functions that only return an expression are left to the inliner, and the
+ * recursive calls in a clone only reuse existing clones, so recursion is not
+ * unrolled into a chain of clones.
+ *
+ * Clones are declared right after the function they copy and stop being
+ * made once they add up to more than `size_budget` AST nodes.
+ */
+class FunctionSpecializer : public AstWalker
+{
+public:
+    static const int default_size_budget = 256;
+
+    int size_budget;
+    int specialized_calls = 0;
+    int clones = 0;
+    int cloned_nodes = 0;
+
+    AstCloner cloner;
+    std::map<std::string, Func *> candidates;
+    std::map<std::string, std::string> clone_names; // call signature -> clone name
+    std::vector<std::pair<Func *, std::unique_ptr<Stmt>>> pending; // original, clone
+    std::map<std::string, std::string> originals;                   // clone name -> original name
+    std::string cloned_from;                                        // original of the clone being walked
+
+    FunctionSpecializer(int size_budget = default_size_budget) : size_budget(size_budget) {}
+
+    void specialize_functions(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        if (this->size_budget == 0)
+        {
+            return;
+        }
+
+        // functions declared more than once could be shadowed at a call site
+        InlineInfoCollector collector;
+        collector.walk(stmts);
+
+        for (auto &stmt : *stmts)
+        {
+            auto func = dynamic_cast<Func *>(stmt.get());
+            if (func && collector.function_declarations[func->identifier.lexeme] == 1 && !this->only_returns(func))
+            {
+                this->candidates[func->identifier.lexeme] = func;
+            }
+        }
+
+        this->walk(stmts);
+
+        // the calls in a clone can pass its constants once they are folded
+        while (!this->pending.empty())
+        {
+            auto added = this->insert_clones(stmts);
+
+            ConstantFolder constant_folder;
+            constant_folder.fold_constants(stmts);
+
+            for (auto clone : added)
+            {
+                this->cloned_from = this->originals[clone->identifier.lexeme];
+                clone->accept(this);
+            }
+
+            this->cloned_from = "";
+        }
+    }
+
+    void visit_call(Call *call)
+    {
+        for (auto &arg : call->args)
+        {
+            arg->accept(this);
+        }
+
+        auto candidate = this->candidates.find(call->identifier.lexeme);
+        if (candidate == this->candidates.end())
+        {
+            return;
+        }
+
+        auto func = candidate->second;
+        if (call->args.size() != func->param_list.size())
+        {
+            return;
+        }
+
+        std::vector<bool> constant;
+        std::string signature = func->identifier.lexeme + "(";
+        for (int i = 0; i < call->args.size(); i++)
+        {
+            auto literal = this->literal_for(call->args[i].get(), func->param_list[i].second);
+            constant.push_back(literal != nullptr);
+            signature += literal ? std::to_string((int)literal->value.token_type) + ":" + literal->value.lexeme + "," : "_,";
+        }
+        signature += ")";
+
+        if (std::find(constant.begin(), constant.end(), true) == constant.end())
+        {
+            return;
+        }
+
+        if (!this->clone_names.count(signature) &&
+            (this->cloned_from == func->identifier.lexeme || !this->make_clone(func, call, constant, signature)))
+        {
+            return;
+        }
+
+        std::vector<std::shared_ptr<Expr>> args;
+        for (int i = 0; i < call->args.size(); i++)
+        {
+            if (!constant[i])
+            {
+                args.push_back(call->args[i]);
+            }
+        }
+
+        call->identifier.lexeme = this->clone_names[signature];
+        call->args = std::move(args);
+        this->specialized_calls += 1;
+    }
+
+    bool make_clone(Func *func, Call *call, std::vector<bool> &constant, std::string signature)
+    {
+        auto nodes = this->cloner.nodes;
+        auto copy = this->cloner.clone(func);
+        auto size = this->cloner.nodes - nodes;
+
+        if (this->cloned_nodes + size > this->size_budget)
+        {
+            return false;
+        }
+
+        auto clone = dynamic_cast<Func *>(copy.get());
+        clone->identifier.lexeme = func->identifier.lexeme + "$" + std::to_string(this->clones);
+
+        std::vector<std::pair<Token, Token>> params;
+        std::vector<std::unique_ptr<Stmt>> constants;
+        for (int i = 0; i < func->param_list.size(); i++)
+        {
+            auto &param = func->param_list[i];
+            if (!constant[i])
+            {
+                params.push_back(param);
+                continue;
+            }
+
+            auto literal = dynamic_cast<Primary *>(call->args[i].get());
+            constants.push_back(std::make_unique<ConstStmt>(param.first, param.second, true, std::make_unique<Primary>(literal->value)));
+        }
+
+        clone->param_list = params;
+
+        auto &body = dynamic_cast<Block *>(clone->block.get())->stmts;
+        body.insert(body.begin(), std::make_move_iterator(constants.begin()), std::make_move_iterator(constants.end()));
+
+        this->clone_names[signature] = clone->identifier.lexeme;
+        this->originals[clone->identifier.lexeme] = func->identifier.lexeme;
+        this->pending.push_back({func, std::move(copy)});
+        this->cloned_nodes += size;
+        this->clones += 1;
+
+        return true;
+    }
+
+    /*
+     * Declares every pending clone right after the function it copies
+     */
+    std::vector<Func *> insert_clones(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        std::vector<Func *> added;
+        std::vector<std::unique_ptr<Stmt>> result;
+
+        for (auto &stmt : *stmts)
+        {
+            auto original = stmt.get();
+            result.push_back(std::move(stmt));
+
+            for (auto &clone : this->pending)
+            {
+                if (clone.first == original)
+                {
+                    added.push_back(dynamic_cast<Func *>(clone.second.get()));
+                    result.push_back(std::move(clone.second));
+                }
+            }
+        }
+
+        *stmts = std::move(result);
+        this->pending.clear();
+
+        return added;
+    }
+
+    bool only_returns(Func *func)
+    {
+        auto &stmts = dynamic_cast<Block *>(func->block.get())->stmts;
+        return stmts.size() == 1 && dynamic_cast<ReturnStmt *>(stmts[0].get());
+    }
+
+    /*
+     * The argument as a literal of the parameter type, nullptr when it is not one
+     */
+    Primary *literal_for(Expr *arg, Token param_type)
+    {
+        auto primary = dynamic_cast<Primary *>(arg);
+        if (!primary)
+        {
+            return nullptr;
+        }
+
+        auto type = primary->value.token_type;
+        auto lexeme = param_type.lexeme;
+        if ((type == Token::Type::INT_LITERAL && lexeme == "int") ||
+            (type == Token::Type::FLOAT_LITERAL && lexeme == "float") ||
+            (type == Token::Type::STR_LITERAL && lexeme == "str") ||
+            (type == Token::Type::BOOL_LITERAL && lexeme == "bool"))
+        {
+            return primary;
+        }
+
+        return nullptr;
+    }
+};
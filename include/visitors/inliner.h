@@ -0,0 +1,615 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <optional>
+#include <string>
+#include <set>
+#include <map>
+
+#include "ast_node/index.h"
+#include "visitors/ast_walker.h"
+#include "visitors/purity_checker.h"
+
+#include "sym_table.h"
+#include "bird_type.h"
+#include "type.h"
+
+/*
+ * Visitor that counts function declarations and finds every assigned variable
+ */
+class InlineInfoCollector : public AstWalker
+{
+public:
+    std::map<std::string, int> function_declarations;
+    std::set<std::string> assigned;
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        this->assigned.insert(assign_expr->identifier.lexeme);
+        assign_expr->value->accept(this);
+    }
+
+    void visit_func(Func *func)
+    {
+        this->function_declarations[func->identifier.lexeme] += 1;
+        func->block->accept(this);
+    }
+};
+
+/*
+ * A function whose calls can be replaced by its body
+ */
+struct InlineCandidate
+{
+    std::vector<std::pair<std::string, BirdType>> params;
+    Expr *body;
+
+    InlineCandidate(std::vector<std::pair<std::string, BirdType>> params, Expr *body)
+        : params(params), body(body) {}
+    InlineCandidate() = default;
+};
+
+/*
+ * Visitor that replaces calls to small functions with the function body,
+ * runs after type checking.
+ *
+ * A function can be inlined when its body is a single `return <expr>;`,
+ * the expression only reads the parameters, contains no calls and has
+ * at most `inline_threshold` nodes. Calls are inlined when every argument
+ * has exactly the parameter type, since the interpreter does not convert
+ * arguments, and when every argument that is not a literal or identifier
+ * is pure and used at most once, so nothing is evaluated twice or out of order.
+ *
+ * Bodies are inlined into later functions first, so a function that only
+ * calls small functions can become small enough to inline itself.
+ */
+class Inliner : public Visitor
+{
+public:
+    static const int default_inline_threshold = 16;
+
+    int inline_threshold;
+    int inlined_calls = 0;
+
+    Environment<std::optional<BirdType>> env; // static types of variables, nullopt when unknown
+    Environment<Type> type_table;
+    std::map<std::string, InlineCandidate> candidates;
+    PurityChecker purity_checker;
+
+    // functions declared more than once could be shadowed at a call site
+    std::map<std::string, int> function_declarations;
+
+    // int and float variables can change type when they are assigned
+    std::set<std::string> assigned;
+
+    // set by a call that should be replaced by the inlined body
+    std::unique_ptr<Expr> replacement;
+
+    Inliner(int inline_threshold = default_inline_threshold) : inline_threshold(inline_threshold)
+    {
+        this->env.push_env();
+        this->type_table.push_env();
+    }
+
+    void inline_calls(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        InlineInfoCollector collector;
+        collector.walk(stmts);
+        this->function_declarations = collector.function_declarations;
+        this->assigned = collector.assigned;
+
+        for (auto &stmt : *stmts)
+        {
+            stmt->accept(this);
+        }
+    }
+
+    /*
+     * Inlines the calls in an expression, replacing the expression itself if it is a call
+     */
+    template <typename Pointer>
+    void inline_expr(Pointer &expr)
+    {
+        expr->accept(this);
+
+        if (this->replacement)
+        {
+            expr = std::move(this->replacement);
+        }
+    }
+
+    void visit_block(Block *block)
+    {
+        this->env.push_env();
+        this->type_table.push_env();
+
+        for (auto &stmt : block->stmts)
+        {
+            stmt->accept(this);
+        }
+
+        this->type_table.pop_env();
+        this->env.pop_env();
+    }
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        this->inline_expr(decl_stmt->value);
+        this->declare(decl_stmt->identifier.lexeme, decl_stmt->type_token, decl_stmt->type_is_literal, decl_stmt->value.get());
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        this->inline_expr(assign_expr->value);
+    }
+
+    void visit_expr_stmt(ExprStmt *expr_stmt)
+    {
+        this->inline_expr(expr_stmt->expr);
+    }
+
+    void visit_print_stmt(PrintStmt *print_stmt)
+    {
+        for (auto &arg : print_stmt->args)
+        {
+            this->inline_expr(arg);
+        }
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        this->inline_expr(const_stmt->value);
+        this->declare(const_stmt->identifier.lexeme, const_stmt->type_token, const_stmt->type_is_literal, const_stmt->value.get());
+    }
+
+    void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        this->inline_expr(while_stmt->condition);
+        while_stmt->stmt->accept(this);
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        this->env.push_env();
+
+        if (for_stmt->initializer.has_value())
+        {
+            for_stmt->initializer.value()->accept(this);
+        }
+
+        if (for_stmt->condition.has_value())
+        {
+            this->inline_expr(for_stmt->condition.value());
+        }
+
+        if (for_stmt->increment.has_value())
+        {
+            this->inline_expr(for_stmt->increment.value());
+        }
+
+        for_stmt->body->accept(this);
+
+        this->env.pop_env();
+    }
+
+    void visit_binary(Binary *binary)
+    {
+        this->inline_expr(binary->left);
+        this->inline_expr(binary->right);
+    }
+
+    void visit_unary(Unary *unary)
+    {
+        this->inline_expr(unary->expr);
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        // do nothing
+    }
+
+    void visit_ternary(Ternary *ternary)
+    {
+        this->inline_expr(ternary->condition);
+        this->inline_expr(ternary->true_expr);
+        this->inline_expr(ternary->false_expr);
+    }
+
+    void visit_func(Func *func)
+    {
+        // the interpreter scopes dynamically, so inside a function
+        // only the types of its own variables are known
+        auto previous_env = std::move(this->env);
+        this->env = Environment<std::optional<BirdType>>();
+        this->env.push_env();
+
+        std::vector<std::pair<std::string, BirdType>> params;
+        bool typed_params = true;
+        for (auto &param : func->param_list)
+        {
+            auto type = this->primitive_type(param.second.lexeme);
+            if (!type.has_value())
+            {
+                typed_params = false;
+            }
+            else
+            {
+                params.push_back({param.first.lexeme, type.value()});
+            }
+
+            this->declare(param.first.lexeme, type);
+        }
+
+        for (auto &stmt : dynamic_cast<Block *>(func->block.get())->stmts)
+        {
+            stmt->accept(this);
+        }
+
+        this->env = std::move(previous_env);
+
+        if (typed_params && this->function_declarations[func->identifier.lexeme] == 1)
+        {
+            this->add_candidate(func, params);
+        }
+    }
+
+    void visit_if_stmt(IfStmt *if_stmt)
+    {
+        this->inline_expr(if_stmt->condition);
+        if_stmt->then_branch->accept(this);
+
+        if (if_stmt->else_branch.has_value())
+        {
+            if_stmt->else_branch.value()->accept(this);
+        }
+    }
+
+    void visit_call(Call *call)
+    {
+        for (auto &arg : call->args)
+        {
+            this->inline_expr(arg);
+        }
+
+        if (!this->candidates.count(call->identifier.lexeme))
+        {
+            return;
+        }
+
+        auto &candidate = this->candidates[call->identifier.lexeme];
+        if (candidate.params.size() != call->args.size())
+        {
+            return;
+        }
+
+        std::map<std::string, Expr *> args;
+        for (int i = 0; i < call->args.size(); i++)
+        {
+            auto &param = candidate.params[i];
+            auto arg = call->args[i].get();
+
+            if (this->type_of(arg) != param.second)
+            {
+                return;
+            }
+
+            if (!this->is_simple(arg) && (!this->purity_checker.is_pure(arg) || this->count_uses(candidate.body, param.first) > 1))
+            {
+                return;
+            }
+
+            args[param.first] = arg;
+        }
+
+        this->replacement = this->clone(candidate.body, args);
+        this->inlined_calls += 1;
+    }
+
+    void visit_return_stmt(ReturnStmt *return_stmt)
+    {
+        if (return_stmt->expr.has_value())
+        {
+            this->inline_expr(return_stmt->expr.value());
+        }
+    }
+
+    void visit_break_stmt(BreakStmt *break_stmt)
+    {
+        // do nothing
+    }
+
+    void visit_continue_stmt(ContinueStmt *continue_stmt)
+    {
+        // do nothing
+    }
+
+    void visit_type_stmt(TypeStmt *type_stmt)
+    {
+        if (type_stmt->type_is_literal)
+        {
+            this->type_table.declare(type_stmt->identifier.lexeme, Type(type_stmt->type_token));
+        }
+        else
+        {
+            this->type_table.declare(type_stmt->identifier.lexeme, Type(this->type_table.get(type_stmt->type_token.lexeme).type));
+        }
+    }
+
+    void add_candidate(Func *func, std::vector<std::pair<std::string, BirdType>> params)
+    {
+        auto &stmts = dynamic_cast<Block *>(func->block.get())->stmts;
+        if (stmts.size() != 1 || !func->return_type.has_value())
+        {
+            return;
+        }
+
+        auto return_stmt = dynamic_cast<ReturnStmt *>(stmts[0].get());
+        if (!return_stmt || !return_stmt->expr.has_value())
+        {
+            return;
+        }
+
+        auto body = return_stmt->expr.value().get();
+        if (!this->is_inlinable(body, params) || this->count_nodes(body) > this->inline_threshold)
+        {
+            return;
+        }
+
+        // the interpreter does not convert return values, so the body must already have the return type
+        this->env.push_env();
+        for (auto &param : params)
+        {
+            this->env.declare(param.first, param.second);
+        }
+
+        auto body_type = this->type_of(body);
+        this->env.pop_env();
+
+        if (body_type != this->primitive_type(func->return_type.value().lexeme))
+        {
+            return;
+        }
+
+        this->candidates[func->identifier.lexeme] = InlineCandidate(params, body);
+    }
+
+    /*
+     * An expression can be inlined when it only reads parameters and contains no calls
+     */
+    bool is_inlinable(Expr *expr, std::vector<std::pair<std::string, BirdType>> &params)
+    {
+        if (auto binary = dynamic_cast<Binary *>(expr))
+        {
+            return this->is_inlinable(binary->left.get(), params) && this->is_inlinable(binary->right.get(), params);
+        }
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+        {
+            return this->is_inlinable(unary->expr.get(), params);
+        }
+
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+        {
+            return this->is_inlinable(ternary->condition.get(), params) &&
+                   this->is_inlinable(ternary->true_expr.get(), params) &&
+                   this->is_inlinable(ternary->false_expr.get(), params);
+        }
+
+        if (auto primary = dynamic_cast<Primary *>(expr))
+        {
+            if (primary->value.token_type != Token::Type::IDENTIFIER)
+            {
+                return true;
+            }
+
+            for (auto &param : params)
+            {
+                if (param.first == primary->value.lexeme)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    int count_nodes(Expr *expr)
+    {
+        if (auto binary = dynamic_cast<Binary *>(expr))
+            return 1 + this->count_nodes(binary->left.get()) + this->count_nodes(binary->right.get());
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+            return 1 + this->count_nodes(unary->expr.get());
+
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+            return 1 + this->count_nodes(ternary->condition.get()) + this->count_nodes(ternary->true_expr.get()) + this->count_nodes(ternary->false_expr.get());
+
+        return 1;
+    }
+
+    int count_uses(Expr *expr, std::string identifier)
+    {
+        if (auto binary = dynamic_cast<Binary *>(expr))
+            return this->count_uses(binary->left.get(), identifier) + this->count_uses(binary->right.get(), identifier);
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+            return this->count_uses(unary->expr.get(), identifier);
+
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+            return this->count_uses(ternary->condition.get(), identifier) + this->count_uses(ternary->true_expr.get(), identifier) + this->count_uses(ternary->false_expr.get(), identifier);
+
+        auto primary = dynamic_cast<Primary *>(expr);
+        return primary && primary->value.token_type == Token::Type::IDENTIFIER && primary->value.lexeme == identifier ? 1 : 0;
+    }
+
+    bool is_simple(Expr *expr)
+    {
+        return dynamic_cast<Primary *>(expr) != nullptr;
+    }
+
+    /*
+     * Copies a pure expression, replacing parameters with copies of the arguments
+     */
+    std::unique_ptr<Expr> clone(Expr *expr, std::map<std::string, Expr *> &args)
+    {
+        if (auto binary = dynamic_cast<Binary *>(expr))
+        {
+            return std::make_unique<Binary>(this->clone(binary->left.get(), args), binary->op, this->clone(binary->right.get(), args));
+        }
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+        {
+            return std::make_unique<Unary>(unary->op, this->clone(unary->expr.get(), args));
+        }
+
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+        {
+            return std::make_unique<Ternary>(
+                this->clone(ternary->condition.get(), args),
+                ternary->ternary_token,
+                this->clone(ternary->true_expr.get(), args),
+                this->clone(ternary->false_expr.get(), args));
+        }
+
+        auto primary = dynamic_cast<Primary *>(expr);
+        if (!primary)
+        {
+            throw BirdException("can not inline expression");
+        }
+
+        if (primary->value.token_type == Token::Type::IDENTIFIER && args.count(primary->value.lexeme))
+        {
+            std::map<std::string, Expr *> no_args;
+            return this->clone(args[primary->value.lexeme], no_args);
+        }
+
+        return std::make_unique<Primary>(primary->value);
+    }
+
+    /*
+     * The type an expression has at runtime, nullopt when it can not be known
+     */
+    std::optional<BirdType> type_of(Expr *expr)
+    {
+        if (auto primary = dynamic_cast<Primary *>(expr))
+        {
+            switch (primary->value.token_type)
+            {
+            case Token::Type::INT_LITERAL:
+                return BirdType::INT;
+            case Token::Type::FLOAT_LITERAL:
+                return BirdType::FLOAT;
+            case Token::Type::STR_LITERAL:
+                return BirdType::STRING;
+            case Token::Type::BOOL_LITERAL:
+                return BirdType::BOOL;
+            case Token::Type::IDENTIFIER:
+                return this->env.contains(primary->value.lexeme) ? this->env.get(primary->value.lexeme) : std::nullopt;
+            default:
+                return std::nullopt;
+            }
+        }
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+        {
+            auto type = this->type_of(unary->expr.get());
+            return type == BirdType::INT || type == BirdType::FLOAT ? type : std::nullopt;
+        }
+
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+        {
+            auto true_type = this->type_of(ternary->true_expr.get());
+            return true_type == this->type_of(ternary->false_expr.get()) ? true_type : std::nullopt;
+        }
+
+        if (auto binary = dynamic_cast<Binary *>(expr))
+        {
+            auto left = this->type_of(binary->left.get());
+            auto right = this->type_of(binary->right.get());
+            if (!left.has_value() || !right.has_value())
+            {
+                return std::nullopt;
+            }
+
+            switch (binary->op.token_type)
+            {
+            case Token::Type::GREATER:
+            case Token::Type::GREATER_EQUAL:
+            case Token::Type::LESS:
+            case Token::Type::LESS_EQUAL:
+            case Token::Type::BANG_EQUAL:
+            case Token::Type::EQUAL_EQUAL:
+                return BirdType::BOOL;
+            case Token::Type::PLUS:
+                if (left == BirdType::STRING && right == BirdType::STRING)
+                    return BirdType::STRING;
+                // fall through to the numeric operators
+            case Token::Type::MINUS:
+            case Token::Type::STAR:
+            case Token::Type::SLASH:
+                if (left == BirdType::INT && right == BirdType::INT)
+                    return BirdType::INT;
+                if ((left == BirdType::INT || left == BirdType::FLOAT) && (right == BirdType::INT || right == BirdType::FLOAT))
+                    return BirdType::FLOAT;
+                return std::nullopt;
+            case Token::Type::PERCENT:
+                return left == BirdType::INT && right == BirdType::INT ? std::optional<BirdType>(BirdType::INT) : std::nullopt;
+            default:
+                return std::nullopt;
+            }
+        }
+
+        // calls are not converted to their return type by the interpreter
+        return std::nullopt;
+    }
+
+    std::optional<BirdType> primitive_type(std::string lexeme)
+    {
+        if (lexeme == "int")
+            return BirdType::INT;
+        if (lexeme == "float")
+            return BirdType::FLOAT;
+        if (lexeme == "str")
+            return BirdType::STRING;
+        if (lexeme == "bool")
+            return BirdType::BOOL;
+
+        return std::nullopt;
+    }
+
+    void declare(std::string identifier, std::optional<Token> type_token, bool type_is_literal, Expr *value)
+    {
+        std::optional<BirdType> type;
+        if (type_token.has_value())
+        {
+            // declarations convert their value to the declared type
+            type = this->primitive_type(type_is_literal
+                                            ? type_token.value().lexeme
+                                            : this->type_table.get(type_token.value().lexeme).type.lexeme);
+        }
+        else
+        {
+            type = this->type_of(value);
+        }
+
+        this->declare(identifier, type);
+    }
+
+    void declare(std::string identifier, std::optional<BirdType> type)
+    {
+        if (this->assigned.count(identifier) && (type == BirdType::INT || type == BirdType::FLOAT))
+        {
+            type = std::nullopt;
+        }
+
+        if (this->env.current_contains(identifier))
+        {
+            this->env.envs.back()[identifier] = type;
+            return;
+        }
+
+        this->env.declare(identifier, type);
+    }
+};
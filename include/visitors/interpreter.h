@@ -8,13 +8,25 @@
 
 #include "sym_table.h"
 #include "exceptions/bird_exception.h"
-#include "exceptions/return_exception.h"
-#include "exceptions/break_exception.h"
-#include "exceptions/continue_exception.h"
+#include "exceptions/step_budget_exception.h"
+#include "visitors/slot_resolver.h"
 #include "value.h"
 #include "callable.h"
 #include "stack.h"
 #include "type.h"
+#include "profiler.h"
+
+/*
+ * How the last statement finished, statements after a break, continue or
+ * return are skipped until the loop or call that handles it
+ */
+enum class Completion
+{
+    NORMAL,
+    BREAK,
+    CONTINUE,
+    RETURN,
+};
 
 /*
  * Visitor that interprets and evaluates the AST
@@ -25,20 +37,154 @@ class Interpreter : public Visitor
 public:
     Environment<Value> env;
     Environment<Callable> call_table;
+    unsigned int call_table_version = Interpreter::next_call_table_version(); // changes whenever a function is declared
     Environment<Type> type_table;
     Stack<Value> stack;
+    Completion completion = Completion::NORMAL;
+
+    // the parameters and locals of the running calls, the frame of the innermost call starts at frame_base
+    std::vector<Value> frames;
+    int frame_base = 0;
+    int frame_top = 0;
+
+    // memoizes calls to functions the effect analyzer marked pure
+    bool memoize = false;
+    std::vector<std::pair<std::string, std::shared_ptr<MemoCache>>> memo_caches;
+
+    // limits the calls and loop iterations an evaluation may run, -1 for no limit
+    int step_budget = -1;
+    int steps = 0;
+
+    // compiles functions to machine code once their calls and loop iterations reach jit_threshold
+    bool jit = false;
+    long jit_threshold = 1000;
+    long ticks = 0; // calls and loop iterations run so far
+
+    // set by --profile, times the calls and counts the statements run per line
+    Profiler *profiler = nullptr;
 
     Interpreter()
     {
         this->env.push_env();
         this->call_table.push_env();
         this->type_table.push_env();
+        this->frames.resize(1024);
+    }
+
+    /*
+     * Versions are unique across interpreters, so a Call cached by one
+     * interpreter is never trusted by another one running the same AST
+     */
+    static unsigned int next_call_table_version()
+    {
+        static unsigned int version = 0;
+        return ++version;
+    }
+
+    void print_memo_stats()
+    {
+        std::cout << "memoization:" << std::endl;
+        for (auto &memo_cache : this->memo_caches)
+        {
+            std::cout << "  " << memo_cache.first << ": "
+                      << memo_cache.second->hits << " hits, "
+                      << memo_cache.second->misses << " misses" << std::endl;
+        }
+    }
+
+    /*
+     * Makes room for a call frame of `size` slots on top of the running ones
+     */
+    int push_frame(int size)
+    {
+        auto base = this->frame_top;
+        this->frame_top += size;
+
+        if (this->frame_top > this->frames.size())
+        {
+            this->frames.resize(std::max((size_t)this->frame_top, this->frames.size() * 2));
+        }
+
+        return base;
+    }
+
+    /*
+     * Drops the frames from `base` up, releasing the values left in their slots
+     */
+    void pop_frame(int base)
+    {
+        for (int i = base; i < this->frame_top; i++)
+        {
+            this->frames[i] = Value();
+        }
+
+        this->frame_top = base;
+    }
+
+    /*
+     * The variable an identifier refers to, a slot of the running call or a name in the environment
+     */
+    Value &variable(int slot, const std::string &identifier)
+    {
+        if (slot >= 0)
+        {
+            return this->frames[this->frame_base + slot];
+        }
+
+        return this->env.get_reference(identifier);
+    }
+
+    /*
+     * The primitive type a type annotation names, ERROR when it names none
+     */
+    BirdType bird_type(Token type_token)
+    {
+        auto lexeme = type_token.lexeme;
+        if (lexeme != "int" && lexeme != "float" && lexeme != "str" && lexeme != "bool" && this->type_table.contains(lexeme))
+        {
+            lexeme = this->type_table.get(lexeme).type.lexeme;
+        }
+
+        if (lexeme == "int")
+            return BirdType::INT;
+
+        if (lexeme == "float")
+            return BirdType::FLOAT;
+
+        if (lexeme == "str")
+            return BirdType::STRING;
+
+        if (lexeme == "bool")
+            return BirdType::BOOL;
+
+        return BirdType::ERROR;
+    }
+
+    /*
+     * Counts a call or a loop iteration against the step budget
+     */
+    void step()
+    {
+        this->ticks++;
+
+        if (this->step_budget >= 0 && ++this->steps > this->step_budget)
+        {
+            throw StepBudgetException();
+        }
     }
 
     void evaluate(std::vector<std::unique_ptr<Stmt>> *stmts)
     {
+        SlotResolver slot_resolver;
+        slot_resolver.resolve(stmts);
+
         for (auto &stmt : *stmts)
         {
+            if (this->profiler)
+            {
+                this->profiler->line(stmt.get());
+            }
+
             if (auto decl_stmt = dynamic_cast<DeclStmt *>(stmt.get()))
             {
                 decl_stmt->accept(this);
@@ -135,7 +281,17 @@ public:
         this->env.push_env();
         for (auto &stmt : block->stmts)
         {
+            if (this->profiler)
+            {
+                this->profiler->line(stmt.get());
+            }
+
             stmt->accept(this);
+
+            if (this->completion != Completion::NORMAL)
+            {
+                break;
+            }
         }
 
         this->env.pop_env();
@@ -146,7 +302,6 @@ public:
         decl_stmt->value->accept(this);
 
         auto result = std::move(this->stack.pop());
-        result.is_mutable = true;
 
         if (decl_stmt->type_token.has_value())
         {
@@ -162,25 +317,51 @@ public:
 
             if (type_lexeme == "int")
             {
-                result.data = to_type<int, double>(result);
+                result = Value(to_type<int, double>(result));
             }
             else if (type_lexeme == "float")
             {
-                result.data = to_type<double, int>(result);
+                result = Value(to_type<double, int>(result));
             }
         }
 
+        if (decl_stmt->slot >= 0)
+        {
+            this->frames[this->frame_base + decl_stmt->slot] = std::move(result);
+            return;
+        }
+
         this->env.declare(decl_stmt->identifier.lexeme, std::move(result));
     }
 
     void visit_assign_expr(AssignExpr *assign_expr)
     {
-        auto previous_value = this->env.get(assign_expr->identifier.lexeme);
+        auto previous_value = this->variable(assign_expr->slot, assign_expr->identifier.lexeme);
 
         assign_expr->value->accept(this);
         auto value = std::move(this->stack.pop());
 
-        switch (assign_expr->assign_operator.token_type)
+        auto op = assign_expr->assign_operator.token_type;
+        if (assign_expr->quickened == Quickened::NOT_YET)
+        {
+            assign_expr->quickened = op == Token::Type::EQUAL ? Quickened::GENERIC : this->quicken(previous_value, value, op != Token::Type::PERCENT_EQUAL);
+        }
+
+        if (assign_expr->quickened == Quickened::INT && previous_value.is_int() && value.is_int())
+        {
+            this->variable(assign_expr->slot, assign_expr->identifier.lexeme) = this->int_binary(this->binary_operator(op), previous_value.as_int(), value.as_int());
+            return;
+        }
+
+        if (assign_expr->quickened == Quickened::FLOAT && previous_value.is_double() && value.is_double())
+        {
+            this->variable(assign_expr->slot, assign_expr->identifier.lexeme) = this->float_binary(this->binary_operator(op), previous_value.as_double(), value.as_double());
+            return;
+        }
+
+        assign_expr->quickened = Quickened::GENERIC;
+
+        switch (op)
         {
         case Token::Type::EQUAL:
         {
@@ -189,6 +370,15 @@ public:
         }
         case Token::Type::PLUS_EQUAL:
         {
+            auto &variable = this->variable(assign_expr->slot, assign_expr->identifier.lexeme);
+            if (is_matching_type<std::string>(previous_value, value) && variable.bits == previous_value.bits)
+            {
+                // drop this copy so the variable may hold the only reference and grow in place
+                previous_value = Value();
+                variable.append(value);
+                return;
+            }
+
             previous_value = previous_value + value;
             break;
         }
@@ -216,6 +406,12 @@ public:
             throw BirdException("Unidentified assignment operator " + assign_expr->assign_operator.lexeme);
         }
 
+        if (assign_expr->slot >= 0)
+        {
+            this->frames[this->frame_base + assign_expr->slot] = std::move(previous_value);
+            return;
+        }
+
         this->env.set(assign_expr->identifier.lexeme, previous_value);
     }
 
@@ -256,14 +452,20 @@ public:
 
             if (type_lexeme == "int")
             {
-                result.data = to_type<int, double>(result);
+                result = Value(to_type<int, double>(result));
             }
             else if (type_lexeme == "float")
             {
-                result.data = to_type<double, int>(result);
+                result = Value(to_type<double, int>(result));
             }
         }
 
+        if (const_stmt->slot >= 0)
+        {
+            this->frames[this->frame_base + const_stmt->slot] = std::move(result);
+            return;
+        }
+
         this->env.declare(const_stmt->identifier.lexeme, std::move(result));
     }
 
@@ -272,36 +474,24 @@ public:
         while_stmt->condition->accept(this);
         auto condition_result = std::move(this->stack.pop());
 
-        auto num_envs = this->env.envs.size();
-
         while (as_type<bool>(condition_result))
         {
-            try
+            this->step();
+
+            while_stmt->stmt->accept(this);
+
+            if (this->completion == Completion::BREAK)
             {
-                while_stmt->stmt->accept(this);
+                this->completion = Completion::NORMAL;
+                break;
             }
-            catch (BreakException e)
-            {
-                auto previous_size = this->env.envs.size();
-                for (int i = 0; i < previous_size - num_envs; i++)
-                {
-                    this->env.pop_env();
-                }
 
+            if (this->completion == Completion::RETURN)
+            {
                 break;
             }
-            catch (ContinueException e)
-            {
-                auto previous_size = this->env.envs.size();
-                for (int i = 0; i < previous_size - num_envs; i++)
-                {
-                    this->env.pop_env();
-                }
 
-                while_stmt->condition->accept(this);
-                condition_result = std::move(this->stack.pop());
-                continue;
-            }
+            this->completion = Completion::NORMAL;
 
             while_stmt->condition->accept(this);
             condition_result = std::move(this->stack.pop());
@@ -317,8 +507,6 @@ public:
             for_stmt->initializer.value()->accept(this);
         }
 
-        auto num_envs = this->env.envs.size();
-
         while (true)
         {
             if (for_stmt->condition.has_value())
@@ -326,40 +514,28 @@ public:
                 for_stmt->condition.value()->accept(this);
                 auto condition_result = std::move(this->stack.pop());
 
-                if (!as_type<bool>(condition_result.data))
+                if (!as_type<bool>(condition_result))
                 {
                     break;
                 }
             }
 
-            try
+            this->step();
+
+            for_stmt->body->accept(this);
+
+            if (this->completion == Completion::BREAK)
             {
-                for_stmt->body->accept(this);
+                this->completion = Completion::NORMAL;
+                break;
             }
-            catch (BreakException e)
-            {
-                auto previous_size = this->env.envs.size();
-                for (int i = 0; i < previous_size - num_envs; i++)
-                {
-                    this->env.pop_env();
-                }
 
+            if (this->completion == Completion::RETURN)
+            {
                 break;
             }
-            catch (ContinueException e)
-            {
-                auto previous_size = this->env.envs.size();
-                for (int i = 0; i < previous_size - num_envs; i++)
-                {
-                    this->env.pop_env();
-                }
 
-                if (for_stmt->increment.has_value())
-                {
-                    for_stmt->increment.value()->accept(this);
-                }
-                continue;
-            }
+            this->completion = Completion::NORMAL;
 
             if (for_stmt->increment.has_value())
             {
@@ -379,6 +555,32 @@ public:
 
         auto left = std::move(this->stack.pop());
 
+        // the range analyzer proved both operands are ints
+        if (binary->int_operands)
+        {
+            this->stack.push(this->int_binary(binary->op.token_type, as_type<int>(left), as_type<int>(right), binary->nonzero_divisor));
+            return;
+        }
+
+        if (binary->quickened == Quickened::NOT_YET)
+        {
+            binary->quickened = this->quicken(left, right, binary->op.token_type != Token::Type::PERCENT);
+        }
+
+        if (binary->quickened == Quickened::INT && left.is_int() && right.is_int())
+        {
+            this->stack.push(this->int_binary(binary->op.token_type, left.as_int(), right.as_int()));
+            return;
+        }
+
+        if (binary->quickened == Quickened::FLOAT && left.is_double() && right.is_double())
+        {
+            this->stack.push(this->float_binary(binary->op.token_type, left.as_double(), right.as_double()));
+            return;
+        }
+
+        binary->quickened = Quickened::GENERIC;
+
         switch (binary->op.token_type)
         {
         case Token::Type::PLUS:
@@ -443,11 +645,144 @@ public:
         }
     }
 
+    /*
+     * The specialization for a node that first ran with these operands,
+     * floats only when the operator is defined on them
+     */
+    Quickened quicken(const Value &left, const Value &right, bool float_operator = true)
+    {
+        if (left.is_int() && right.is_int())
+            return Quickened::INT;
+
+        if (float_operator && left.is_double() && right.is_double())
+            return Quickened::FLOAT;
+
+        return Quickened::GENERIC;
+    }
+
+    /*
+     * The binary operator a compound assignment applies
+     */
+    Token::Type binary_operator(Token::Type assign_operator)
+    {
+        switch (assign_operator)
+        {
+        case Token::Type::PLUS_EQUAL:
+            return Token::Type::PLUS;
+        case Token::Type::MINUS_EQUAL:
+            return Token::Type::MINUS;
+        case Token::Type::STAR_EQUAL:
+            return Token::Type::STAR;
+        case Token::Type::SLASH_EQUAL:
+            return Token::Type::SLASH;
+        case Token::Type::PERCENT_EQUAL:
+            return Token::Type::PERCENT;
+        default:
+            throw BirdException("Unidentified assignment operator");
+        }
+    }
+
+    /*
+     * Applies a binary operator to ints without checking their types,
+     * division and modulo only skip the zero check when the range analyzer
+     * proved the divisor nonzero
+     */
+    Value int_binary(Token::Type op, int left, int right, bool nonzero_divisor = false)
+    {
+        switch (op)
+        {
+        case Token::Type::PLUS:
+            return Value(left + right);
+        case Token::Type::MINUS:
+            return Value(left - right);
+        case Token::Type::STAR:
+            return Value(left * right);
+        case Token::Type::SLASH:
+            if (!nonzero_divisor && right == 0)
+                throw BirdException("Division by zero.");
+
+            return Value(left / right);
+        case Token::Type::PERCENT:
+            if (!nonzero_divisor && right == 0)
+                throw BirdException("Modulo by zero.");
+
+            return Value(left % right);
+        case Token::Type::GREATER:
+            return Value(left > right);
+        case Token::Type::GREATER_EQUAL:
+            return Value(left >= right);
+        case Token::Type::LESS:
+            return Value(left < right);
+        case Token::Type::LESS_EQUAL:
+            return Value(left <= right);
+        case Token::Type::BANG_EQUAL:
+            return Value(left != right);
+        case Token::Type::EQUAL_EQUAL:
+            return Value(left == right);
+        default:
+            throw BirdException("Undefined binary operator.");
+        }
+    }
+
+    /*
+     * Applies a binary operator to floats without checking their types
+     */
+    Value float_binary(Token::Type op, double left, double right)
+    {
+        switch (op)
+        {
+        case Token::Type::PLUS:
+            return Value(left + right);
+        case Token::Type::MINUS:
+            return Value(left - right);
+        case Token::Type::STAR:
+            return Value(left * right);
+        case Token::Type::SLASH:
+            if (right == 0)
+                throw BirdException("Division by zero.");
+
+            return Value(left / right);
+        case Token::Type::GREATER:
+            return Value(left > right);
+        case Token::Type::GREATER_EQUAL:
+            return Value(left >= right);
+        case Token::Type::LESS:
+            return Value(left < right);
+        case Token::Type::LESS_EQUAL:
+            return Value(left <= right);
+        case Token::Type::BANG_EQUAL:
+            return Value(left != right);
+        case Token::Type::EQUAL_EQUAL:
+            return Value(left == right);
+        default:
+            throw BirdException("Undefined binary operator.");
+        }
+    }
+
     void visit_unary(Unary *unary)
     {
         unary->expr->accept(this);
         auto expr = std::move(this->stack.pop());
 
+        if (unary->quickened == Quickened::NOT_YET)
+        {
+            unary->quickened = expr.is_int() ? Quickened::INT : expr.is_double() ? Quickened::FLOAT
+                                                                                 : Quickened::GENERIC;
+        }
+
+        if (unary->quickened == Quickened::INT && expr.is_int())
+        {
+            this->stack.push(Value(-expr.as_int()));
+            return;
+        }
+
+        if (unary->quickened == Quickened::FLOAT && expr.is_double())
+        {
+            this->stack.push(Value(-expr.as_double()));
+            return;
+        }
+
+        unary->quickened = Quickened::GENERIC;
         this->stack.push(-expr);
     }
 
@@ -456,24 +791,19 @@ public:
         switch (primary->value.token_type)
         {
         case Token::Type::FLOAT_LITERAL:
-            this->stack.push(Value(
-                variant(std::stod(primary->value.lexeme))));
+            this->stack.push(Value(std::stod(primary->value.lexeme)));
             break;
         case Token::Type::BOOL_LITERAL:
-            this->stack.push(Value(
-                variant(primary->value.lexeme == "true" ? true : false)));
+            this->stack.push(Value(primary->value.lexeme == "true" ? true : false));
             break;
         case Token::Type::STR_LITERAL:
-            this->stack.push(Value(
-                variant(primary->value.lexeme)));
+            this->stack.push(Value::intern(primary->value.lexeme));
             break;
         case Token::Type::INT_LITERAL:
-            this->stack.push(Value(
-                variant(std::stoi(primary->value.lexeme))));
+            this->stack.push(Value(std::stoi(primary->value.lexeme)));
             break;
         case Token::Type::IDENTIFIER:
-            this->stack.push(
-                this->env.get(primary->value.lexeme));
+            this->stack.push(this->variable(primary->slot, primary->value.lexeme));
             break;
         default:
             throw BirdException("undefined primary value");
@@ -497,8 +827,28 @@ public:
         Callable callable = Callable(func->param_list,
                                      func->block,
                                      func->return_type);
+        callable.name = func->identifier.lexeme;
+
+        for (auto &param : func->param_list)
+        {
+            callable.param_types.push_back(this->bird_type(param.second));
+        }
+
+        if (func->return_type.has_value())
+        {
+            callable.resolved_return_type = this->bird_type(func->return_type.value());
+        }
+
+        if (this->memoize && func->is_pure && callable.resolved_return_type != BirdType::VOID)
+        {
+            callable.memo = std::make_shared<MemoCache>();
+            this->memo_caches.push_back({func->identifier.lexeme, callable.memo});
+        }
+
+        callable.frame_size = func->frame_size;
 
         this->call_table.declare(func->identifier.lexeme, callable);
+        this->call_table_version = Interpreter::next_call_table_version();
     }
 
     void visit_if_stmt(IfStmt *if_stmt)
@@ -515,8 +865,13 @@ public:
 
     void visit_call(Call *call)
     {
-        auto callable = this->call_table.get(call->identifier.lexeme);
-        callable.call(this, call->args);
+        if (call->callee_version != this->call_table_version)
+        {
+            call->callee = &this->call_table.get_reference(call->identifier.lexeme);
+            call->callee_version = this->call_table_version;
+        }
+
+        call->callee->call(this, call->args, call->arguments_checked);
     }
 
     void visit_return_stmt(ReturnStmt *return_stmt)
@@ -526,17 +881,17 @@ public:
             return_stmt->expr.value()->accept(this);
         }
 
-        throw ReturnException();
+        this->completion = Completion::RETURN;
     }
 
     void visit_break_stmt(BreakStmt *break_stmt)
     {
-        throw BreakException();
+        this->completion = Completion::BREAK;
     }
 
     void visit_continue_stmt(ContinueStmt *continue_stmt)
     {
-        throw ContinueException();
+        this->completion = Completion::CONTINUE;
     }
 
     void visit_type_stmt(TypeStmt *type_stmt)
@@ -0,0 +1,504 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <set>
+
+#include "ast_node/index.h"
+#include "visitors/ast_walker.h"
+#include "visitors/purity_checker.h"
+#include "visitors/effect_analyzer.h"
+
+/*
+ * Visitor that finds the variables a loop can change, the ones it assigns,
+ * directly or through the functions it calls, and the ones it declares
+ */
+class LoopMutationCollector : public AstWalker
+{
+public:
+    EffectAnalyzer *effects;
+    std::set<std::string> mutated;
+
+    LoopMutationCollector(EffectAnalyzer *effects) : effects(effects) {}
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        this->mutated.insert(decl_stmt->identifier.lexeme);
+        decl_stmt->value->accept(this);
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        this->mutated.insert(const_stmt->identifier.lexeme);
+        const_stmt->value->accept(this);
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        this->mutated.insert(assign_expr->identifier.lexeme);
+        assign_expr->value->accept(this);
+    }
+
+    void visit_func(Func *func)
+    {
+        // the body only runs when it is called
+        this->mutated.insert(func->identifier.lexeme);
+    }
+
+    void visit_call(Call *call)
+    {
+        auto assigned = this->effects->assigned_by(call->identifier.lexeme);
+        this->mutated.insert(assigned.begin(), assigned.end());
+
+        for (auto &arg : call->args)
+        {
+            arg->accept(this);
+        }
+    }
+};
+
+/*
+ * Visitor that replaces the loop invariant expressions in one loop
+ * with temporaries declared before the loop
+ */
+class InvariantHoister : public Visitor
+{
+public:
+    EffectAnalyzer *effects;
+    std::set<std::string> mutated;
+    PurityChecker purity_checker;
+    Token position;
+    int *temporaries;
+
+    std::vector<std::unique_ptr<Stmt>> hoisted;
+
+    // calls to pure functions can fail, so they are only moved out of loop conditions,
+    // which always run at least once
+    bool allow_calls = false;
+
+    // when set, hoistable expressions are only found, not moved
+    bool dry_run = false;
+    std::set<Expr *> found;
+
+    InvariantHoister(EffectAnalyzer *effects, std::set<std::string> mutated, Token position, int *temporaries)
+        : effects(effects),
+          mutated(mutated),
+          position(position),
+          temporaries(temporaries) {}
+
+    /*
+     * Hoists from a loop condition, calls are moved only when
+     * `may_reorder` is set and nothing else in the condition can fail
+     */
+    void hoist_condition(std::unique_ptr<Expr> &condition, bool may_reorder)
+    {
+        if (may_reorder)
+        {
+            this->dry_run = true;
+            this->allow_calls = true;
+            this->hoist(condition);
+            this->dry_run = false;
+
+            this->allow_calls = !this->can_fail(condition.get());
+        }
+
+        this->hoist(condition);
+        this->allow_calls = false;
+    }
+
+    template <typename Pointer>
+    void hoist(Pointer &expr)
+    {
+        if (!this->is_hoistable(expr.get()))
+        {
+            expr->accept(this);
+            return;
+        }
+
+        if (this->dry_run)
+        {
+            this->found.insert(expr.get());
+            return;
+        }
+
+        auto name = "licm$" + std::to_string((*this->temporaries)++);
+        Token identifier(Token::Type::IDENTIFIER, name, this->position.line_num, this->position.char_num);
+
+        this->hoisted.push_back(std::make_unique<DeclStmt>(identifier, std::nullopt, false, std::move(expr)));
+        expr = std::make_unique<Primary>(identifier);
+    }
+
+    // arguments are shared with the call, only their subexpressions can be moved
+    void hoist(std::shared_ptr<Expr> &expr)
+    {
+        expr->accept(this);
+    }
+
+    bool is_hoistable(Expr *expr)
+    {
+        if (dynamic_cast<Primary *>(expr) || !this->is_invariant(expr))
+        {
+            return false;
+        }
+
+        return this->allow_calls || this->purity_checker.is_pure(expr);
+    }
+
+    bool is_invariant(Expr *expr)
+    {
+        if (auto binary = dynamic_cast<Binary *>(expr))
+        {
+            return this->is_invariant(binary->left.get()) && this->is_invariant(binary->right.get());
+        }
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+        {
+            return this->is_invariant(unary->expr.get());
+        }
+
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+        {
+            return this->is_invariant(ternary->condition.get()) &&
+                   this->is_invariant(ternary->true_expr.get()) &&
+                   this->is_invariant(ternary->false_expr.get());
+        }
+
+        if (auto primary = dynamic_cast<Primary *>(expr))
+        {
+            return primary->value.token_type != Token::Type::IDENTIFIER || !this->mutated.count(primary->value.lexeme);
+        }
+
+        if (auto call = dynamic_cast<Call *>(expr))
+        {
+            if (!this->effects->is_pure(call->identifier.lexeme) || this->mutated.count(call->identifier.lexeme))
+            {
+                return false;
+            }
+
+            for (auto &arg : call->args)
+            {
+                if (!this->is_invariant(arg.get()))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    /*
+     * Whether evaluating an expression can fail outside of the expressions found in a dry run
+     */
+    bool can_fail(Expr *expr)
+    {
+        if (this->found.count(expr))
+        {
+            return false;
+        }
+
+        if (auto binary = dynamic_cast<Binary *>(expr))
+        {
+            if (binary->op.token_type == Token::Type::SLASH || binary->op.token_type == Token::Type::PERCENT)
+            {
+                return true;
+            }
+
+            return this->can_fail(binary->left.get()) || this->can_fail(binary->right.get());
+        }
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+        {
+            return this->can_fail(unary->expr.get());
+        }
+
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+        {
+            return this->can_fail(ternary->condition.get()) ||
+                   this->can_fail(ternary->true_expr.get()) ||
+                   this->can_fail(ternary->false_expr.get());
+        }
+
+        return dynamic_cast<Primary *>(expr) == nullptr;
+    }
+
+    void visit_block(Block *block)
+    {
+        for (auto &stmt : block->stmts)
+        {
+            stmt->accept(this);
+        }
+    }
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        this->hoist(decl_stmt->value);
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        this->hoist(assign_expr->value);
+    }
+
+    void visit_expr_stmt(ExprStmt *expr_stmt)
+    {
+        this->hoist(expr_stmt->expr);
+    }
+
+    void visit_print_stmt(PrintStmt *print_stmt)
+    {
+        for (auto &arg : print_stmt->args)
+        {
+            this->hoist(arg);
+        }
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        this->hoist(const_stmt->value);
+    }
+
+    void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        this->hoist(while_stmt->condition);
+        while_stmt->stmt->accept(this);
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        if (for_stmt->initializer.has_value())
+        {
+            for_stmt->initializer.value()->accept(this);
+        }
+
+        if (for_stmt->condition.has_value())
+        {
+            this->hoist(for_stmt->condition.value());
+        }
+
+        if (for_stmt->increment.has_value())
+        {
+            this->hoist(for_stmt->increment.value());
+        }
+
+        for_stmt->body->accept(this);
+    }
+
+    void visit_binary(Binary *binary)
+    {
+        this->hoist(binary->left);
+        this->hoist(binary->right);
+    }
+
+    void visit_unary(Unary *unary)
+    {
+        this->hoist(unary->expr);
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        // do nothing
+    }
+
+    void visit_ternary(Ternary *ternary)
+    {
+        this->hoist(ternary->condition);
+
+        // only one branch runs
+        auto allow_calls = this->allow_calls;
+        this->allow_calls = false;
+
+        this->hoist(ternary->true_expr);
+        this->hoist(ternary->false_expr);
+
+        this->allow_calls = allow_calls;
+    }
+
+    void visit_func(Func *func)
+    {
+        // the body only runs when it is called
+    }
+
+    void visit_if_stmt(IfStmt *if_stmt)
+    {
+        this->hoist(if_stmt->condition);
+        if_stmt->then_branch->accept(this);
+
+        if (if_stmt->else_branch.has_value())
+        {
+            if_stmt->else_branch.value()->accept(this);
+        }
+    }
+
+    void visit_call(Call *call)
+    {
+        for (auto &arg : call->args)
+        {
+            this->hoist(arg);
+        }
+    }
+
+    void visit_return_stmt(ReturnStmt *return_stmt)
+    {
+        if (return_stmt->expr.has_value())
+        {
+            this->hoist(return_stmt->expr.value());
+        }
+    }
+
+    void visit_break_stmt(BreakStmt *break_stmt)
+    {
+        // do nothing
+    }
+
+    void visit_continue_stmt(ContinueStmt *continue_stmt)
+    {
+        // do nothing
+    }
+
+    void visit_type_stmt(TypeStmt *type_stmt)
+    {
+        // do nothing
+    }
+};
+
+/*
+ * Visitor that moves expressions that do not change between iterations
+ * out of while and for loops, runs after type checking.
+ *
+ * An expression is loop invariant when it only reads variables the loop
+ * never assigns or declares and only calls pure functions. Invariant
+ * expressions that can not fail, and invariant calls in loop conditions,
+ * are evaluated once into a temporary declared before the loop. The loop and its temporaries are wrapped in a block,
+ * temporary names can not be written in Bird so they never clash.
+ * Inner loops are handled first so their invariants can move further out.
+ */
+class LoopInvariantCodeMotion : public AstWalker
+{
+public:
+    int hoisted_expressions = 0;
+    EffectAnalyzer effects;
+    PurityChecker purity_checker;
+
+    // temporaries for the loop just visited, to be declared before it
+    std::vector<std::unique_ptr<Stmt>> hoisted;
+
+    void move_loop_invariants(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        this->effects.analyze_effects(stmts);
+
+        for (auto &stmt : *stmts)
+        {
+            this->move_invariants(stmt);
+        }
+    }
+
+    void move_invariants(std::unique_ptr<Stmt> &stmt)
+    {
+        stmt->accept(this);
+
+        if (!this->hoisted.empty())
+        {
+            auto stmts = std::move(this->hoisted);
+            this->hoisted.clear();
+
+            stmts.push_back(std::move(stmt));
+            stmt = std::make_unique<Block>(std::move(stmts));
+        }
+    }
+
+    void visit_block(Block *block)
+    {
+        for (auto &stmt : block->stmts)
+        {
+            this->move_invariants(stmt);
+        }
+    }
+
+    void visit_func(Func *func)
+    {
+        for (auto &stmt : dynamic_cast<Block *>(func->block.get())->stmts)
+        {
+            this->move_invariants(stmt);
+        }
+    }
+
+    void visit_if_stmt(IfStmt *if_stmt)
+    {
+        this->move_invariants(if_stmt->then_branch);
+
+        if (if_stmt->else_branch.has_value())
+        {
+            this->move_invariants(if_stmt->else_branch.value());
+        }
+    }
+
+    void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        this->move_invariants(while_stmt->stmt);
+
+        LoopMutationCollector collector(&this->effects);
+        while_stmt->condition->accept(&collector);
+        while_stmt->stmt->accept(&collector);
+
+        InvariantHoister hoister(&this->effects, collector.mutated, while_stmt->while_token, &this->hoisted_expressions);
+        hoister.hoist_condition(while_stmt->condition, true);
+        while_stmt->stmt->accept(&hoister);
+
+        this->hoisted = std::move(hoister.hoisted);
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        this->move_invariants(for_stmt->body);
+
+        LoopMutationCollector collector(&this->effects);
+        for_stmt->body->accept(&collector);
+
+        if (for_stmt->initializer.has_value())
+        {
+            for_stmt->initializer.value()->accept(&collector);
+        }
+
+        if (for_stmt->condition.has_value())
+        {
+            for_stmt->condition.value()->accept(&collector);
+        }
+
+        if (for_stmt->increment.has_value())
+        {
+            for_stmt->increment.value()->accept(&collector);
+        }
+
+        InvariantHoister hoister(&this->effects, collector.mutated, for_stmt->for_token, &this->hoisted_expressions);
+
+        if (for_stmt->condition.has_value())
+        {
+            // the condition now runs before the initializer
+            hoister.hoist_condition(for_stmt->condition.value(), this->initializer_can_move(for_stmt));
+        }
+
+        if (for_stmt->increment.has_value())
+        {
+            hoister.hoist(for_stmt->increment.value());
+        }
+
+        for_stmt->body->accept(&hoister);
+
+        this->hoisted = std::move(hoister.hoisted);
+    }
+
+    bool initializer_can_move(ForStmt *for_stmt)
+    {
+        if (!for_stmt->initializer.has_value())
+        {
+            return true;
+        }
+
+        auto decl_stmt = dynamic_cast<DeclStmt *>(for_stmt->initializer.value().get());
+        return decl_stmt && this->purity_checker.is_pure(decl_stmt->value.get());
+    }
+};
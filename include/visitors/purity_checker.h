@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "ast_node/index.h"
+#include "visitors/ast_walker.h"
+
+/*
+ * Visitor that decides if an expression is pure, meaning evaluating it
+ * has no side effects and can not fail, so it can be removed, moved or
+ * duplicated without changing what the program does
+ */
+class PurityChecker : public AstWalker
+{
+public:
+    bool pure = true;
+
+    bool is_pure(Expr *expr)
+    {
+        this->pure = true;
+        expr->accept(this);
+
+        return this->pure;
+    }
+
+    void visit_binary(Binary *binary)
+    {
+        if (binary->op.token_type == Token::Type::SLASH || binary->op.token_type == Token::Type::PERCENT)
+        {
+            // only division by a nonzero literal can not fail
+            auto divisor = dynamic_cast<Primary *>(binary->right.get());
+            if (!divisor ||
+                (divisor->value.token_type != Token::Type::INT_LITERAL && divisor->value.token_type != Token::Type::FLOAT_LITERAL) ||
+                std::stod(divisor->value.lexeme) == 0)
+            {
+                this->pure = false;
+                return;
+            }
+        }
+
+        binary->left->accept(this);
+        binary->right->accept(this);
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        this->pure = false;
+    }
+
+    void visit_call(Call *call)
+    {
+        this->pure = false;
+    }
+};
@@ -0,0 +1,652 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <optional>
+#include <string>
+#include <set>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+
+#include "ast_node/index.h"
+#include "visitors/ast_walker.h"
+#include "visitors/effect_analyzer.h"
+
+#include "sym_table.h"
+#include "stack.h"
+
+/*
+ * The values an int can have at some point in the program
+ */
+struct Interval
+{
+    long long low;
+    long long high;
+
+    Interval(long long low, long long high) : low(low), high(high) {}
+
+    static Interval any()
+    {
+        return Interval(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    }
+
+    /*
+     * Ints wrap around, so a result that leaves the int range can be any int
+     */
+    static Interval checked(long long low, long long high)
+    {
+        if (low < std::numeric_limits<int>::min() || high > std::numeric_limits<int>::max())
+        {
+            return Interval::any();
+        }
+
+        return Interval(low, high);
+    }
+
+    bool contains(long long value)
+    {
+        return this->low <= value && value <= this->high;
+    }
+
+    Interval join(Interval other)
+    {
+        return Interval(std::min(this->low, other.low), std::max(this->high, other.high));
+    }
+};
+
+/*
+ * Visitor that collects the variables a statement can assign,
+ * including the ones assigned by the functions it calls
+ */
+class AssignmentCollector : public AstWalker
+{
+public:
+    EffectAnalyzer *effects;
+    std::set<std::string> assigned;
+
+    AssignmentCollector(EffectAnalyzer *effects) : effects(effects) {}
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        this->assigned.insert(assign_expr->identifier.lexeme);
+        assign_expr->value->accept(this);
+    }
+
+    void visit_call(Call *call)
+    {
+        for (auto &name : this->effects->assigned_by(call->identifier.lexeme))
+        {
+            this->assigned.insert(name);
+        }
+
+        for (auto &arg : call->args)
+        {
+            arg->accept(this);
+        }
+    }
+};
+
+/*
+ * Visitor that finds the range of every int variable and expression
+ * and marks the binary expressions whose checks can be skipped,
+ * runs last in the optimizer.
+ *
+ * A known range also means the value is an int, nullopt is used for values
+ * that can have another type. Variables assigned in a loop are widened to
+ * any int before the loop, except for the induction variable of a for loop
+ * of the form `for var i = a; i < b; i += c`, which stays between the lowest
+ * value of `a` and the highest value of `b`.
+ *
+ * Like the interpreter, variables are tracked by name: a call forgets the
+ * variables the called function can assign, and a function body only
+ * knows its own parameters and variables.
+ */
+class RangeAnalyzer : public Visitor
+{
+public:
+    Environment<std::optional<Interval>> env;
+    Stack<std::optional<Interval>> stack;
+    EffectAnalyzer effects;
+
+    // only the final pass over a loop marks expressions
+    bool annotate = true;
+
+    // variables that may not be ints at a break or continue
+    std::set<std::string> untyped_at_jumps;
+
+    int int_operations = 0;
+    int nonzero_divisors = 0;
+
+    RangeAnalyzer()
+    {
+        this->env.push_env();
+    }
+
+    void analyze_ranges(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        this->effects.analyze_effects(stmts);
+
+        for (auto &stmt : *stmts)
+        {
+            stmt->accept(this);
+        }
+    }
+
+    std::optional<Interval> range(Expr *expr)
+    {
+        expr->accept(this);
+        return this->stack.pop();
+    }
+
+    void visit_block(Block *block)
+    {
+        this->env.push_env();
+
+        for (auto &stmt : block->stmts)
+        {
+            stmt->accept(this);
+        }
+
+        this->env.pop_env();
+    }
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        auto value = this->range(decl_stmt->value.get());
+
+        // declarations convert their value to the declared type
+        if (decl_stmt->type_token.has_value() && decl_stmt->type_token.value().lexeme != "int")
+        {
+            value = std::nullopt;
+        }
+
+        this->bind(decl_stmt->identifier.lexeme, value);
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        auto value = this->range(const_stmt->value.get());
+
+        if (const_stmt->type_token.has_value() && const_stmt->type_token.value().lexeme != "int")
+        {
+            value = std::nullopt;
+        }
+
+        this->bind(const_stmt->identifier.lexeme, value);
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        auto name = assign_expr->identifier.lexeme;
+        auto value = this->range(assign_expr->value.get());
+        auto previous = this->env.contains(name) ? this->env.get(name) : std::nullopt;
+
+        switch (assign_expr->assign_operator.token_type)
+        {
+        case Token::Type::EQUAL:
+            break;
+        case Token::Type::PLUS_EQUAL:
+            value = this->arithmetic(Token::Type::PLUS, previous, value);
+            break;
+        case Token::Type::MINUS_EQUAL:
+            value = this->arithmetic(Token::Type::MINUS, previous, value);
+            break;
+        case Token::Type::STAR_EQUAL:
+            value = this->arithmetic(Token::Type::STAR, previous, value);
+            break;
+        case Token::Type::SLASH_EQUAL:
+            value = this->arithmetic(Token::Type::SLASH, previous, value);
+            break;
+        case Token::Type::PERCENT_EQUAL:
+            value = this->arithmetic(Token::Type::PERCENT, previous, value);
+            break;
+        default:
+            value = std::nullopt;
+        }
+
+        if (this->env.contains(name))
+        {
+            this->env.set(name, value);
+        }
+
+        this->stack.push(value);
+    }
+
+    void visit_expr_stmt(ExprStmt *expr_stmt)
+    {
+        this->range(expr_stmt->expr.get());
+    }
+
+    void visit_print_stmt(PrintStmt *print_stmt)
+    {
+        for (auto &arg : print_stmt->args)
+        {
+            this->range(arg.get());
+        }
+    }
+
+    void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        this->analyze_loop(while_stmt, std::nullopt, [&]()
+                           {
+                               this->range(while_stmt->condition.get());
+                               while_stmt->stmt->accept(this); });
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        this->env.push_env();
+
+        if (for_stmt->initializer.has_value())
+        {
+            for_stmt->initializer.value()->accept(this);
+        }
+
+        auto induction = this->induction_variable(for_stmt);
+
+        this->analyze_loop(for_stmt, induction, [&]()
+                           {
+                               if (for_stmt->condition.has_value())
+                               {
+                                   this->range(for_stmt->condition.value().get());
+                               }
+
+                               for_stmt->body->accept(this);
+
+                               if (for_stmt->increment.has_value())
+                               {
+                                   this->range(for_stmt->increment.value().get());
+                               } });
+
+        this->env.pop_env();
+    }
+
+    /*
+     * Widens the variables a loop assigns until one more pass over the loop
+     * changes nothing, then makes the final pass that marks expressions
+     */
+    template <typename Pass>
+    void analyze_loop(Stmt *loop, std::optional<std::pair<std::string, Interval>> induction, Pass pass)
+    {
+        AssignmentCollector collector(&this->effects);
+        loop->accept(&collector);
+
+        std::vector<std::string> widened;
+        for (auto &name : collector.assigned)
+        {
+            if (this->env.contains(name))
+            {
+                widened.push_back(name);
+            }
+        }
+
+        auto head = [&](std::string name) -> std::optional<Interval>
+        {
+            if (induction.has_value() && induction.value().first == name)
+            {
+                return induction.value().second;
+            }
+
+            return this->env.get(name).has_value() ? std::optional<Interval>(Interval::any()) : std::nullopt;
+        };
+
+        for (auto &name : widened)
+        {
+            this->env.set(name, head(name));
+        }
+
+        auto annotate = this->annotate;
+        this->annotate = false;
+
+        auto outer_jumps = std::move(this->untyped_at_jumps);
+
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+
+            this->untyped_at_jumps.clear();
+            auto before = this->env;
+            pass();
+            auto after = this->env;
+            this->env = before;
+
+            for (auto &name : widened)
+            {
+                if (this->env.get(name).has_value() && (!after.get(name).has_value() || this->untyped_at_jumps.count(name)))
+                {
+                    this->env.set(name, std::nullopt);
+                    changed = true;
+                }
+            }
+        }
+
+        this->annotate = annotate;
+
+        auto before = this->env;
+        pass();
+        this->env = before;
+
+        this->untyped_at_jumps.insert(outer_jumps.begin(), outer_jumps.end());
+
+        // the loop can run any number of times
+        if (induction.has_value())
+        {
+            auto name = induction.value().first;
+            this->env.set(name, this->env.get(name).has_value() ? std::optional<Interval>(Interval::any()) : std::nullopt);
+        }
+    }
+
+    /*
+     * The range of `i` inside `for var i = a; i < b; i += c`, when `i` is
+     * only changed by the increment and the increment can not overflow
+     */
+    std::optional<std::pair<std::string, Interval>> induction_variable(ForStmt *for_stmt)
+    {
+        if (!for_stmt->initializer.has_value() || !for_stmt->condition.has_value() || !for_stmt->increment.has_value())
+        {
+            return std::nullopt;
+        }
+
+        auto decl_stmt = dynamic_cast<DeclStmt *>(for_stmt->initializer.value().get());
+        auto condition = dynamic_cast<Binary *>(for_stmt->condition.value().get());
+        auto increment = dynamic_cast<AssignExpr *>(for_stmt->increment.value().get());
+        if (!decl_stmt || !condition || !increment)
+        {
+            return std::nullopt;
+        }
+
+        auto name = decl_stmt->identifier.lexeme;
+        auto start = this->env.get(name);
+        auto variable = dynamic_cast<Primary *>(condition->left.get());
+        auto step = dynamic_cast<Primary *>(increment->value.get());
+
+        if (!start.has_value() ||
+            !variable || variable->value.token_type != Token::Type::IDENTIFIER || variable->value.lexeme != name ||
+            (condition->op.token_type != Token::Type::LESS && condition->op.token_type != Token::Type::LESS_EQUAL) ||
+            increment->identifier.lexeme != name ||
+            increment->assign_operator.token_type != Token::Type::PLUS_EQUAL ||
+            !step || step->value.token_type != Token::Type::INT_LITERAL || std::stoll(step->value.lexeme) <= 0)
+        {
+            return std::nullopt;
+        }
+
+        // the variable is only changed by the increment
+        AssignmentCollector collector(&this->effects);
+        for_stmt->body->accept(&collector);
+        condition->accept(&collector);
+        if (collector.assigned.count(name))
+        {
+            return std::nullopt;
+        }
+
+        // the bound is read before the loop, so variables the loop assigns can be any int
+        AssignmentCollector loop_collector(&this->effects);
+        for_stmt->accept(&loop_collector);
+
+        auto saved = this->env;
+        for (auto &assigned : loop_collector.assigned)
+        {
+            if (assigned != name && this->env.contains(assigned) && this->env.get(assigned).has_value())
+            {
+                this->env.set(assigned, Interval::any());
+            }
+        }
+
+        auto annotate = this->annotate;
+        this->annotate = false;
+        auto bound = this->range(condition->right.get());
+        this->annotate = annotate;
+        this->env = saved;
+
+        if (!bound.has_value())
+        {
+            return std::nullopt;
+        }
+
+        long long high = condition->op.token_type == Token::Type::LESS ? bound.value().high - 1 : bound.value().high;
+        if (high + std::stoll(step->value.lexeme) > std::numeric_limits<int>::max())
+        {
+            return std::nullopt;
+        }
+
+        return std::make_pair(name, Interval(start.value().low, std::max(high, start.value().low)));
+    }
+
+    void visit_binary(Binary *binary)
+    {
+        auto left = this->range(binary->left.get());
+        auto right = this->range(binary->right.get());
+
+        if (this->annotate)
+        {
+            binary->int_operands = left.has_value() && right.has_value();
+            binary->nonzero_divisor = binary->int_operands && !right.value().contains(0);
+            binary->non_negative_operands = binary->int_operands && left.value().low >= 0 && right.value().low >= 0;
+
+            this->int_operations += binary->int_operands ? 1 : 0;
+            this->nonzero_divisors += binary->nonzero_divisor &&
+                                              (binary->op.token_type == Token::Type::SLASH || binary->op.token_type == Token::Type::PERCENT)
+                                          ? 1
+                                          : 0;
+        }
+
+        this->stack.push(this->arithmetic(binary->op.token_type, left, right));
+    }
+
+    void visit_unary(Unary *unary)
+    {
+        auto value = this->range(unary->expr.get());
+        this->stack.push(value.has_value()
+                             ? std::optional<Interval>(Interval::checked(-value.value().high, -value.value().low))
+                             : std::nullopt);
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        switch (primary->value.token_type)
+        {
+        case Token::Type::INT_LITERAL:
+        {
+            auto value = std::stoll(primary->value.lexeme);
+            this->stack.push(Interval(value, value));
+            break;
+        }
+        case Token::Type::IDENTIFIER:
+            this->stack.push(this->env.contains(primary->value.lexeme) ? this->env.get(primary->value.lexeme) : std::nullopt);
+            break;
+        default:
+            this->stack.push(std::nullopt);
+        }
+    }
+
+    void visit_ternary(Ternary *ternary)
+    {
+        this->range(ternary->condition.get());
+        auto true_value = this->range(ternary->true_expr.get());
+        auto false_value = this->range(ternary->false_expr.get());
+
+        this->stack.push(true_value.has_value() && false_value.has_value()
+                             ? std::optional<Interval>(true_value.value().join(false_value.value()))
+                             : std::nullopt);
+    }
+
+    void visit_func(Func *func)
+    {
+        auto previous_env = std::move(this->env);
+        this->env = Environment<std::optional<Interval>>();
+        this->env.push_env();
+
+        // the interpreter checks that int arguments are ints
+        for (auto &param : func->param_list)
+        {
+            this->bind(param.first.lexeme, param.second.lexeme == "int" ? std::optional<Interval>(Interval::any()) : std::nullopt);
+        }
+
+        for (auto &stmt : dynamic_cast<Block *>(func->block.get())->stmts)
+        {
+            stmt->accept(this);
+        }
+
+        this->env = std::move(previous_env);
+    }
+
+    void visit_if_stmt(IfStmt *if_stmt)
+    {
+        this->range(if_stmt->condition.get());
+
+        auto before = this->env;
+        if_stmt->then_branch->accept(this);
+        auto then_env = this->env;
+
+        this->env = before;
+        if (if_stmt->else_branch.has_value())
+        {
+            if_stmt->else_branch.value()->accept(this);
+        }
+
+        this->join(then_env);
+    }
+
+    void visit_call(Call *call)
+    {
+        for (auto &arg : call->args)
+        {
+            this->range(arg.get());
+        }
+
+        for (auto &name : this->effects.assigned_by(call->identifier.lexeme))
+        {
+            if (this->env.contains(name))
+            {
+                this->env.set(name, std::nullopt);
+            }
+        }
+
+        // calls are not converted to their return type by the interpreter
+        this->stack.push(std::nullopt);
+    }
+
+    void visit_return_stmt(ReturnStmt *return_stmt)
+    {
+        if (return_stmt->expr.has_value())
+        {
+            this->range(return_stmt->expr.value().get());
+        }
+    }
+
+    void visit_break_stmt(BreakStmt *break_stmt)
+    {
+        this->note_jump();
+    }
+
+    void visit_continue_stmt(ContinueStmt *continue_stmt)
+    {
+        this->note_jump();
+    }
+
+    void visit_type_stmt(TypeStmt *type_stmt)
+    {
+        // do nothing
+    }
+
+    std::optional<Interval> arithmetic(Token::Type op, std::optional<Interval> left, std::optional<Interval> right)
+    {
+        if (!left.has_value() || !right.has_value())
+        {
+            return std::nullopt;
+        }
+
+        auto l = left.value();
+        auto r = right.value();
+
+        switch (op)
+        {
+        case Token::Type::PLUS:
+            return Interval::checked(l.low + r.low, l.high + r.high);
+        case Token::Type::MINUS:
+            return Interval::checked(l.low - r.high, l.high - r.low);
+        case Token::Type::STAR:
+        {
+            std::vector<long long> corners = {l.low * r.low, l.low * r.high, l.high * r.low, l.high * r.high};
+            return Interval::checked(*std::min_element(corners.begin(), corners.end()),
+                                     *std::max_element(corners.begin(), corners.end()));
+        }
+        case Token::Type::SLASH:
+        {
+            if (r.contains(0))
+            {
+                return Interval::any();
+            }
+
+            std::vector<long long> corners = {l.low / r.low, l.low / r.high, l.high / r.low, l.high / r.high};
+            return Interval::checked(*std::min_element(corners.begin(), corners.end()),
+                                     *std::max_element(corners.begin(), corners.end()));
+        }
+        case Token::Type::PERCENT:
+        {
+            if (r.contains(0))
+            {
+                return Interval::any();
+            }
+
+            // the result is smaller than the divisor and has the sign of the dividend
+            long long limit = std::max(std::abs(r.low), std::abs(r.high)) - 1;
+            long long low = l.low >= 0 ? 0 : std::max(l.low, -limit);
+            long long high = l.high <= 0 ? 0 : std::min(l.high, limit);
+            return Interval(low, high);
+        }
+        default:
+            return std::nullopt;
+        }
+    }
+
+    /*
+     * Joins the variables of the environment with the ones of another path
+     */
+    void join(Environment<std::optional<Interval>> &other)
+    {
+        for (int i = 0; i < this->env.envs.size() && i < other.envs.size(); i++)
+        {
+            for (auto &variable : this->env.envs[i])
+            {
+                auto found = other.envs[i].find(variable.first);
+                if (found == other.envs[i].end() || !variable.second.has_value() || !found->second.has_value())
+                {
+                    variable.second = std::nullopt;
+                }
+                else
+                {
+                    variable.second = variable.second.value().join(found->second.value());
+                }
+            }
+        }
+    }
+
+    void note_jump()
+    {
+        for (auto &scope : this->env.envs)
+        {
+            for (auto &variable : scope)
+            {
+                if (!variable.second.has_value())
+                {
+                    this->untyped_at_jumps.insert(variable.first);
+                }
+            }
+        }
+    }
+
+    void bind(std::string identifier, std::optional<Interval> value)
+    {
+        if (this->env.current_contains(identifier))
+        {
+            this->env.envs.back()[identifier] = value;
+        }
+        else
+        {
+            this->env.declare(identifier, value);
+        }
+    }
+};
@@ -9,9 +9,6 @@
 
 #include "sym_table.h"
 #include "exceptions/bird_exception.h"
-#include "exceptions/return_exception.h"
-#include "exceptions/break_exception.h"
-#include "exceptions/continue_exception.h"
 #include "exceptions/user_error_tracker.h"
 #include "value.h"
 #include "callable.h"
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "ast_node/index.h"
+#include "sym_table.h"
+#include "visitors/ast_walker.h"
+
+/*
+ * Finds the function definitions nested in a function body
+ */
+class NestedFuncFinder : public AstWalker
+{
+public:
+    bool found = false;
+
+    void visit_func(Func *func)
+    {
+        this->found = true;
+    }
+};
+
+/*
+ * Visitor that gives the parameters and locals of every function a slot in its
+ * call frame, runs on the final AST right before it is interpreted.
+ *
+ * Parameters take the first slots in order, locals take the next free slot when
+ * they are declared and give it back at the end of their block. Identifiers that
+ * are not a parameter or local of the function they are used in keep slot -1 and
+ * are looked up by name, and so does every variable of a function that defines
+ * other functions, because those can read its variables by name.
+ */
+class SlotResolver : public AstWalker
+{
+public:
+    int resolved_functions = 0;
+
+    Environment<int> slots; // name -> slot in the function being resolved
+    int next_slot = 0;
+    Func *function = nullptr;
+
+    void resolve(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        this->walk(stmts);
+    }
+
+    void visit_func(Func *func)
+    {
+        auto enclosing_slots = this->slots;
+        auto enclosing_next_slot = this->next_slot;
+        auto enclosing_function = this->function;
+
+        NestedFuncFinder finder;
+        func->block->accept(&finder);
+
+        this->slots = Environment<int>();
+        this->next_slot = 0;
+        this->function = finder.found ? nullptr : func;
+        func->frame_size = -1;
+
+        if (this->function)
+        {
+            this->slots.push_env();
+            for (auto &param : func->param_list)
+            {
+                this->slots.declare(param.first.lexeme, this->next_slot++);
+            }
+
+            func->frame_size = this->next_slot;
+            this->resolved_functions++;
+        }
+
+        func->block->accept(this);
+
+        this->slots = enclosing_slots;
+        this->next_slot = enclosing_next_slot;
+        this->function = enclosing_function;
+    }
+
+    void visit_block(Block *block)
+    {
+        auto next_slot = this->next_slot;
+        this->slots.push_env();
+
+        AstWalker::visit_block(block);
+
+        this->slots.pop_env();
+        this->next_slot = next_slot;
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        auto next_slot = this->next_slot;
+        this->slots.push_env();
+
+        AstWalker::visit_for_stmt(for_stmt);
+
+        this->slots.pop_env();
+        this->next_slot = next_slot;
+    }
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        decl_stmt->value->accept(this);
+        decl_stmt->slot = this->declare(decl_stmt->identifier.lexeme);
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        const_stmt->value->accept(this);
+        const_stmt->slot = this->declare(const_stmt->identifier.lexeme);
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        assign_expr->value->accept(this);
+        assign_expr->slot = this->lookup(assign_expr->identifier.lexeme);
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        if (primary->value.token_type == Token::Type::IDENTIFIER)
+        {
+            primary->slot = this->lookup(primary->value.lexeme);
+        }
+    }
+
+    int declare(std::string identifier)
+    {
+        if (!this->function || this->slots.envs.empty())
+        {
+            return -1;
+        }
+
+        auto slot = this->next_slot++;
+        this->slots.envs.back()[identifier] = slot;
+        this->function->frame_size = std::max(this->function->frame_size, this->next_slot);
+
+        return slot;
+    }
+
+    int lookup(std::string identifier)
+    {
+        if (!this->function || !this->slots.contains(identifier))
+        {
+            return -1;
+        }
+
+        return this->slots.get(identifier);
+    }
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <map>
+
+#include "ast_node/index.h"
+#include "visitors/ast_walker.h"
+#include "visitors/ast_cloner.h"
+#include "visitors/inliner.h"
+
+/*
+ * Visitor that turns functions calling themselves in tail position into loops,
+ * runs after type checking.
+ *
+ * The body of such a function is wrapped in `while true { ... break; }` and
+ * every `return f(args);` becomes a block that stores the arguments in
+ * temporaries declared with the parameter types, assigns them to the
+ * parameters and continues the loop. A call statement that ends a function
+ * without a return type is a tail call as well.
+ *
+ * Calls inside loops are left alone, since the continue would belong to the
+ * inner loop, and so are functions that are declared more than once.
+ */
+class TailCallEliminator : public AstWalker
+{
+public:
+    int eliminated_calls = 0;
+    int transformed_functions = 0;
+    int temporaries = 0;
+
+    AstCloner cloner;
+
+    // functions declared more than once could be shadowed at a call site
+    std::map<std::string, int> function_declarations;
+
+    void eliminate_tail_calls(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        InlineInfoCollector collector;
+        collector.walk(stmts);
+        this->function_declarations = collector.function_declarations;
+
+        this->walk(stmts);
+    }
+
+    void visit_func(Func *func)
+    {
+        func->block->accept(this);
+
+        if (this->function_declarations[func->identifier.lexeme] != 1)
+        {
+            return;
+        }
+
+        auto block = dynamic_cast<Block *>(func->block.get());
+        auto calls = this->eliminated_calls;
+        this->rewrite_block(block->stmts, func, true);
+
+        if (this->eliminated_calls == calls)
+        {
+            return;
+        }
+
+        auto position = func->identifier;
+        block->stmts.push_back(std::make_unique<BreakStmt>(Token(Token::Type::BREAK, "break", position.line_num, position.char_num)));
+
+        auto loop = std::make_unique<WhileStmt>(
+            Token(Token::Type::WHILE, "while", position.line_num, position.char_num),
+            std::make_unique<Primary>(Token(Token::Type::BOOL_LITERAL, "true", position.line_num, position.char_num)),
+            std::make_unique<Block>(std::move(block->stmts)));
+
+        block->stmts.clear();
+        block->stmts.push_back(std::move(loop));
+
+        this->transformed_functions += 1;
+    }
+
+    /*
+     * Rewrites the tail calls of a list of statements, `last` is set when
+     * the function ends after the last statement
+     */
+    void rewrite_block(std::vector<std::unique_ptr<Stmt>> &stmts, Func *func, bool last)
+    {
+        for (int i = 0; i < stmts.size(); i++)
+        {
+            this->rewrite(stmts[i], func, last && i == stmts.size() - 1);
+        }
+    }
+
+    void rewrite(std::unique_ptr<Stmt> &stmt, Func *func, bool last)
+    {
+        if (auto block = dynamic_cast<Block *>(stmt.get()))
+        {
+            this->rewrite_block(block->stmts, func, last);
+            return;
+        }
+
+        if (auto if_stmt = dynamic_cast<IfStmt *>(stmt.get()))
+        {
+            this->rewrite(if_stmt->then_branch, func, last);
+            if (if_stmt->else_branch.has_value())
+            {
+                this->rewrite(if_stmt->else_branch.value(), func, last);
+            }
+            return;
+        }
+
+        if (auto return_stmt = dynamic_cast<ReturnStmt *>(stmt.get()))
+        {
+            if (return_stmt->expr.has_value())
+            {
+                auto call = this->self_call(return_stmt->expr.value().get(), func);
+                if (call)
+                {
+                    stmt = this->jump(call, func);
+                }
+            }
+            return;
+        }
+
+        if (auto expr_stmt = dynamic_cast<ExprStmt *>(stmt.get()))
+        {
+            auto call = this->self_call(expr_stmt->expr.get(), func);
+            if (call && last && !func->return_type.has_value())
+            {
+                stmt = this->jump(call, func);
+            }
+        }
+    }
+
+    Call *self_call(Expr *expr, Func *func)
+    {
+        auto call = dynamic_cast<Call *>(expr);
+        if (!call ||
+            call->identifier.lexeme != func->identifier.lexeme ||
+            call->args.size() != func->param_list.size())
+        {
+            return nullptr;
+        }
+
+        return call;
+    }
+
+    /*
+     * The statements that replace a tail call, arguments are evaluated
+     * before any parameter is assigned since they can read the parameters
+     */
+    std::unique_ptr<Stmt> jump(Call *call, Func *func)
+    {
+        auto position = call->identifier;
+        std::vector<std::unique_ptr<Stmt>> stmts;
+        std::vector<std::pair<Token, Token>> assignments; // parameter, temporary
+
+        for (int i = 0; i < call->args.size(); i++)
+        {
+            auto &param = func->param_list[i];
+
+            // passing a parameter to itself changes nothing
+            auto primary = dynamic_cast<Primary *>(call->args[i].get());
+            if (primary && primary->value.token_type == Token::Type::IDENTIFIER && primary->value.lexeme == param.first.lexeme)
+            {
+                continue;
+            }
+
+            Token temporary(Token::Type::IDENTIFIER, "tail$" + std::to_string(this->temporaries++), position.line_num, position.char_num);
+            stmts.push_back(std::make_unique<DeclStmt>(
+                temporary,
+                param.second,
+                this->is_type_literal(param.second.lexeme),
+                this->cloner.clone(call->args[i].get())));
+
+            assignments.push_back({param.first, temporary});
+        }
+
+        for (auto &assignment : assignments)
+        {
+            stmts.push_back(std::make_unique<ExprStmt>(std::make_unique<AssignExpr>(
+                assignment.first,
+                Token(Token::Type::EQUAL, "=", position.line_num, position.char_num),
+                std::make_unique<Primary>(assignment.second))));
+        }
+
+        stmts.push_back(std::make_unique<ContinueStmt>(Token(Token::Type::CONTINUE, "continue", position.line_num, position.char_num)));
+
+        this->eliminated_calls += 1;
+        return std::make_unique<Block>(std::move(stmts));
+    }
+
+    bool is_type_literal(std::string lexeme)
+    {
+        return lexeme == "int" || lexeme == "float" || lexeme == "str" || lexeme == "bool";
+    }
+};
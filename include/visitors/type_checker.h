@@ -5,16 +5,17 @@
 #include <map>
 #include <functional>
 #include <algorithm>
+#include <exception>
 
 #include "ast_node/index.h"
 
 #include "sym_table.h"
 #include "exceptions/bird_exception.h"
-#include "exceptions/return_exception.h"
 #include "exceptions/user_error_tracker.h"
 #include "bird_type.h"
 #include "stack.h"
 #include "type.h"
+#include "thread_pool.h"
 
 /*
  * Visitor that checks types of the AST
@@ -29,6 +30,36 @@ public:
     std::optional<BirdType> return_type;
     UserErrorTracker *user_error_tracker;
 
+    /*
+     * A function body set aside by `check_types_parallel`,
+     * along with the tables it would have been checked against
+     */
+    struct DeferredFunction
+    {
+        Func *func;
+        BirdType ret;
+        Environment<BirdType> env;
+        Environment<BirdFunction> call_table;
+        Environment<Type> type_table;
+        size_t error_position; // where the serial checker would have reported its errors
+
+        DeferredFunction(Func *func,
+                         BirdType ret,
+                         Environment<BirdType> env,
+                         Environment<BirdFunction> call_table,
+                         Environment<Type> type_table,
+                         size_t error_position)
+            : func(func),
+              ret(ret),
+              env(std::move(env)),
+              call_table(std::move(call_table)),
+              type_table(std::move(type_table)),
+              error_position(error_position) {}
+    };
+
+    // when set, top level function bodies are collected here instead of being checked
+    std::optional<std::vector<DeferredFunction>> deferred_functions;
+
     TypeChecker(UserErrorTracker *user_error_tracker) : user_error_tracker(user_error_tracker)
     {
         this->env.push_env();
@@ -213,6 +244,63 @@ public:
         }
     }
 
+    /*
+     * Checks the types of the AST, but first collects every top level
+     * function signature and then checks each function body as an
+     * independent task on a work stealing pool. Every task gets its own
+     * checker and error tracker, the errors are merged back in the same
+     * order the serial checker would have reported them
+     */
+    void check_types_parallel(std::vector<std::unique_ptr<Stmt>> *stmts, unsigned int thread_count)
+    {
+        this->deferred_functions = std::vector<DeferredFunction>();
+        this->check_types(stmts);
+
+        auto deferred = std::move(this->deferred_functions.value());
+        this->deferred_functions = std::nullopt;
+
+        std::vector<std::unique_ptr<UserErrorTracker>> trackers;
+        std::vector<std::exception_ptr> exceptions(deferred.size());
+        std::vector<std::function<void()>> tasks;
+
+        for (size_t i = 0; i < deferred.size(); i++)
+        {
+            trackers.push_back(std::make_unique<UserErrorTracker>(""));
+            tasks.push_back([&deferred, &trackers, &exceptions, i]()
+                            {
+                try
+                {
+                    TypeChecker checker(trackers[i].get());
+                    checker.env = std::move(deferred[i].env);
+                    checker.call_table = std::move(deferred[i].call_table);
+                    checker.type_table = std::move(deferred[i].type_table);
+
+                    checker.check_function_body(deferred[i].func, deferred[i].ret);
+                }
+                catch (...)
+                {
+                    exceptions[i] = std::current_exception();
+                } });
+        }
+
+        WorkStealingPool pool(thread_count);
+        pool.run(std::move(tasks));
+
+        for (auto &exception : exceptions)
+        {
+            if (exception)
+            {
+                std::rethrow_exception(exception);
+            }
+        }
+
+        // merge back to front so the earlier positions stay valid
+        for (size_t i = deferred.size(); i-- > 0;)
+        {
+            this->user_error_tracker->merge(*trackers[i], deferred[i].error_position);
+        }
+    }
+
     void visit_block(Block *block)
     {
         this->env.push_env();
@@ -566,10 +654,30 @@ public:
                        { return this->get_type_from_token(param.second); });
 
         BirdType ret = func->return_type.has_value() ? this->get_type_from_token(func->return_type.value()) : BirdType::VOID;
+
+        this->call_table.declare(func->identifier.lexeme, BirdFunction(params, ret));
+
+        // only top level functions are deferred, nested functions are checked with their parent
+        if (this->deferred_functions.has_value() && !this->return_type.has_value())
+        {
+            this->deferred_functions.value().push_back(
+                DeferredFunction(func,
+                                 ret,
+                                 this->env,
+                                 this->call_table,
+                                 this->type_table,
+                                 this->user_error_tracker->get_errors().size()));
+            return;
+        }
+
+        this->check_function_body(func, ret);
+    }
+
+    void check_function_body(Func *func, BirdType ret)
+    {
         auto previous_return_type = this->return_type;
         this->return_type = ret;
 
-        this->call_table.declare(func->identifier.lexeme, BirdFunction(params, ret));
         this->env.push_env();
 
         for (auto &param : func->param_list)
@@ -613,11 +721,13 @@ public:
     void visit_call(Call *call)
     {
         auto function = this->call_table.get(call->identifier.lexeme);
+        auto exact = call->args.size() == function.params.size();
 
         for (int i = 0; i < function.params.size(); i++)
         {
             call->args[i]->accept(this);
             auto arg = std::move(this->stack.pop());
+            exact = exact && arg == function.params[i];
 
             if (arg == BirdType::INT && function.params[i] == BirdType::FLOAT)
             {
@@ -635,6 +745,8 @@ public:
             }
         }
 
+        call->arguments_checked = exact;
+
         this->stack.push(function.ret);
     }
 
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "value.h"
+
+/*
+ * The instructions of the Bird VM.
+ *
+ * Operands are register numbers relative to the frame of the running function,
+ * except for the constant of LOAD_CONST, the global of GET_GLOBAL and SET_GLOBAL,
+ * the function of CALL and the jump targets, which are indexes
+ */
+enum class OpCode
+{
+    LOAD_CONST,    // a = constants[b]
+    MOVE,          // a = b
+    GET_GLOBAL,    // a = globals[b]
+    SET_GLOBAL,    // globals[a] = b
+    TO_INT,        // a = int(a) when a is a float
+    TO_FLOAT,      // a = float(a) when a is an int
+    ADD,           // a = b + c
+    SUB,           // a = b - c
+    MUL,           // a = b * c
+    DIV,           // a = b / c
+    MOD,           // a = b % c
+    NEG,           // a = -b
+    EQ,            // a = b == c
+    NE,            // a = b != c
+    LT,            // a = b < c
+    LE,            // a = b <= c
+    GT,            // a = b > c
+    GE,            // a = b >= c
+    JUMP,          // jump to a
+    JUMP_IF_FALSE, // jump to b when a is false
+    CALL,          // a = functions[b](c, c + 1, ...)
+    RETURN,        // return a
+    RETURN_VOID,   // return without a value
+    PRINT,         // print a
+    PRINT_LINE,    // end the printed line
+};
+
+static std::string op_code_to_string(OpCode op)
+{
+    switch (op)
+    {
+    case OpCode::LOAD_CONST:
+        return "load_const";
+    case OpCode::MOVE:
+        return "move";
+    case OpCode::GET_GLOBAL:
+        return "get_global";
+    case OpCode::SET_GLOBAL:
+        return "set_global";
+    case OpCode::TO_INT:
+        return "to_int";
+    case OpCode::TO_FLOAT:
+        return "to_float";
+    case OpCode::ADD:
+        return "add";
+    case OpCode::SUB:
+        return "sub";
+    case OpCode::MUL:
+        return "mul";
+    case OpCode::DIV:
+        return "div";
+    case OpCode::MOD:
+        return "mod";
+    case OpCode::NEG:
+        return "neg";
+    case OpCode::EQ:
+        return "eq";
+    case OpCode::NE:
+        return "ne";
+    case OpCode::LT:
+        return "lt";
+    case OpCode::LE:
+        return "le";
+    case OpCode::GT:
+        return "gt";
+    case OpCode::GE:
+        return "ge";
+    case OpCode::JUMP:
+        return "jump";
+    case OpCode::JUMP_IF_FALSE:
+        return "jump_if_false";
+    case OpCode::CALL:
+        return "call";
+    case OpCode::RETURN:
+        return "return";
+    case OpCode::RETURN_VOID:
+        return "return_void";
+    case OpCode::PRINT:
+        return "print";
+    case OpCode::PRINT_LINE:
+        return "print_line";
+    default:
+        return "unknown";
+    }
+}
+
+struct Instruction
+{
+    OpCode op;
+    int a;
+    int b;
+    int c;
+
+    Instruction(OpCode op, int a = 0, int b = 0, int c = 0) : op(op), a(a), b(b), c(c) {}
+};
+
+/*
+ * A compiled function, its parameters are the first registers of its frame.
+ * Top level statements are compiled into a function named main
+ */
+struct BytecodeFunction
+{
+    std::string name;
+    std::vector<int> param_tags; // the Value alternative each parameter must hold, -1 when unchecked
+    int registers = 0;
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+
+    BytecodeFunction(std::string name) : name(name) {}
+};
+
+/*
+ * The registers of main are the globals, they stay at the bottom of the register file
+ */
+struct BytecodeProgram
+{
+    std::vector<BytecodeFunction> functions;
+    int main = 0;
+
+    BytecodeFunction *get(std::string name)
+    {
+        for (auto &function : this->functions)
+        {
+            if (function.name == name)
+            {
+                return &function;
+            }
+        }
+
+        return nullptr;
+    }
+};
@@ -0,0 +1,769 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <optional>
+#include <string>
+#include <map>
+#include <algorithm>
+
+#include "ast_node/index.h"
+#include "sym_table.h"
+#include "vm/bytecode.h"
+
+/*
+ * Thrown while compiling a construct the VM does not support
+ */
+struct VmUnsupported
+{
+    std::string reason;
+
+    VmUnsupported(std::string reason) : reason(reason) {}
+};
+
+/*
+ * Visitor that compiles a type checked AST into bytecode for the VM, runs last.
+ *
+ * Registers are allocated like a stack: every variable gets the next free register
+ * of its function when it is declared and gives it back at the end of its block,
+ * temporaries are given back at the end of their statement. Arguments are placed in
+ * consecutive registers above everything that is live, so the frame of the called
+ * function starts at its first argument.
+ *
+ * Variables are resolved where they are declared, like the type checker does, while
+ * the tree walking interpreter looks them up when they are used. Functions can read
+ * their own variables and the ones of the top level code, a function reading the
+ * variables of a function it is nested in is rejected and `unsupported` says why.
+ */
+class BytecodeCompiler : public Visitor
+{
+public:
+    BytecodeProgram program;
+    std::string unsupported;
+
+    std::map<std::string, int> functions;  // name -> index in the program
+    Environment<std::string> type_table;   // alias -> primitive type
+
+    /*
+     * The state of a function while its body is compiled
+     */
+    struct FunctionState
+    {
+        int index;
+        Environment<int> variables; // name -> register
+        int top = 0;                // the first free register
+        std::vector<std::pair<std::vector<int>, std::vector<int>>> loops; // breaks and continues to patch
+    };
+
+    FunctionState state;
+    std::vector<FunctionState> enclosing;
+
+    // the register an expression should be compiled into, -1 for any
+    int target = -1;
+    int result = -1;
+
+    BytecodeCompiler()
+    {
+        this->type_table.push_env();
+    }
+
+    bool compile(std::vector<std::unique_ptr<Stmt>> *stmts)
+    {
+        try
+        {
+            this->program.main = this->begin_function("main");
+
+            for (auto &stmt : *stmts)
+            {
+                stmt->accept(this);
+            }
+
+            this->emit(OpCode::RETURN_VOID);
+        }
+        catch (VmUnsupported &error)
+        {
+            this->unsupported = error.reason;
+            return false;
+        }
+
+        return true;
+    }
+
+    int begin_function(std::string name)
+    {
+        this->program.functions.push_back(BytecodeFunction(name));
+
+        this->state = FunctionState();
+        this->state.index = this->program.functions.size() - 1;
+        this->state.variables.push_env();
+
+        return this->state.index;
+    }
+
+    BytecodeFunction &function()
+    {
+        return this->program.functions[this->state.index];
+    }
+
+    /*
+     * Registers and instructions
+     */
+    int allocate()
+    {
+        auto reg = this->state.top++;
+        this->function().registers = std::max(this->function().registers, this->state.top);
+
+        return reg;
+    }
+
+    int emit(OpCode op, int a = 0, int b = 0, int c = 0)
+    {
+        this->function().code.push_back(Instruction(op, a, b, c));
+        return this->function().code.size() - 1;
+    }
+
+    int position()
+    {
+        return this->function().code.size();
+    }
+
+    /*
+     * Points a jump emitted earlier at the next instruction
+     */
+    void patch(int jump)
+    {
+        auto &instruction = this->function().code[jump];
+        if (instruction.op == OpCode::JUMP)
+        {
+            instruction.a = this->position();
+        }
+        else
+        {
+            instruction.b = this->position();
+        }
+    }
+
+    int constant(Value value)
+    {
+        this->function().constants.push_back(value);
+        return this->function().constants.size() - 1;
+    }
+
+    /*
+     * Compiles an expression into `target`, or into any register when it is -1,
+     * and returns the register holding the result
+     */
+    int lower(Expr *expr, int target = -1)
+    {
+        this->target = target;
+        expr->accept(this);
+
+        return this->result;
+    }
+
+    /*
+     * The register an expression writes its result to, taken before its operands are compiled
+     */
+    int destination(int target)
+    {
+        return target >= 0 ? target : this->allocate();
+    }
+
+    void declare(std::string name, int reg)
+    {
+        if (this->state.variables.current_contains(name))
+        {
+            this->state.variables.envs.back()[name] = reg;
+        }
+        else
+        {
+            this->state.variables.declare(name, reg);
+        }
+    }
+
+    /*
+     * The register of a variable of the function being compiled,
+     * or -1 when it belongs to the top level code
+     */
+    int local(Token identifier)
+    {
+        if (this->state.variables.contains(identifier.lexeme))
+        {
+            return this->state.variables.get(identifier.lexeme);
+        }
+
+        return -1;
+    }
+
+    int global(Token identifier)
+    {
+        for (int i = 1; i < this->enclosing.size(); i++)
+        {
+            if (this->enclosing[i].variables.contains(identifier.lexeme))
+            {
+                throw VmUnsupported(this->function().name + " uses " + identifier.lexeme + " of the function it is nested in");
+            }
+        }
+
+        if (this->enclosing.empty() || !this->enclosing[0].variables.contains(identifier.lexeme))
+        {
+            throw VmUnsupported(this->function().name + " uses " + identifier.lexeme + " which is not declared before it");
+        }
+
+        return this->enclosing[0].variables.get(identifier.lexeme);
+    }
+
+    /*
+     * The Value alternative of a primitive type, -1 for other types
+     */
+    int tag(std::string type)
+    {
+        if (type == "int")
+            return 0;
+        if (type == "float")
+            return 1;
+        if (type == "str")
+            return 2;
+        if (type == "bool")
+            return 3;
+
+        return -1;
+    }
+
+    std::string primitive_type(Token type_token, bool type_is_literal)
+    {
+        if (type_is_literal || !this->type_table.contains(type_token.lexeme))
+        {
+            return type_token.lexeme;
+        }
+
+        return this->type_table.get(type_token.lexeme);
+    }
+
+    /*
+     * Declarations convert between int and float like the interpreter does
+     */
+    void convert(int reg, std::optional<Token> type_token, bool type_is_literal)
+    {
+        if (!type_token.has_value())
+        {
+            return;
+        }
+
+        auto type = this->primitive_type(type_token.value(), type_is_literal);
+        if (type == "int")
+        {
+            this->emit(OpCode::TO_INT, reg);
+        }
+        else if (type == "float")
+        {
+            this->emit(OpCode::TO_FLOAT, reg);
+        }
+    }
+
+    /*
+     * Whether evaluating an expression can change a variable of the function being
+     * compiled, calls can only change the variables of the top level code
+     */
+    bool changes_variables(Expr *expr)
+    {
+        if (dynamic_cast<AssignExpr *>(expr))
+        {
+            return true;
+        }
+
+        if (auto binary = dynamic_cast<Binary *>(expr))
+        {
+            return this->changes_variables(binary->left.get()) || this->changes_variables(binary->right.get());
+        }
+
+        if (auto unary = dynamic_cast<Unary *>(expr))
+        {
+            return this->changes_variables(unary->expr.get());
+        }
+
+        if (auto ternary = dynamic_cast<Ternary *>(expr))
+        {
+            return this->changes_variables(ternary->condition.get()) ||
+                   this->changes_variables(ternary->true_expr.get()) ||
+                   this->changes_variables(ternary->false_expr.get());
+        }
+
+        if (auto call = dynamic_cast<Call *>(expr))
+        {
+            if (this->enclosing.empty())
+            {
+                return true;
+            }
+
+            for (auto &arg : call->args)
+            {
+                if (this->changes_variables(arg.get()))
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    OpCode op_code(Token op)
+    {
+        switch (op.token_type)
+        {
+        case Token::Type::PLUS:
+        case Token::Type::PLUS_EQUAL:
+            return OpCode::ADD;
+        case Token::Type::MINUS:
+        case Token::Type::MINUS_EQUAL:
+            return OpCode::SUB;
+        case Token::Type::STAR:
+        case Token::Type::STAR_EQUAL:
+            return OpCode::MUL;
+        case Token::Type::SLASH:
+        case Token::Type::SLASH_EQUAL:
+            return OpCode::DIV;
+        case Token::Type::PERCENT:
+        case Token::Type::PERCENT_EQUAL:
+            return OpCode::MOD;
+        case Token::Type::EQUAL_EQUAL:
+            return OpCode::EQ;
+        case Token::Type::BANG_EQUAL:
+            return OpCode::NE;
+        case Token::Type::LESS:
+            return OpCode::LT;
+        case Token::Type::LESS_EQUAL:
+            return OpCode::LE;
+        case Token::Type::GREATER:
+            return OpCode::GT;
+        case Token::Type::GREATER_EQUAL:
+            return OpCode::GE;
+        default:
+            throw BirdException("undefined binary operator " + op.lexeme);
+        }
+    }
+
+    void visit_block(Block *block)
+    {
+        auto top = this->state.top;
+        this->state.variables.push_env();
+
+        for (auto &stmt : block->stmts)
+        {
+            stmt->accept(this);
+        }
+
+        this->state.variables.pop_env();
+        this->state.top = top;
+    }
+
+    void visit_decl_stmt(DeclStmt *decl_stmt)
+    {
+        auto reg = this->allocate();
+        this->lower(decl_stmt->value.get(), reg);
+        this->convert(reg, decl_stmt->type_token, decl_stmt->type_is_literal);
+
+        this->declare(decl_stmt->identifier.lexeme, reg);
+        this->state.top = reg + 1;
+    }
+
+    void visit_const_stmt(ConstStmt *const_stmt)
+    {
+        auto reg = this->allocate();
+        this->lower(const_stmt->value.get(), reg);
+        this->convert(reg, const_stmt->type_token, const_stmt->type_is_literal);
+
+        this->declare(const_stmt->identifier.lexeme, reg);
+        this->state.top = reg + 1;
+    }
+
+    void visit_assign_expr(AssignExpr *assign_expr)
+    {
+        auto target = this->target;
+        auto top = this->state.top;
+        auto compound = assign_expr->assign_operator.token_type != Token::Type::EQUAL;
+        auto reg = this->local(assign_expr->identifier);
+
+        if (reg >= 0)
+        {
+            if (!compound)
+            {
+                this->lower(assign_expr->value.get(), reg);
+            }
+            else if (this->changes_variables(assign_expr->value.get()))
+            {
+                // the interpreter reads the variable before evaluating the value
+                auto previous = this->allocate();
+                this->emit(OpCode::MOVE, previous, reg);
+                auto value = this->lower(assign_expr->value.get());
+                this->emit(this->op_code(assign_expr->assign_operator), reg, previous, value);
+            }
+            else
+            {
+                auto value = this->lower(assign_expr->value.get());
+                this->emit(this->op_code(assign_expr->assign_operator), reg, reg, value);
+            }
+        }
+        else
+        {
+            auto global = this->global(assign_expr->identifier);
+            if (!compound)
+            {
+                reg = this->lower(assign_expr->value.get());
+                this->emit(OpCode::SET_GLOBAL, global, reg);
+            }
+            else
+            {
+                reg = this->allocate();
+                this->emit(OpCode::GET_GLOBAL, reg, global);
+                auto value = this->lower(assign_expr->value.get());
+                this->emit(this->op_code(assign_expr->assign_operator), reg, reg, value);
+                this->emit(OpCode::SET_GLOBAL, global, reg);
+            }
+        }
+
+        // the register holding the assigned value stays taken while it is used
+        this->state.top = std::max(top, reg + 1);
+
+        if (target >= 0 && target != reg)
+        {
+            this->emit(OpCode::MOVE, target, reg);
+            reg = target;
+        }
+
+        this->result = reg;
+    }
+
+    void visit_expr_stmt(ExprStmt *expr_stmt)
+    {
+        auto top = this->state.top;
+        this->lower(expr_stmt->expr.get());
+        this->state.top = top;
+    }
+
+    void visit_print_stmt(PrintStmt *print_stmt)
+    {
+        for (auto &arg : print_stmt->args)
+        {
+            auto top = this->state.top;
+            this->emit(OpCode::PRINT, this->lower(arg.get()));
+            this->state.top = top;
+        }
+
+        this->emit(OpCode::PRINT_LINE);
+    }
+
+    void visit_if_stmt(IfStmt *if_stmt)
+    {
+        auto top = this->state.top;
+        auto condition = this->lower(if_stmt->condition.get());
+        this->state.top = top;
+
+        auto to_else = this->emit(OpCode::JUMP_IF_FALSE, condition);
+        if_stmt->then_branch->accept(this);
+
+        if (if_stmt->else_branch.has_value())
+        {
+            auto to_end = this->emit(OpCode::JUMP);
+            this->patch(to_else);
+            if_stmt->else_branch.value()->accept(this);
+            this->patch(to_end);
+        }
+        else
+        {
+            this->patch(to_else);
+        }
+    }
+
+    void visit_while_stmt(WhileStmt *while_stmt)
+    {
+        auto start = this->position();
+
+        auto top = this->state.top;
+        auto condition = this->lower(while_stmt->condition.get());
+        this->state.top = top;
+
+        auto to_exit = this->emit(OpCode::JUMP_IF_FALSE, condition);
+
+        this->state.loops.push_back({});
+        while_stmt->stmt->accept(this);
+        auto loop = this->state.loops.back();
+        this->state.loops.pop_back();
+
+        for (auto jump : loop.second)
+        {
+            this->function().code[jump].a = start;
+        }
+
+        this->emit(OpCode::JUMP, start);
+        this->patch(to_exit);
+
+        for (auto jump : loop.first)
+        {
+            this->patch(jump);
+        }
+    }
+
+    void visit_for_stmt(ForStmt *for_stmt)
+    {
+        auto top = this->state.top;
+        this->state.variables.push_env();
+
+        if (for_stmt->initializer.has_value())
+        {
+            for_stmt->initializer.value()->accept(this);
+        }
+
+        auto start = this->position();
+
+        std::optional<int> to_exit;
+        if (for_stmt->condition.has_value())
+        {
+            auto condition_top = this->state.top;
+            auto condition = this->lower(for_stmt->condition.value().get());
+            this->state.top = condition_top;
+
+            to_exit = this->emit(OpCode::JUMP_IF_FALSE, condition);
+        }
+
+        this->state.loops.push_back({});
+        for_stmt->body->accept(this);
+        auto loop = this->state.loops.back();
+        this->state.loops.pop_back();
+
+        for (auto jump : loop.second)
+        {
+            this->patch(jump);
+        }
+
+        if (for_stmt->increment.has_value())
+        {
+            auto increment_top = this->state.top;
+            this->lower(for_stmt->increment.value().get());
+            this->state.top = increment_top;
+        }
+
+        this->emit(OpCode::JUMP, start);
+
+        if (to_exit.has_value())
+        {
+            this->patch(to_exit.value());
+        }
+
+        for (auto jump : loop.first)
+        {
+            this->patch(jump);
+        }
+
+        this->state.variables.pop_env();
+        this->state.top = top;
+    }
+
+    void visit_binary(Binary *binary)
+    {
+        auto target = this->target;
+        auto top = this->state.top;
+
+        auto left = this->lower(binary->left.get());
+        if (left < top && this->changes_variables(binary->right.get()))
+        {
+            // the right side can assign the variable the left side read
+            auto copy = this->allocate();
+            this->emit(OpCode::MOVE, copy, left);
+            left = copy;
+        }
+
+        auto right = this->lower(binary->right.get());
+
+        this->state.top = top;
+        auto reg = this->destination(target);
+        this->emit(this->op_code(binary->op), reg, left, right);
+
+        this->result = reg;
+    }
+
+    void visit_unary(Unary *unary)
+    {
+        auto target = this->target;
+        auto top = this->state.top;
+
+        auto value = this->lower(unary->expr.get());
+
+        this->state.top = top;
+        auto reg = this->destination(target);
+        this->emit(OpCode::NEG, reg, value);
+
+        this->result = reg;
+    }
+
+    void visit_primary(Primary *primary)
+    {
+        auto target = this->target;
+
+        switch (primary->value.token_type)
+        {
+        case Token::Type::INT_LITERAL:
+            this->result = this->destination(target);
+            this->emit(OpCode::LOAD_CONST, this->result, this->constant(Value(std::stoi(primary->value.lexeme))));
+            break;
+        case Token::Type::FLOAT_LITERAL:
+            this->result = this->destination(target);
+            this->emit(OpCode::LOAD_CONST, this->result, this->constant(Value(std::stod(primary->value.lexeme))));
+            break;
+        case Token::Type::BOOL_LITERAL:
+            this->result = this->destination(target);
+            this->emit(OpCode::LOAD_CONST, this->result, this->constant(Value(primary->value.lexeme == "true")));
+            break;
+        case Token::Type::STR_LITERAL:
+            this->result = this->destination(target);
+            this->emit(OpCode::LOAD_CONST, this->result, this->constant(Value::intern(primary->value.lexeme)));
+            break;
+        case Token::Type::IDENTIFIER:
+        {
+            auto reg = this->local(primary->value);
+            if (reg < 0)
+            {
+                this->result = this->destination(target);
+                this->emit(OpCode::GET_GLOBAL, this->result, this->global(primary->value));
+            }
+            else if (target >= 0 && target != reg)
+            {
+                this->emit(OpCode::MOVE, target, reg);
+                this->result = target;
+            }
+            else
+            {
+                // variables are read in place
+                this->result = reg;
+            }
+            break;
+        }
+        default:
+            throw BirdException("undefined primary value: " + primary->value.lexeme);
+        }
+    }
+
+    /*
+     * Both sides of a ternary write to the same register
+     */
+    void visit_ternary(Ternary *ternary)
+    {
+        auto target = this->target;
+        auto top = this->state.top;
+
+        auto condition = this->lower(ternary->condition.get());
+
+        this->state.top = top;
+        auto reg = this->destination(target);
+        auto to_false = this->emit(OpCode::JUMP_IF_FALSE, condition);
+
+        auto branch_top = this->state.top;
+        this->lower(ternary->true_expr.get(), reg);
+        this->state.top = branch_top;
+        auto to_end = this->emit(OpCode::JUMP);
+
+        this->patch(to_false);
+        this->lower(ternary->false_expr.get(), reg);
+        this->state.top = branch_top;
+        this->patch(to_end);
+
+        this->result = reg;
+    }
+
+    void visit_func(Func *func)
+    {
+        auto name = func->identifier.lexeme;
+
+        this->enclosing.push_back(std::move(this->state));
+        auto index = this->begin_function(name);
+        this->functions[name] = index;
+
+        for (auto &param : func->param_list)
+        {
+            this->function().param_tags.push_back(this->tag(this->primitive_type(param.second, false)));
+            this->declare(param.first.lexeme, this->allocate());
+        }
+
+        for (auto &stmt : dynamic_cast<Block *>(func->block.get())->stmts)
+        {
+            stmt->accept(this);
+        }
+
+        this->emit(OpCode::RETURN_VOID);
+
+        this->state = std::move(this->enclosing.back());
+        this->enclosing.pop_back();
+    }
+
+    void visit_call(Call *call)
+    {
+        auto target = this->target;
+        auto top = this->state.top;
+
+        auto found = this->functions.find(call->identifier.lexeme);
+        if (found == this->functions.end())
+        {
+            throw VmUnsupported("call to " + call->identifier.lexeme + " before it is declared");
+        }
+
+        // the arguments become the first registers of the called function
+        auto first = this->state.top;
+        for (int i = 0; i < call->args.size(); i++)
+        {
+            this->allocate();
+        }
+
+        for (int i = 0; i < call->args.size(); i++)
+        {
+            auto arg_top = this->state.top;
+            this->lower(call->args[i].get(), first + i);
+            this->state.top = arg_top;
+        }
+
+        this->state.top = top;
+        auto reg = this->destination(target);
+        this->emit(OpCode::CALL, reg, found->second, first);
+
+        this->result = reg;
+    }
+
+    void visit_return_stmt(ReturnStmt *return_stmt)
+    {
+        auto top = this->state.top;
+
+        if (return_stmt->expr.has_value())
+        {
+            this->emit(OpCode::RETURN, this->lower(return_stmt->expr.value().get()));
+        }
+        else
+        {
+            this->emit(OpCode::RETURN_VOID);
+        }
+
+        this->state.top = top;
+    }
+
+    void visit_break_stmt(BreakStmt *break_stmt)
+    {
+        this->state.loops.back().first.push_back(this->emit(OpCode::JUMP));
+    }
+
+    void visit_continue_stmt(ContinueStmt *continue_stmt)
+    {
+        this->state.loops.back().second.push_back(this->emit(OpCode::JUMP));
+    }
+
+    void visit_type_stmt(TypeStmt *type_stmt)
+    {
+        auto type = this->primitive_type(type_stmt->type_token, type_stmt->type_is_literal);
+        if (this->type_table.current_contains(type_stmt->identifier.lexeme))
+        {
+            this->type_table.envs.back()[type_stmt->identifier.lexeme] = type;
+        }
+        else
+        {
+            this->type_table.declare(type_stmt->identifier.lexeme, type);
+        }
+    }
+};
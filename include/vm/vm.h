@@ -0,0 +1,286 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <iostream>
+
+#include "vm/bytecode.h"
+#include "value.h"
+#include "exceptions/bird_exception.h"
+
+/*
+ * A call that has not returned yet, `base` is the index of its first register
+ * in the register file and `result` the absolute register its value goes to
+ */
+struct CallFrame
+{
+    BytecodeFunction *function;
+    int pc;
+    int base;
+    int result;
+
+    CallFrame(BytecodeFunction *function, int base, int result) : function(function), pc(0), base(base), result(result) {}
+};
+
+/*
+ * Runs a bytecode program with a register machine.
+ *
+ * Every frame is a window into one register file that grows with the calls,
+ * the frame of main starts at 0 so globals are plain indexes. Operations on
+ * two ints or two floats are done in place, everything else goes through the
+ * Value operators, so errors and results match the tree walking interpreter.
+ */
+class Vm
+{
+public:
+    std::vector<Value> registers;
+    std::vector<CallFrame> frames;
+
+    void run(BytecodeProgram *program)
+    {
+        auto main = &program->functions[program->main];
+        this->registers.assign(main->registers, Value(0));
+        this->frames.clear();
+        this->frames.push_back(CallFrame(main, 0, -1));
+
+        auto frame = &this->frames.back();
+        auto code = frame->function->code.data();
+        auto constants = frame->function->constants.data();
+        auto regs = this->registers.data();
+        int pc = 0;
+
+        while (true)
+        {
+            auto &instruction = code[pc++];
+
+            switch (instruction.op)
+            {
+            case OpCode::LOAD_CONST:
+                regs[instruction.a] = constants[instruction.b];
+                break;
+            case OpCode::MOVE:
+                regs[instruction.a] = regs[instruction.b];
+                break;
+            case OpCode::GET_GLOBAL:
+                regs[instruction.a] = this->registers[instruction.b];
+                break;
+            case OpCode::SET_GLOBAL:
+                this->registers[instruction.a] = regs[instruction.b];
+                break;
+            case OpCode::TO_INT:
+                if (regs[instruction.a].is_double())
+                {
+                    regs[instruction.a] = Value((int)regs[instruction.a].as_double());
+                }
+                break;
+            case OpCode::TO_FLOAT:
+                if (regs[instruction.a].is_int())
+                {
+                    regs[instruction.a] = Value((double)regs[instruction.a].as_int());
+                }
+                break;
+            case OpCode::ADD:
+                if (instruction.a == instruction.b && regs[instruction.b].is_string() && regs[instruction.c].is_string())
+                {
+                    regs[instruction.a].append(regs[instruction.c]);
+                    break;
+                }
+
+                this->arithmetic(regs, instruction, std::plus<>());
+                break;
+            case OpCode::SUB:
+                this->arithmetic(regs, instruction, std::minus<>());
+                break;
+            case OpCode::MUL:
+                this->arithmetic(regs, instruction, std::multiplies<>());
+                break;
+            case OpCode::DIV:
+            {
+                auto &left = regs[instruction.b];
+                auto &right = regs[instruction.c];
+                if (left.is_int() && right.is_int() && right.as_int() != 0)
+                {
+                    regs[instruction.a] = Value(left.as_int() / right.as_int());
+                }
+                else
+                {
+                    regs[instruction.a] = regs[instruction.b] / regs[instruction.c];
+                }
+                break;
+            }
+            case OpCode::MOD:
+            {
+                auto &left = regs[instruction.b];
+                auto &right = regs[instruction.c];
+                if (left.is_int() && right.is_int() && right.as_int() != 0)
+                {
+                    regs[instruction.a] = Value(left.as_int() % right.as_int());
+                }
+                else
+                {
+                    regs[instruction.a] = regs[instruction.b] % regs[instruction.c];
+                }
+                break;
+            }
+            case OpCode::NEG:
+                regs[instruction.a] = -regs[instruction.b];
+                break;
+            case OpCode::EQ:
+                this->comparison(regs, instruction, std::equal_to<>());
+                break;
+            case OpCode::NE:
+                this->comparison(regs, instruction, std::not_equal_to<>());
+                break;
+            case OpCode::LT:
+                this->comparison(regs, instruction, std::less<>());
+                break;
+            case OpCode::LE:
+                this->comparison(regs, instruction, std::less_equal<>());
+                break;
+            case OpCode::GT:
+                this->comparison(regs, instruction, std::greater<>());
+                break;
+            case OpCode::GE:
+                this->comparison(regs, instruction, std::greater_equal<>());
+                break;
+            case OpCode::JUMP:
+                pc = instruction.a;
+                break;
+            case OpCode::JUMP_IF_FALSE:
+                if (!as_type<bool>(regs[instruction.a]))
+                {
+                    pc = instruction.b;
+                }
+                break;
+            case OpCode::CALL:
+            {
+                auto callee = &program->functions[instruction.b];
+                auto base = frame->base + instruction.c;
+
+                for (int i = 0; i < callee->param_tags.size(); i++)
+                {
+                    auto tag = callee->param_tags[i];
+                    if (tag >= 0 && regs[instruction.c + i].index() != tag)
+                    {
+                        throw BirdException("Type mismatch");
+                    }
+                }
+
+                if (this->registers.size() < base + callee->registers)
+                {
+                    this->registers.resize(std::max(base + callee->registers, (int)this->registers.size() * 2));
+                }
+
+                frame->pc = pc;
+                this->frames.push_back(CallFrame(callee, base, frame->base + instruction.a));
+
+                frame = &this->frames.back();
+                code = callee->code.data();
+                constants = callee->constants.data();
+                regs = this->registers.data() + base;
+                pc = 0;
+                break;
+            }
+            case OpCode::RETURN:
+            case OpCode::RETURN_VOID:
+            {
+                auto result = frame->result;
+                if (instruction.op == OpCode::RETURN)
+                {
+                    this->registers[result] = regs[instruction.a];
+                }
+
+                this->frames.pop_back();
+                if (this->frames.empty())
+                {
+                    return;
+                }
+
+                frame = &this->frames.back();
+                code = frame->function->code.data();
+                constants = frame->function->constants.data();
+                regs = this->registers.data() + frame->base;
+                pc = frame->pc;
+                break;
+            }
+            case OpCode::PRINT:
+                std::cout << regs[instruction.a];
+                break;
+            case OpCode::PRINT_LINE:
+                std::cout << std::endl;
+                break;
+            default:
+                throw BirdException("unknown op code " + op_code_to_string(instruction.op));
+            }
+        }
+    }
+
+    template <typename Op>
+    void arithmetic(Value *regs, Instruction &instruction, Op op)
+    {
+        auto &left = regs[instruction.b];
+        auto &right = regs[instruction.c];
+
+        if (left.is_int() && right.is_int())
+        {
+            regs[instruction.a] = Value((int)op(left.as_int(), right.as_int()));
+            return;
+        }
+
+        if (left.is_double() && right.is_double())
+        {
+            regs[instruction.a] = Value((double)op(left.as_double(), right.as_double()));
+            return;
+        }
+
+        regs[instruction.a] = this->apply(instruction.op, regs[instruction.b], regs[instruction.c]);
+    }
+
+    template <typename Op>
+    void comparison(Value *regs, Instruction &instruction, Op op)
+    {
+        auto &left = regs[instruction.b];
+        auto &right = regs[instruction.c];
+
+        if (left.is_int() && right.is_int())
+        {
+            regs[instruction.a] = Value((bool)op(left.as_int(), right.as_int()));
+            return;
+        }
+
+        if (left.is_double() && right.is_double())
+        {
+            regs[instruction.a] = Value((bool)op(left.as_double(), right.as_double()));
+            return;
+        }
+
+        regs[instruction.a] = this->apply(instruction.op, regs[instruction.b], regs[instruction.c]);
+    }
+
+    Value apply(OpCode op, Value left, Value right)
+    {
+        switch (op)
+        {
+        case OpCode::ADD:
+            return left + right;
+        case OpCode::SUB:
+            return left - right;
+        case OpCode::MUL:
+            return left * right;
+        case OpCode::EQ:
+            return left == right;
+        case OpCode::NE:
+            return left != right;
+        case OpCode::LT:
+            return left < right;
+        case OpCode::LE:
+            return left <= right;
+        case OpCode::GT:
+            return left > right;
+        case OpCode::GE:
+            return left >= right;
+        default:
+            throw BirdException("unknown op code " + op_code_to_string(op));
+        }
+    }
+};
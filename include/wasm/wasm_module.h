@@ -0,0 +1,486 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "exceptions/bird_exception.h"
+
+/*
+ * The value types of wasm, as they are encoded
+ */
+enum class WasmType : uint8_t
+{
+    I32 = 0x7F,
+    I64 = 0x7E,
+    F32 = 0x7D,
+    F64 = 0x7C,
+};
+
+struct WasmFunctionType
+{
+    std::vector<WasmType> params;
+    std::vector<WasmType> results;
+};
+
+/*
+ * A function of the module, imported ones have no code and are
+ * called by their module and field name
+ */
+struct WasmFunction
+{
+    uint32_t type;
+    std::string import_module;
+    std::string import_name;
+    std::vector<WasmType> locals; // the locals after the parameters
+    size_t code = 0;              // the first instruction
+    size_t end = 0;               // one past the final end
+
+    bool imported() const
+    {
+        return !this->import_name.empty();
+    }
+};
+
+struct WasmGlobal
+{
+    WasmType type;
+    uint64_t value;
+};
+
+struct WasmDataSegment
+{
+    bool active;
+    uint32_t offset;
+    size_t data;
+    size_t size;
+};
+
+/*
+ * A decoded wasm binary.
+ *
+ * Instructions stay in the binary and run from there, decoding only records where
+ * each function starts and where every block, loop and if ends so branches jump
+ * straight to their targets.
+ */
+class WasmModule
+{
+public:
+    std::vector<uint8_t> binary;
+    std::vector<WasmFunctionType> types;
+    std::vector<WasmFunction> functions;
+    std::vector<WasmGlobal> globals;
+    std::vector<WasmDataSegment> data_segments;
+    std::unordered_map<std::string, uint32_t> exports;
+    uint32_t memory_pages = 0;
+    int64_t start = -1;
+
+    // a block, loop or if to the position after its end, an if to the position after its else
+    std::unordered_map<size_t, size_t> ends;
+    std::unordered_map<size_t, size_t> elses;
+
+    WasmModule(std::vector<uint8_t> binary) : binary(std::move(binary))
+    {
+        this->decode();
+    }
+
+    [[noreturn]] static void malformed(std::string reason)
+    {
+        throw BirdException("malformed wasm module: " + reason);
+    }
+
+    uint8_t byte(size_t &at)
+    {
+        if (at >= this->binary.size())
+        {
+            WasmModule::malformed("unexpected end");
+        }
+
+        return this->binary[at++];
+    }
+
+    uint64_t unsigned_leb(size_t &at)
+    {
+        uint64_t result = 0;
+        int shift = 0;
+        uint8_t next;
+        do
+        {
+            next = this->byte(at);
+            result |= (uint64_t)(next & 0x7F) << shift;
+            shift += 7;
+        } while (next & 0x80);
+
+        return result;
+    }
+
+    int64_t signed_leb(size_t &at)
+    {
+        int64_t result = 0;
+        int shift = 0;
+        uint8_t next;
+        do
+        {
+            next = this->byte(at);
+            result |= (int64_t)(next & 0x7F) << shift;
+            shift += 7;
+        } while (next & 0x80);
+
+        if (shift < 64 && (next & 0x40))
+        {
+            result |= -((int64_t)1 << shift);
+        }
+
+        return result;
+    }
+
+    std::string name(size_t &at)
+    {
+        auto size = this->unsigned_leb(at);
+        if (at + size > this->binary.size())
+        {
+            WasmModule::malformed("unexpected end");
+        }
+
+        std::string result((const char *)&this->binary[at], size);
+        at += size;
+        return result;
+    }
+
+    /*
+     * The value of a constant initializer like `i32.const 1024 end`
+     */
+    uint64_t constant(size_t &at)
+    {
+        uint64_t value = 0;
+        switch (this->byte(at))
+        {
+        case 0x41:
+            value = (uint32_t)this->signed_leb(at);
+            break;
+        case 0x42:
+            value = this->signed_leb(at);
+            break;
+        case 0x44:
+            std::memcpy(&value, &this->binary[at], 8);
+            at += 8;
+            break;
+        case 0x23:
+            value = this->globals.at(this->unsigned_leb(at)).value;
+            break;
+        default:
+            WasmModule::malformed("unsupported constant expression");
+        }
+
+        if (this->byte(at) != 0x0B)
+        {
+            WasmModule::malformed("unsupported constant expression");
+        }
+
+        return value;
+    }
+
+    void decode()
+    {
+        size_t at = 0;
+        if (this->binary.size() < 8 || std::memcmp(this->binary.data(), "\0asm\1\0\0\0", 8) != 0)
+        {
+            WasmModule::malformed("not a wasm binary");
+        }
+
+        at = 8;
+        std::vector<uint32_t> defined; // the types of the functions with code, in order
+        while (at < this->binary.size())
+        {
+            auto id = this->byte(at);
+            auto size = this->unsigned_leb(at);
+            auto section_end = at + size;
+
+            switch (id)
+            {
+            case 1:
+                this->decode_types(at);
+                break;
+            case 2:
+                this->decode_imports(at);
+                break;
+            case 3:
+                for (auto count = this->unsigned_leb(at); count > 0; count--)
+                {
+                    defined.push_back(this->unsigned_leb(at));
+                }
+                break;
+            case 5:
+                if (this->unsigned_leb(at) > 0)
+                {
+                    auto flags = this->byte(at);
+                    this->memory_pages = this->unsigned_leb(at);
+                    if (flags & 1)
+                    {
+                        this->unsigned_leb(at);
+                    }
+                }
+                break;
+            case 6:
+                for (auto count = this->unsigned_leb(at); count > 0; count--)
+                {
+                    auto type = (WasmType)this->byte(at);
+                    this->byte(at); // mutability
+                    this->globals.push_back({type, this->constant(at)});
+                }
+                break;
+            case 7:
+                for (auto count = this->unsigned_leb(at); count > 0; count--)
+                {
+                    auto name = this->name(at);
+                    auto kind = this->byte(at);
+                    auto index = this->unsigned_leb(at);
+                    if (kind == 0)
+                    {
+                        this->exports[name] = index;
+                    }
+                }
+                break;
+            case 8:
+                this->start = this->unsigned_leb(at);
+                break;
+            case 10:
+                this->decode_code(at, defined);
+                break;
+            case 11:
+                this->decode_data(at);
+                break;
+            }
+
+            // custom, table, element and data count sections are not needed to run Bird programs
+            at = section_end;
+        }
+    }
+
+    void decode_types(size_t &at)
+    {
+        for (auto count = this->unsigned_leb(at); count > 0; count--)
+        {
+            if (this->byte(at) != 0x60)
+            {
+                WasmModule::malformed("unsupported type");
+            }
+
+            WasmFunctionType type;
+            for (auto params = this->unsigned_leb(at); params > 0; params--)
+            {
+                type.params.push_back((WasmType)this->byte(at));
+            }
+
+            for (auto results = this->unsigned_leb(at); results > 0; results--)
+            {
+                type.results.push_back((WasmType)this->byte(at));
+            }
+
+            this->types.push_back(type);
+        }
+    }
+
+    void decode_imports(size_t &at)
+    {
+        for (auto count = this->unsigned_leb(at); count > 0; count--)
+        {
+            WasmFunction function;
+            function.import_module = this->name(at);
+            function.import_name = this->name(at);
+
+            if (this->byte(at) != 0)
+            {
+                WasmModule::malformed("only functions can be imported");
+            }
+
+            function.type = this->unsigned_leb(at);
+            this->functions.push_back(function);
+        }
+    }
+
+    void decode_code(size_t &at, const std::vector<uint32_t> &defined)
+    {
+        auto count = this->unsigned_leb(at);
+        if (count != defined.size())
+        {
+            WasmModule::malformed("function and code counts differ");
+        }
+
+        for (auto type : defined)
+        {
+            auto size = this->unsigned_leb(at);
+            auto body_end = at + size;
+
+            WasmFunction function;
+            function.type = type;
+            for (auto groups = this->unsigned_leb(at); groups > 0; groups--)
+            {
+                auto repeat = this->unsigned_leb(at);
+                auto local_type = (WasmType)this->byte(at);
+                function.locals.insert(function.locals.end(), repeat, local_type);
+            }
+
+            function.code = at;
+            function.end = body_end;
+            this->functions.push_back(function);
+
+            this->match_blocks(function.code, function.end);
+            at = body_end;
+        }
+    }
+
+    void decode_data(size_t &at)
+    {
+        for (auto count = this->unsigned_leb(at); count > 0; count--)
+        {
+            WasmDataSegment segment = {false, 0, 0, 0};
+            auto flags = this->unsigned_leb(at);
+            if (flags == 0 || flags == 2)
+            {
+                if (flags == 2)
+                {
+                    this->unsigned_leb(at); // memory index
+                }
+
+                segment.active = true;
+                segment.offset = this->constant(at);
+            }
+
+            segment.size = this->unsigned_leb(at);
+            segment.data = at;
+            at += segment.size;
+
+            this->data_segments.push_back(segment);
+        }
+    }
+
+    void skip_block_type(size_t &at)
+    {
+        auto first = this->binary.at(at);
+        if (first == 0x40 || first == 0x7F || first == 0x7E || first == 0x7D || first == 0x7C)
+        {
+            at++;
+        }
+        else
+        {
+            this->signed_leb(at);
+        }
+    }
+
+    /*
+     * Walks the instructions of a body and records the end of every block and the
+     * else of every if
+     */
+    void match_blocks(size_t at, size_t end)
+    {
+        std::vector<size_t> open;
+        while (at < end)
+        {
+            auto start = at;
+            auto opcode = this->byte(at);
+
+            switch (opcode)
+            {
+            case 0x02: // block
+            case 0x03: // loop
+            case 0x04: // if
+                this->skip_block_type(at);
+                open.push_back(start);
+                break;
+            case 0x05: // else
+                if (open.empty())
+                {
+                    WasmModule::malformed("else outside of an if");
+                }
+                this->elses[open.back()] = at;
+                open.push_back(start);
+                break;
+            case 0x0B: // end
+                if (!open.empty())
+                {
+                    // the else closes together with its if
+                    if (this->binary[open.back()] == 0x05)
+                    {
+                        this->ends[open.back()] = at;
+                        open.pop_back();
+                    }
+
+                    this->ends[open.back()] = at;
+                    open.pop_back();
+                }
+                break;
+            default:
+                this->skip_immediates(opcode, at);
+            }
+        }
+    }
+
+    void skip_immediates(uint8_t opcode, size_t &at)
+    {
+        switch (opcode)
+        {
+        case 0x0C: // br
+        case 0x0D: // br_if
+        case 0x10: // call
+        case 0x20: // local.get
+        case 0x21: // local.set
+        case 0x22: // local.tee
+        case 0x23: // global.get
+        case 0x24: // global.set
+        case 0x3F: // memory.size
+        case 0x40: // memory.grow
+            this->unsigned_leb(at);
+            break;
+        case 0x0E: // br_table
+            for (auto count = this->unsigned_leb(at) + 1; count > 0; count--)
+            {
+                this->unsigned_leb(at);
+            }
+            break;
+        case 0x11: // call_indirect
+            this->unsigned_leb(at);
+            this->unsigned_leb(at);
+            break;
+        case 0x1C: // select with types
+            for (auto count = this->unsigned_leb(at); count > 0; count--)
+            {
+                this->byte(at);
+            }
+            break;
+        case 0x41: // i32.const
+        case 0x42: // i64.const
+            this->signed_leb(at);
+            break;
+        case 0x43: // f32.const
+            at += 4;
+            break;
+        case 0x44: // f64.const
+            at += 8;
+            break;
+        case 0xFC:
+        {
+            auto sub = this->unsigned_leb(at);
+            if (sub == 0x08 || sub == 0x0A) // memory.init, memory.copy
+            {
+                this->unsigned_leb(at);
+                this->unsigned_leb(at);
+            }
+            else if (sub == 0x09 || sub == 0x0B) // data.drop, memory.fill
+            {
+                this->unsigned_leb(at);
+            }
+            break;
+        }
+        default:
+            // loads and stores take an alignment and an offset
+            if (opcode >= 0x28 && opcode <= 0x3E)
+            {
+                this->unsigned_leb(at);
+                this->unsigned_leb(at);
+            }
+        }
+    }
+};
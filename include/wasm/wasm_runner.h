@@ -0,0 +1,801 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "wasm/wasm_module.h"
+#include "exceptions/bird_exception.h"
+
+/*
+ * Runs the modules CodeGen generates in this process, instead of under node.
+ *
+ * The interpreter covers the integer, float, memory and control flow instructions
+ * of the MVP and the saturating truncations and bulk memory operations Binaryen
+ * emits. The env imports print_i32, print_f64 and print_str are native and print
+ * a line each, formatted like console.log. A trap throws a BirdException.
+ */
+class WasmRunner
+{
+public:
+    static constexpr int max_call_depth = 10000;
+
+    WasmModule module;
+    std::vector<uint8_t> memory;
+    std::vector<uint64_t> stack;
+    std::ostream *out;
+    int depth = 0;
+
+    WasmRunner(std::vector<uint8_t> binary, std::ostream &out = std::cout) : module(std::move(binary)), out(&out)
+    {
+        this->memory.assign((size_t)this->module.memory_pages * 65536, 0);
+
+        for (auto &segment : this->module.data_segments)
+        {
+            if (segment.active)
+            {
+                this->check_memory(segment.offset, segment.size);
+                std::memcpy(&this->memory[segment.offset], &this->module.binary[segment.data], segment.size);
+            }
+        }
+    }
+
+    /*
+     * Runs the start function if there is one, then the exported function `name`
+     */
+    void run(std::string name = "main")
+    {
+        if (this->module.start >= 0)
+        {
+            this->call(this->module.start);
+        }
+
+        auto exported = this->module.exports.find(name);
+        if (exported == this->module.exports.end())
+        {
+            throw BirdException("the wasm module does not export " + name);
+        }
+
+        this->call(exported->second);
+        this->stack.clear();
+    }
+
+    [[noreturn]] static void trap(std::string reason)
+    {
+        throw BirdException("wasm trap: " + reason);
+    }
+
+    /*
+     * Formats a float like JavaScript's Number.prototype.toString
+     */
+    static std::string number_to_string(double value)
+    {
+        if (std::isnan(value))
+            return "NaN";
+        if (std::isinf(value))
+            return value < 0 ? "-Infinity" : "Infinity";
+        if (value == 0)
+            return "0";
+
+        // the shortest digits that read back as the same value
+        char buffer[32];
+        for (int precision = 1; precision <= 17; precision++)
+        {
+            std::snprintf(buffer, sizeof(buffer), "%.*e", precision - 1, value);
+            if (std::strtod(buffer, nullptr) == value)
+                break;
+        }
+
+        std::string text = buffer;
+        std::string sign = text[0] == '-' ? "-" : "";
+        if (!sign.empty())
+            text = text.substr(1);
+
+        auto e = text.find('e');
+        std::string digits = text.substr(0, 1) + (e > 2 ? text.substr(2, e - 2) : "");
+        int point = std::atoi(text.c_str() + e + 1) + 1; // value = 0.digits * 10^point
+        int count = digits.size();
+
+        if (count <= point && point <= 21)
+            return sign + digits + std::string(point - count, '0');
+        if (0 < point && point <= 21)
+            return sign + digits.substr(0, point) + "." + digits.substr(point);
+        if (-6 < point && point <= 0)
+            return sign + "0." + std::string(-point, '0') + digits;
+
+        auto exponent = point - 1;
+        return sign + digits.substr(0, 1) + (count > 1 ? "." + digits.substr(1) : "") +
+               "e" + (exponent < 0 ? "-" : "+") + std::to_string(std::abs(exponent));
+    }
+
+    void check_memory(uint64_t address, uint64_t size)
+    {
+        if (address + size > this->memory.size())
+        {
+            WasmRunner::trap("out of bounds memory access");
+        }
+    }
+
+    void push_i32(uint32_t value)
+    {
+        this->stack.push_back(value);
+    }
+
+    void push_f64(double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, 8);
+        this->stack.push_back(bits);
+    }
+
+    uint64_t pop()
+    {
+        auto value = this->stack.back();
+        this->stack.pop_back();
+        return value;
+    }
+
+    uint32_t pop_i32()
+    {
+        return (uint32_t)this->pop();
+    }
+
+    double pop_f64()
+    {
+        auto bits = this->pop();
+        double value;
+        std::memcpy(&value, &bits, 8);
+        return value;
+    }
+
+    void call_import(WasmFunction &function)
+    {
+        if (function.import_module == "env" && function.import_name == "print_i32")
+        {
+            *this->out << (int32_t)this->pop_i32() << std::endl;
+        }
+        else if (function.import_module == "env" && function.import_name == "print_f64")
+        {
+            *this->out << WasmRunner::number_to_string(this->pop_f64()) << std::endl;
+        }
+        else if (function.import_module == "env" && function.import_name == "print_str")
+        {
+            auto address = this->pop_i32();
+            auto end = address;
+            while (true)
+            {
+                this->check_memory(end, 1);
+                if (this->memory[end] == 0)
+                    break;
+                end++;
+            }
+
+            *this->out << std::string((const char *)&this->memory[address], end - address) << std::endl;
+        }
+        else
+        {
+            throw BirdException("unknown wasm import " + function.import_module + "." + function.import_name);
+        }
+    }
+
+    /*
+     * A branch target, branching to a block or an if leaves it and branching to
+     * a loop starts it over
+     */
+    struct Label
+    {
+        size_t continuation;
+        size_t height;
+        size_t arity;
+        bool loop;
+    };
+
+    size_t block_arity(size_t &pc)
+    {
+        auto first = this->module.binary[pc];
+        if (first == 0x40)
+        {
+            pc++;
+            return 0;
+        }
+
+        if (first == 0x7F || first == 0x7E || first == 0x7D || first == 0x7C)
+        {
+            pc++;
+            return 1;
+        }
+
+        return this->module.types.at(this->module.signed_leb(pc)).results.size();
+    }
+
+    /*
+     * Leaves the arguments on the stack for the callee and its results for the caller
+     */
+    void call(uint32_t index)
+    {
+        auto &function = this->module.functions.at(index);
+        if (function.imported())
+        {
+            this->call_import(function);
+            return;
+        }
+
+        if (++this->depth > max_call_depth)
+        {
+            WasmRunner::trap("call stack exhausted");
+        }
+
+        auto &type = this->module.types[function.type];
+        std::vector<uint64_t> locals(type.params.size() + function.locals.size(), 0);
+        for (int i = type.params.size() - 1; i >= 0; i--)
+        {
+            locals[i] = this->pop();
+        }
+
+        this->execute(function, locals, this->stack.size(), type.results.size());
+        this->depth--;
+    }
+
+    void branch(std::vector<Label> &labels, uint32_t depth, size_t &pc)
+    {
+        auto target = labels.size() - 1 - depth;
+        auto label = labels[target];
+
+        // the results of the block stay on top of what was below it
+        std::move(this->stack.end() - label.arity, this->stack.end(), this->stack.begin() + label.height);
+        this->stack.resize(label.height + label.arity);
+
+        pc = label.continuation;
+        labels.resize(label.loop ? target + 1 : target);
+    }
+
+    void execute(WasmFunction &function, std::vector<uint64_t> &locals, size_t height, size_t arity)
+    {
+        auto &binary = this->module.binary;
+        auto &module = this->module;
+        std::vector<Label> labels;
+        size_t pc = function.code;
+
+        while (true)
+        {
+            auto start = pc;
+            auto opcode = binary[pc++];
+
+            switch (opcode)
+            {
+            case 0x00:
+                WasmRunner::trap("unreachable");
+            case 0x01: // nop
+                break;
+            case 0x02: // block
+            {
+                auto block_arity = this->block_arity(pc);
+                labels.push_back({module.ends[start], this->stack.size(), block_arity, false});
+                break;
+            }
+            case 0x03: // loop
+            {
+                this->block_arity(pc);
+                labels.push_back({pc, this->stack.size(), 0, true});
+                break;
+            }
+            case 0x04: // if
+            {
+                auto block_arity = this->block_arity(pc);
+                auto condition = this->pop_i32();
+                if (condition)
+                {
+                    labels.push_back({module.ends[start], this->stack.size(), block_arity, false});
+                }
+                else if (module.elses.count(start))
+                {
+                    pc = module.elses[start];
+                    labels.push_back({module.ends[start], this->stack.size(), block_arity, false});
+                }
+                else
+                {
+                    pc = module.ends[start];
+                }
+                break;
+            }
+            case 0x05: // else, the then branch is done
+                pc = module.ends[start];
+                labels.pop_back();
+                break;
+            case 0x0B: // end
+                if (labels.empty())
+                {
+                    std::move(this->stack.end() - arity, this->stack.end(), this->stack.begin() + height);
+                    this->stack.resize(height + arity);
+                    return;
+                }
+                labels.pop_back();
+                break;
+            case 0x0C: // br
+                this->branch(labels, module.unsigned_leb(pc), pc);
+                break;
+            case 0x0D: // br_if
+            {
+                auto depth = module.unsigned_leb(pc);
+                if (this->pop_i32())
+                {
+                    this->branch(labels, depth, pc);
+                }
+                break;
+            }
+            case 0x0E: // br_table
+            {
+                auto index = this->pop_i32();
+                auto count = module.unsigned_leb(pc);
+                uint64_t depth = 0;
+                for (uint64_t i = 0; i <= count; i++)
+                {
+                    auto target = module.unsigned_leb(pc);
+                    if (i == index || i == count)
+                    {
+                        depth = target;
+                        break;
+                    }
+                }
+                this->branch(labels, depth, pc);
+                break;
+            }
+            case 0x0F: // return
+                std::move(this->stack.end() - arity, this->stack.end(), this->stack.begin() + height);
+                this->stack.resize(height + arity);
+                return;
+            case 0x10: // call
+                this->call(module.unsigned_leb(pc));
+                break;
+            case 0x1A: // drop
+                this->pop();
+                break;
+            case 0x1C: // select with types
+                for (auto count = module.unsigned_leb(pc); count > 0; count--)
+                    pc++;
+                // fallthrough
+            case 0x1B: // select
+            {
+                auto condition = this->pop_i32();
+                auto second = this->pop();
+                auto first = this->pop();
+                this->stack.push_back(condition ? first : second);
+                break;
+            }
+            case 0x20: // local.get
+                this->stack.push_back(locals[module.unsigned_leb(pc)]);
+                break;
+            case 0x21: // local.set
+                locals[module.unsigned_leb(pc)] = this->pop();
+                break;
+            case 0x22: // local.tee
+                locals[module.unsigned_leb(pc)] = this->stack.back();
+                break;
+            case 0x23: // global.get
+                this->stack.push_back(module.globals.at(module.unsigned_leb(pc)).value);
+                break;
+            case 0x24: // global.set
+                module.globals.at(module.unsigned_leb(pc)).value = this->pop();
+                break;
+            case 0x28: // i32.load
+            case 0x2B: // f64.load
+            case 0x2C: // i32.load8_s
+            case 0x2D: // i32.load8_u
+            case 0x2E: // i32.load16_s
+            case 0x2F: // i32.load16_u
+                this->load(opcode, pc);
+                break;
+            case 0x36: // i32.store
+            case 0x39: // f64.store
+            case 0x3A: // i32.store8
+            case 0x3B: // i32.store16
+                this->store(opcode, pc);
+                break;
+            case 0x3F: // memory.size
+                module.unsigned_leb(pc);
+                this->push_i32(this->memory.size() / 65536);
+                break;
+            case 0x40: // memory.grow
+            {
+                module.unsigned_leb(pc);
+                auto pages = this->pop_i32();
+                auto previous = this->memory.size() / 65536;
+                if (previous + pages > 65536)
+                {
+                    this->push_i32((uint32_t)-1);
+                }
+                else
+                {
+                    this->memory.resize((previous + pages) * 65536, 0);
+                    this->push_i32(previous);
+                }
+                break;
+            }
+            case 0x41: // i32.const
+                this->push_i32((uint32_t)module.signed_leb(pc));
+                break;
+            case 0x44: // f64.const
+            {
+                uint64_t bits;
+                std::memcpy(&bits, &binary[pc], 8);
+                pc += 8;
+                this->stack.push_back(bits);
+                break;
+            }
+            case 0xFC:
+                this->prefixed(module.unsigned_leb(pc), pc);
+                break;
+            default:
+                if (!this->numeric(opcode))
+                {
+                    throw BirdException("unsupported wasm instruction 0x" + WasmRunner::hex(opcode));
+                }
+            }
+        }
+    }
+
+    static std::string hex(int value)
+    {
+        char buffer[8];
+        std::snprintf(buffer, sizeof(buffer), "%02X", value);
+        return buffer;
+    }
+
+    uint64_t address(size_t &pc, uint64_t size)
+    {
+        this->module.unsigned_leb(pc); // alignment
+        auto offset = this->module.unsigned_leb(pc);
+        auto address = (uint64_t)this->pop_i32() + offset;
+
+        this->check_memory(address, size);
+        return address;
+    }
+
+    void load(uint8_t opcode, size_t &pc)
+    {
+        switch (opcode)
+        {
+        case 0x28:
+        {
+            uint32_t value;
+            std::memcpy(&value, &this->memory[this->address(pc, 4)], 4);
+            this->push_i32(value);
+            break;
+        }
+        case 0x2B:
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &this->memory[this->address(pc, 8)], 8);
+            this->stack.push_back(bits);
+            break;
+        }
+        case 0x2C:
+            this->push_i32((int32_t)(int8_t)this->memory[this->address(pc, 1)]);
+            break;
+        case 0x2D:
+            this->push_i32(this->memory[this->address(pc, 1)]);
+            break;
+        case 0x2E:
+        case 0x2F:
+        {
+            uint16_t value;
+            std::memcpy(&value, &this->memory[this->address(pc, 2)], 2);
+            this->push_i32(opcode == 0x2E ? (uint32_t)(int32_t)(int16_t)value : value);
+            break;
+        }
+        }
+    }
+
+    void store(uint8_t opcode, size_t &pc)
+    {
+        auto value = this->pop();
+        auto size = opcode == 0x39 ? 8 : opcode == 0x36 ? 4
+                                     : opcode == 0x3B   ? 2
+                                                        : 1;
+
+        // little endian, like wasm
+        std::memcpy(&this->memory[this->address(pc, size)], &value, size);
+    }
+
+    void prefixed(uint64_t opcode, size_t &pc)
+    {
+        switch (opcode)
+        {
+        case 0x02: // i32.trunc_sat_f64_s
+        {
+            auto value = this->pop_f64();
+            int32_t result = std::isnan(value) ? 0 : value <= -2147483648.0 ? INT32_MIN
+                                                 : value >= 2147483647.0    ? INT32_MAX
+                                                                            : (int32_t)value;
+            this->push_i32(result);
+            break;
+        }
+        case 0x03: // i32.trunc_sat_f64_u
+        {
+            auto value = this->pop_f64();
+            uint32_t result = std::isnan(value) || value <= 0 ? 0 : value >= 4294967295.0 ? UINT32_MAX
+                                                                                          : (uint32_t)value;
+            this->push_i32(result);
+            break;
+        }
+        case 0x08: // memory.init
+        {
+            auto &segment = this->module.data_segments.at(this->module.unsigned_leb(pc));
+            this->module.unsigned_leb(pc);
+            auto size = this->pop_i32();
+            auto offset = this->pop_i32();
+            auto destination = this->pop_i32();
+            if ((uint64_t)offset + size > segment.size)
+                WasmRunner::trap("out of bounds memory access");
+            this->check_memory(destination, size);
+            std::memcpy(&this->memory[destination], &this->module.binary[segment.data + offset], size);
+            break;
+        }
+        case 0x09: // data.drop
+            this->module.data_segments.at(this->module.unsigned_leb(pc)).size = 0;
+            break;
+        case 0x0A: // memory.copy
+        {
+            this->module.unsigned_leb(pc);
+            this->module.unsigned_leb(pc);
+            auto size = this->pop_i32();
+            auto source = this->pop_i32();
+            auto destination = this->pop_i32();
+            this->check_memory(source, size);
+            this->check_memory(destination, size);
+            std::memmove(&this->memory[destination], &this->memory[source], size);
+            break;
+        }
+        case 0x0B: // memory.fill
+        {
+            this->module.unsigned_leb(pc);
+            auto size = this->pop_i32();
+            auto value = this->pop_i32();
+            auto destination = this->pop_i32();
+            this->check_memory(destination, size);
+            std::memset(&this->memory[destination], (uint8_t)value, size);
+            break;
+        }
+        default:
+            throw BirdException("unsupported wasm instruction 0xFC " + WasmRunner::hex(opcode));
+        }
+    }
+
+    /*
+     * The i32 and f64 comparisons, arithmetic and conversions, false for anything else
+     */
+    bool numeric(uint8_t opcode)
+    {
+        if (opcode == 0x45) // i32.eqz
+        {
+            this->push_i32(this->pop_i32() == 0);
+            return true;
+        }
+
+        if (opcode >= 0x46 && opcode <= 0x4F)
+        {
+            auto right = this->pop_i32();
+            auto left = this->pop_i32();
+            this->push_i32(WasmRunner::compare_i32(opcode, left, right));
+            return true;
+        }
+
+        if (opcode >= 0x61 && opcode <= 0x66)
+        {
+            auto right = this->pop_f64();
+            auto left = this->pop_f64();
+            this->push_i32(WasmRunner::compare_f64(opcode, left, right));
+            return true;
+        }
+
+        if (opcode >= 0x67 && opcode <= 0x69)
+        {
+            auto value = this->pop_i32();
+            int result = opcode == 0x67   ? (value ? __builtin_clz(value) : 32)
+                         : opcode == 0x68 ? (value ? __builtin_ctz(value) : 32)
+                                          : __builtin_popcount(value);
+            this->push_i32(result);
+            return true;
+        }
+
+        if (opcode >= 0x6A && opcode <= 0x78)
+        {
+            auto right = this->pop_i32();
+            auto left = this->pop_i32();
+            this->push_i32(WasmRunner::arithmetic_i32(opcode, left, right));
+            return true;
+        }
+
+        if (opcode >= 0x99 && opcode <= 0x9F)
+        {
+            auto value = this->pop_f64();
+            this->push_f64(WasmRunner::unary_f64(opcode, value));
+            return true;
+        }
+
+        if (opcode >= 0xA0 && opcode <= 0xA6)
+        {
+            auto right = this->pop_f64();
+            auto left = this->pop_f64();
+            this->push_f64(WasmRunner::arithmetic_f64(opcode, left, right));
+            return true;
+        }
+
+        switch (opcode)
+        {
+        case 0xAA: // i32.trunc_f64_s
+        {
+            auto value = this->pop_f64();
+            if (std::isnan(value))
+                WasmRunner::trap("invalid conversion to integer");
+            if (value <= -2147483649.0 || value >= 2147483648.0)
+                WasmRunner::trap("integer overflow");
+            this->push_i32((int32_t)value);
+            return true;
+        }
+        case 0xAB: // i32.trunc_f64_u
+        {
+            auto value = this->pop_f64();
+            if (std::isnan(value))
+                WasmRunner::trap("invalid conversion to integer");
+            if (value <= -1.0 || value >= 4294967296.0)
+                WasmRunner::trap("integer overflow");
+            this->push_i32((uint32_t)value);
+            return true;
+        }
+        case 0xB7: // f64.convert_i32_s
+            this->push_f64((int32_t)this->pop_i32());
+            return true;
+        case 0xB8: // f64.convert_i32_u
+            this->push_f64(this->pop_i32());
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool compare_i32(uint8_t opcode, uint32_t left, uint32_t right)
+    {
+        auto signed_left = (int32_t)left;
+        auto signed_right = (int32_t)right;
+
+        switch (opcode)
+        {
+        case 0x46:
+            return left == right;
+        case 0x47:
+            return left != right;
+        case 0x48:
+            return signed_left < signed_right;
+        case 0x49:
+            return left < right;
+        case 0x4A:
+            return signed_left > signed_right;
+        case 0x4B:
+            return left > right;
+        case 0x4C:
+            return signed_left <= signed_right;
+        case 0x4D:
+            return left <= right;
+        case 0x4E:
+            return signed_left >= signed_right;
+        default:
+            return left >= right;
+        }
+    }
+
+    static bool compare_f64(uint8_t opcode, double left, double right)
+    {
+        switch (opcode)
+        {
+        case 0x61:
+            return left == right;
+        case 0x62:
+            return left != right;
+        case 0x63:
+            return left < right;
+        case 0x64:
+            return left > right;
+        case 0x65:
+            return left <= right;
+        default:
+            return left >= right;
+        }
+    }
+
+    static uint32_t arithmetic_i32(uint8_t opcode, uint32_t left, uint32_t right)
+    {
+        switch (opcode)
+        {
+        case 0x6A:
+            return left + right;
+        case 0x6B:
+            return left - right;
+        case 0x6C:
+            return left * right;
+        case 0x6D: // div_s
+            if (right == 0)
+                WasmRunner::trap("integer divide by zero");
+            if ((int32_t)left == INT32_MIN && (int32_t)right == -1)
+                WasmRunner::trap("integer overflow");
+            return (int32_t)left / (int32_t)right;
+        case 0x6E: // div_u
+            if (right == 0)
+                WasmRunner::trap("integer divide by zero");
+            return left / right;
+        case 0x6F: // rem_s
+            if (right == 0)
+                WasmRunner::trap("integer divide by zero");
+            if ((int32_t)right == -1)
+                return 0;
+            return (int32_t)left % (int32_t)right;
+        case 0x70: // rem_u
+            if (right == 0)
+                WasmRunner::trap("integer divide by zero");
+            return left % right;
+        case 0x71:
+            return left & right;
+        case 0x72:
+            return left | right;
+        case 0x73:
+            return left ^ right;
+        case 0x74:
+            return left << (right & 31);
+        case 0x75:
+            return (int32_t)left >> (right & 31);
+        case 0x76:
+            return left >> (right & 31);
+        case 0x77:
+            return (left << (right & 31)) | (left >> ((32 - (right & 31)) & 31));
+        default:
+            return (left >> (right & 31)) | (left << ((32 - (right & 31)) & 31));
+        }
+    }
+
+    static double unary_f64(uint8_t opcode, double value)
+    {
+        switch (opcode)
+        {
+        case 0x99:
+            return std::fabs(value);
+        case 0x9A:
+            return -value;
+        case 0x9B:
+            return std::ceil(value);
+        case 0x9C:
+            return std::floor(value);
+        case 0x9D:
+            return std::trunc(value);
+        case 0x9E:
+            return std::nearbyint(value);
+        default:
+            return std::sqrt(value);
+        }
+    }
+
+    static double arithmetic_f64(uint8_t opcode, double left, double right)
+    {
+        switch (opcode)
+        {
+        case 0xA0:
+            return left + right;
+        case 0xA1:
+            return left - right;
+        case 0xA2:
+            return left * right;
+        case 0xA3:
+            return left / right;
+        case 0xA4:
+            return std::isnan(left) || std::isnan(right) ? NAN : std::fmin(left, right);
+        case 0xA5:
+            return std::isnan(left) || std::isnan(right) ? NAN : std::fmax(left, right);
+        default:
+            return std::copysign(left, right);
+        }
+    }
+};
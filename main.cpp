@@ -2,6 +2,7 @@
 #include <fstream>
 #include <memory>
 #include <cstring>
+#include <thread>
 
 #include "lexer.h"
 #include "parser.h"
@@ -9,18 +10,46 @@
 #include "visitors/interpreter.h"
 #include "visitors/semantic_analyzer.h"
 #include "visitors/type_checker.h"
+#include "optimizer.h"
+#include "ir/ir_builder.h"
+#include "ir/ir_optimizer.h"
+#include "vm/bytecode_compiler.h"
+#include "vm/vm.h"
+#include "closure/closure_compiler.h"
 
 #include "ast_node/expr/expr.h"
 #include "exceptions/user_error_tracker.h"
 
 #include "visitors/code_gen.h"
+#include "wasm/wasm_runner.h"
 // #include "parser2.hpp" // TODO: change this name
 
 extern int bird_parse(const char *input);
 
+/*
+ * Flags passed on the command line after the mode and filename
+ */
+struct CommandLineOptions
+{
+    bool parallel_check = false; // --parallel-check
+    bool optimize = true;        // -O0 turns the optimizer off
+    bool stats = false;          // --stats prints what the optimizer changed
+    int inline_threshold = Inliner::default_inline_threshold; // --inline-threshold <nodes>
+    int step_budget = ConstEvaluator::default_step_budget;    // --step-budget <steps>
+    int specialize_budget = FunctionSpecializer::default_size_budget; // --specialize-budget <nodes>
+    bool ir = false;             // --ir compiles through the Bird IR
+    bool memoize = false;        // --memoize caches the results of pure functions in the interpreter
+    std::string engine = "tree"; // --engine=vm interprets with the bytecode vm, --engine=closure with compiled closures
+    bool jit = false;            // --jit compiles hot functions to machine code in the interpreter
+    bool run = false;            // --run runs the generated wasm module in process instead of writing output.wasm
+    bool profile = false;        // --profile reports the time per function and the executions per line in the interpreter
+};
+
 void repl();
-void compile(std::string filename);
-void interpret(std::string filename);
+void compile(std::string filename, CommandLineOptions options);
+void interpret(std::string filename, CommandLineOptions options);
+void check_types(TypeChecker &type_checker, std::vector<std::unique_ptr<Stmt>> *ast, CommandLineOptions options);
+void run_wasm(CodeGen &codegen, CommandLineOptions options);
 std::string read_file(std::string filename);
 
 int main(int argc, char *argv[])
@@ -28,24 +57,82 @@ int main(int argc, char *argv[])
     if (argc == 1)
     {
         repl();
+        return 0;
     }
-    else if (argc == 2)
-    {
-        std::string filename = argv[1];
-        compile(filename);
-    }
-    else
+
+    std::string filename;
+    bool interpret_mode = false;
+    CommandLineOptions options;
+
+    for (int i = 1; i < argc; i++)
     {
-        if (!strcmp(argv[1], "-i"))
+        if (!strcmp(argv[i], "-i"))
+        {
+            interpret_mode = true;
+        }
+        else if (!strcmp(argv[i], "--parallel-check"))
+        {
+            options.parallel_check = true;
+        }
+        else if (!strcmp(argv[i], "-O0"))
+        {
+            options.optimize = false;
+        }
+        else if (!strcmp(argv[i], "--stats"))
+        {
+            options.stats = true;
+        }
+        else if (!strcmp(argv[i], "--memoize"))
+        {
+            options.memoize = true;
+        }
+        else if (!strcmp(argv[i], "--profile"))
+        {
+            options.profile = true;
+        }
+        else if (!strcmp(argv[i], "--run"))
+        {
+            options.run = true;
+        }
+        else if (!strcmp(argv[i], "--jit"))
+        {
+            options.jit = true;
+        }
+        else if (!strcmp(argv[i], "--ir"))
+        {
+            options.ir = true;
+        }
+        else if (!strncmp(argv[i], "--engine=", strlen("--engine=")))
+        {
+            options.engine = argv[i] + strlen("--engine=");
+        }
+        else if (!strcmp(argv[i], "--inline-threshold") && i + 1 < argc)
+        {
+            options.inline_threshold = std::stoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--step-budget") && i + 1 < argc)
         {
-            interpret(std::string(argv[2]));
+            options.step_budget = std::stoi(argv[++i]);
         }
-        else if (!strcmp(argv[2], "-i"))
+        else if (!strcmp(argv[i], "--specialize-budget") && i + 1 < argc)
         {
-            interpret(std::string(argv[1]));
+            options.specialize_budget = std::stoi(argv[++i]);
+        }
+        else
+        {
+            filename = argv[i];
         }
     }
 
+    if (interpret_mode)
+    {
+        interpret(filename, options);
+    }
+    else
+    {
+        compile(filename, options);
+    }
+
     return 0;
 }
 
@@ -110,7 +197,7 @@ void repl()
     }
 }
 
-void compile(std::string filename)
+void compile(std::string filename, CommandLineOptions options)
 {
     auto code = read_file(filename);
     UserErrorTracker error_tracker(code);
@@ -144,18 +231,75 @@ void compile(std::string filename)
     }
 
     TypeChecker type_checker(&error_tracker);
-    type_checker.check_types(&ast);
+    check_types(type_checker, &ast, options);
 
     if (error_tracker.has_errors())
     {
         error_tracker.print_errors_and_exit();
     }
 
+    if (options.optimize)
+    {
+        Optimizer optimizer(options.inline_threshold, options.step_budget, options.specialize_budget);
+        optimizer.optimize(&ast);
+
+        if (options.stats)
+        {
+            optimizer.print_stats();
+        }
+    }
+
     CodeGen codegen;
+    codegen.write_file = !options.run;
+
+    if (options.ir)
+    {
+        IrBuilder ir_builder;
+        if (ir_builder.build(&ast))
+        {
+            IrOptimizer ir_optimizer;
+            if (options.optimize)
+            {
+                ir_optimizer.optimize(&ir_builder.module);
+
+                if (options.stats)
+                {
+                    ir_optimizer.print_stats();
+                }
+            }
+
+            codegen.generate(&ir_builder.module);
+            run_wasm(codegen, options);
+            return;
+        }
+
+        std::cerr << "cannot compile through the IR, " << ir_builder.unsupported << std::endl;
+    }
+
     codegen.generate(&ast);
+    run_wasm(codegen, options);
 }
 
-void interpret(std::string filename)
+void run_wasm(CodeGen &codegen, CommandLineOptions options)
+{
+    // a module that failed to serialize was reported already
+    if (!options.run || codegen.binary.empty())
+    {
+        return;
+    }
+
+    try
+    {
+        WasmRunner runner(codegen.binary);
+        runner.run();
+    }
+    catch (BirdException e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+}
+
+void interpret(std::string filename, CommandLineOptions options)
 {
     auto code = read_file(filename);
     UserErrorTracker error_tracker(code);
@@ -189,15 +333,91 @@ void interpret(std::string filename)
     }
 
     TypeChecker type_checker(&error_tracker);
-    type_checker.check_types(&ast);
+    check_types(type_checker, &ast, options);
 
     if (error_tracker.has_errors())
     {
         error_tracker.print_errors_and_exit();
     }
 
+    if (options.optimize)
+    {
+        Optimizer optimizer(options.inline_threshold, options.step_budget, options.specialize_budget);
+        optimizer.optimize(&ast);
+
+        if (options.stats)
+        {
+            optimizer.print_stats();
+        }
+    }
+
+    if (options.engine == "vm")
+    {
+        BytecodeCompiler bytecode_compiler;
+        if (bytecode_compiler.compile(&ast))
+        {
+            Vm vm;
+            try
+            {
+                vm.run(&bytecode_compiler.program);
+            }
+            catch (BirdException e)
+            {
+                std::cout << e.what() << std::endl;
+            }
+            catch (std::exception e)
+            {
+                std::cout << "err" << std::endl;
+            }
+
+            return;
+        }
+
+        std::cerr << "cannot run on the vm, " << bytecode_compiler.unsupported << std::endl;
+    }
+
+    if (options.engine == "closure")
+    {
+        ClosureCompiler closure_compiler;
+        if (closure_compiler.compile(&ast))
+        {
+            ClosureRuntime runtime;
+            try
+            {
+                runtime.run(&closure_compiler.program);
+            }
+            catch (BirdException e)
+            {
+                std::cout << e.what() << std::endl;
+            }
+            catch (std::exception e)
+            {
+                std::cout << "err" << std::endl;
+            }
+
+            return;
+        }
+
+        std::cerr << "cannot run with closures, " << closure_compiler.unsupported << std::endl;
+    }
+
     Interpreter interpreter;
 
+    if (options.memoize)
+    {
+        EffectAnalyzer effects;
+        effects.analyze_effects(&ast);
+        interpreter.memoize = true;
+    }
+
+    interpreter.jit = options.jit;
+
+    Profiler profiler;
+    if (options.profile)
+    {
+        interpreter.profiler = &profiler;
+    }
+
     try
     {
         interpreter.evaluate(&ast);
@@ -210,6 +430,33 @@ void interpret(std::string filename)
     {
         std::cout << "err" << std::endl;
     }
+
+    if (options.profile)
+    {
+        profiler.finish();
+        profiler.report(std::cerr);
+
+        std::ofstream collapsed("profile.folded");
+        profiler.write_collapsed(collapsed);
+        std::cerr << "collapsed stacks written to profile.folded" << std::endl;
+    }
+
+    if (options.memoize && options.stats)
+    {
+        interpreter.print_memo_stats();
+    }
+}
+
+void check_types(TypeChecker &type_checker, std::vector<std::unique_ptr<Stmt>> *ast, CommandLineOptions options)
+{
+    if (options.parallel_check)
+    {
+        type_checker.check_types_parallel(ast, std::thread::hardware_concurrency());
+    }
+    else
+    {
+        type_checker.check_types(ast);
+    }
 }
 
 std::string read_file(std::string filename)
@@ -3,54 +3,140 @@
 #include "sym_table.h"
 #include "value.h"
 #include "exceptions/bird_exception.h"
+#include "jit/jit_compiler.h"
 
-void Callable::call(Interpreter *interpreter, std::vector<std::shared_ptr<Expr>> args)
+/*
+ * Times a call while it is in scope, when the interpreter is profiling
+ */
+struct ProfiledCall
+{
+    Profiler *profiler;
+
+    ProfiledCall(Profiler *profiler, const std::string &name) : profiler(profiler)
+    {
+        if (this->profiler)
+            this->profiler->enter(name);
+    }
+
+    ~ProfiledCall()
+    {
+        if (this->profiler)
+            this->profiler->exit();
+    }
+};
+
+void Callable::call(Interpreter *interpreter, const std::vector<std::shared_ptr<Expr>> &args, bool arguments_checked)
 {
-    // create new scope
     if (args.size() != this->param_list.size())
     {
         throw BirdException("Mismatched arguments, expected: " + std::to_string(param_list.size()) + ", found: " + std::to_string(args.size()));
     }
 
-    std::vector<Value> evaluated_args;
-    for (auto &arg : args)
+    // the arguments go straight into the slots of the new frame, calls made while evaluating them get frames above it
+    auto base = interpreter->push_frame(std::max(this->frame_size, (int)args.size()));
+    for (int i = 0; i < args.size(); i++)
+    {
+        args[i]->accept(interpreter);
+        interpreter->frames[base + i] = interpreter->stack.pop();
+    }
+
+    auto evaluated_args = &interpreter->frames[base];
+
+    // the call is timed once its arguments are evaluated, until it returns or throws
+    ProfiledCall profiled(interpreter->profiler, this->name);
+
+    std::vector<uint64_t> key;
+    bool cacheable = this->memo && MemoCache::is_cacheable(evaluated_args, args.size());
+    if (cacheable)
     {
-        arg->accept(interpreter);
-        auto value = interpreter->stack.pop();
-        evaluated_args.push_back(value);
+        key = MemoCache::key(evaluated_args, args.size());
+        auto cached = this->memo->get(key);
+        if (cached.has_value())
+        {
+            interpreter->stack.push(cached.value());
+            interpreter->pop_frame(base);
+            return;
+        }
     }
 
-    interpreter->env.push_env();
+    interpreter->step();
 
-    for (int i = 0; i < this->param_list.size(); i++)
+    if (interpreter->jit && !this->native && !this->jit_failed && this->hotness >= interpreter->jit_threshold)
     {
-        if (param_list[i].second.lexeme == "int" && !is_type<int>(evaluated_args[i]))
-            throw BirdException("Type mismatch");
+        JitCompiler compiler(&interpreter->call_table);
+        compiler.compile(this);
+    }
 
-        if (param_list[i].second.lexeme == "str" && !is_type<std::string>(evaluated_args[i]))
-            throw BirdException("Type mismatch");
+    if (this->native && this->native_arguments(evaluated_args, args.size()))
+    {
+        auto result = this->native->run(evaluated_args, args.size(), this->resolved_return_type);
+        interpreter->pop_frame(base);
+        interpreter->stack.push(result);
+        return;
+    }
 
-        if (param_list[i].second.lexeme == "bool" && !is_type<bool>(evaluated_args[i]))
-            throw BirdException("Type mismatch");
+    // the type checker proved the argument types of most calls already
+    if (!arguments_checked)
+    {
+        for (int i = 0; i < this->param_types.size(); i++)
+        {
+            if (this->param_types[i] != BirdType::ERROR && evaluated_args[i].index() != (int)this->param_types[i])
+                throw BirdException("Type mismatch");
+        }
+    }
 
-        if (param_list[i].second.lexeme == "float" && !is_type<double>(evaluated_args[i]))
-            throw BirdException("Type mismatch");
+    auto stack_size = interpreter->stack.stack.size();
+    auto ticks = interpreter->ticks;
+    auto caller_base = interpreter->frame_base;
+    interpreter->frame_base = base;
 
-        interpreter->env.declare(param_list[i].first.lexeme, evaluated_args[i]);
+    if (this->frame_size < 0)
+    {
+        interpreter->env.push_env();
+        for (int i = 0; i < this->param_list.size(); i++)
+        {
+            interpreter->env.declare(param_list[i].first.lexeme, evaluated_args[i]);
+        }
     }
 
     for (auto &stmt : dynamic_cast<Block *>(this->block.get())->stmts)
     {
-        try
+        if (interpreter->profiler)
         {
-            stmt->accept(interpreter);
+            interpreter->profiler->line(stmt.get());
         }
-        catch (ReturnException e)
+
+        stmt->accept(interpreter);
+
+        if (interpreter->completion == Completion::RETURN)
         {
-            interpreter->env.pop_env();
-            return;
+            interpreter->completion = Completion::NORMAL;
+            break;
         }
     }
 
-    interpreter->env.pop_env();
-}
\ No newline at end of file
+    if (this->frame_size < 0)
+    {
+        interpreter->env.pop_env();
+    }
+
+    interpreter->frame_base = caller_base;
+    interpreter->pop_frame(base);
+    this->hotness += 1 + interpreter->ticks - ticks;
+
+    if (cacheable && interpreter->stack.stack.size() == stack_size + 1)
+    {
+        this->memo->put(key, interpreter->stack.stack.back());
+    }
+}
+
+bool Callable::native_arguments(const Value *args, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (args[i].index() != (int)this->param_types[i])
+            return false;
+    }
+
+    return true;
+}
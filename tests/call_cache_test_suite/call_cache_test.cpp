@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+std::vector<std::unique_ptr<Stmt>> parse_code(std::string code, UserErrorTracker &error_tracker)
+{
+    Lexer lexer(code, &error_tracker);
+    auto tokens = lexer.lex();
+
+    Parser parser(tokens, &error_tracker);
+    return parser.parse();
+}
+
+Call *call_at(std::vector<std::unique_ptr<Stmt>> &ast, int index)
+{
+    return dynamic_cast<Call *>(dynamic_cast<ExprStmt *>(ast[index].get())->expr.get());
+}
+
+TEST(CallCacheTest, CallsCacheTheirCallee)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_code("fn one() -> int { return 1; }"
+                          "one();",
+                          error_tracker);
+
+    Interpreter interpreter;
+    interpreter.evaluate(&ast);
+
+    auto call = call_at(ast, 1);
+    EXPECT_EQ(call->callee, &interpreter.call_table.get_reference("one"));
+    EXPECT_EQ(call->callee_version, interpreter.call_table_version);
+}
+
+TEST(CallCacheTest, DeclaringAFunctionInvalidatesTheCache)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_code("fn one() -> int { return 1; }"
+                          "fn count() -> int { return one(); }"
+                          "var first = count();",
+                          error_tracker);
+
+    Interpreter interpreter;
+    interpreter.evaluate(&ast);
+
+    auto body = dynamic_cast<Block *>(dynamic_cast<Func *>(ast[1].get())->block.get());
+    auto call = dynamic_cast<Call *>(dynamic_cast<ReturnStmt *>(body->stmts[0].get())->expr.value().get());
+    auto version = call->callee_version;
+    EXPECT_EQ(version, interpreter.call_table_version);
+
+    auto rest = parse_code("fn two() -> int { return 2; }"
+                           "var second = count();",
+                           error_tracker);
+    interpreter.evaluate(&rest);
+
+    EXPECT_NE(call->callee_version, version);
+    EXPECT_EQ(call->callee_version, interpreter.call_table_version);
+    EXPECT_EQ(call->callee, &interpreter.call_table.get_reference("one"));
+    EXPECT_EQ(as_type<int>(interpreter.env.get("second")), 1);
+}
+
+TEST(CallCacheTest, InterpretersDoNotShareCaches)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_code("fn one() -> int { return 1; }"
+                          "one();",
+                          error_tracker);
+
+    Interpreter first;
+    first.evaluate(&ast);
+
+    Interpreter second;
+    second.evaluate(&ast);
+
+    EXPECT_NE(first.call_table_version, second.call_table_version);
+    EXPECT_EQ(call_at(ast, 1)->callee, &second.call_table.get_reference("one"));
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+std::vector<std::unique_ptr<Stmt>> resolve_slots(std::string code, SlotResolver &resolver)
+{
+    UserErrorTracker error_tracker(code);
+    Lexer lexer(code, &error_tracker);
+    auto tokens = lexer.lex();
+
+    Parser parser(tokens, &error_tracker);
+    auto ast = parser.parse();
+    resolver.resolve(&ast);
+
+    return ast;
+}
+
+TEST(CallFrameTest, LocalsReuseTheSlotsOfClosedBlocks)
+{
+    SlotResolver resolver;
+    auto ast = resolve_slots("var g = 1;"
+                             "fn f(a: int, b: int) -> int"
+                             "{"
+                             "    var c = a + b;"
+                             "    {"
+                             "        var d = c;"
+                             "    }"
+                             "    var e = g;"
+                             "    return c + e;"
+                             "}",
+                             resolver);
+
+    EXPECT_EQ(resolver.resolved_functions, 1);
+    EXPECT_EQ(dynamic_cast<DeclStmt *>(ast[0].get())->slot, -1);
+
+    auto func = dynamic_cast<Func *>(ast[1].get());
+    EXPECT_EQ(func->frame_size, 4);
+
+    auto &body = dynamic_cast<Block *>(func->block.get())->stmts;
+    EXPECT_EQ(dynamic_cast<DeclStmt *>(body[0].get())->slot, 2);
+    EXPECT_EQ(dynamic_cast<DeclStmt *>(dynamic_cast<Block *>(body[1].get())->stmts[0].get())->slot, 3);
+
+    auto e = dynamic_cast<DeclStmt *>(body[2].get());
+    EXPECT_EQ(e->slot, 3);
+    EXPECT_EQ(dynamic_cast<Primary *>(e->value.get())->slot, -1); // g is a global
+}
+
+TEST(CallFrameTest, FunctionsDefiningFunctionsUseNames)
+{
+    SlotResolver resolver;
+    auto ast = resolve_slots("fn outer(x: int) -> int"
+                             "{"
+                             "    fn inner(y: int) -> int { return x + y; }"
+                             "    return inner(1);"
+                             "}",
+                             resolver);
+
+    auto outer = dynamic_cast<Func *>(ast[0].get());
+    EXPECT_EQ(outer->frame_size, -1);
+
+    auto inner = dynamic_cast<Func *>(dynamic_cast<Block *>(outer->block.get())->stmts[0].get());
+    EXPECT_EQ(inner->frame_size, 1);
+    EXPECT_EQ(resolver.resolved_functions, 1);
+}
+
+TEST(CallFrameTest, DeepRecursionGrowsTheFrames)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn depth(n: int) -> int"
+                   "{"
+                   "    if n == 0 { return 0; }"
+                   "    var below = depth(n - 1);"
+                   "    return below + 1;"
+                   "}"
+                   "fn outer(x: int) -> int"
+                   "{"
+                   "    fn inner(y: int) -> int { return x + y; }"
+                   "    return inner(1);"
+                   "}"
+                   "var result = depth(1500);"
+                   "var sum = outer(41);"
+                   "print result, sum;";
+    options.compile = false;
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("result")), 1500);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("sum")), 42);
+        EXPECT_GE(interpreter.frames.size(), 3000);
+        EXPECT_EQ(interpreter.frame_top, 0);
+        EXPECT_EQ(interpreter.frame_base, 0);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
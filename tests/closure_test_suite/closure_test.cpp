@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+std::vector<std::unique_ptr<Stmt>> parse_for_closures(std::string code, UserErrorTracker &error_tracker)
+{
+    Lexer lexer(code, &error_tracker);
+    auto tokens = lexer.lex();
+
+    Parser parser(tokens, &error_tracker);
+    return parser.parse();
+}
+
+TEST(ClosureTest, FunctionsReadAndWriteGlobals)
+{
+    BirdTest::TestOptions options;
+    options.code = "var calls = 0;"
+                   "fn fib(n: int) -> int"
+                   "{"
+                   "    calls += 1;"
+                   "    if n < 2 { return n; }"
+                   "    return fib(n - 1) + fib(n - 2);"
+                   "}"
+                   "print fib(15);"
+                   "print calls;";
+
+    options.after_closure = [&](std::string &output, ClosureRuntime &runtime)
+    {
+        EXPECT_EQ(output, "610\n1973\n");
+        EXPECT_EQ(as_type<int>(runtime.slots[0]), 1973);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ClosureTest, LoopsBreakContinueAndReturn)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn first_square_above(limit: int) -> int"
+                   "{"
+                   "    for var i = 0; i < 100; i += 1 do {"
+                   "        if i * i > limit { return i; }"
+                   "    }"
+                   "    return -1;"
+                   "}"
+                   "var total = 0;"
+                   "for var i = 0; i < 100; i += 1 do {"
+                   "    if i % 2 == 0 { continue; }"
+                   "    if i > 9 { break; }"
+                   "    var j = 0;"
+                   "    while j < i { j += 1; total += j; }"
+                   "}"
+                   "print total, first_square_above(50);";
+
+    options.after_closure = [&](std::string &output, ClosureRuntime &runtime)
+    {
+        EXPECT_EQ(output, "958\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ClosureTest, OperandsAreReadBeforeTheRightSideRuns)
+{
+    BirdTest::TestOptions options;
+    options.code = "var x = 1;"
+                   "fn bump() -> int { x = 10; return 2; }"
+                   "var sum = x + bump();"
+                   "var text = \"bi\";"
+                   "text += \"rd\";"
+                   "print sum, x, text;";
+
+    options.after_closure = [&](std::string &output, ClosureRuntime &runtime)
+    {
+        EXPECT_EQ(output, "310bird\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ClosureTest, ArgumentOfTheWrongTypeThrows)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_for_closures("fn twice(n: int) -> int { return n * 2; }"
+                                  "print twice(1.5);",
+                                  error_tracker);
+
+    ClosureCompiler compiler;
+    ASSERT_TRUE(compiler.compile(&ast));
+
+    ClosureRuntime runtime;
+    EXPECT_THROW(runtime.run(&compiler.program), BirdException);
+}
+
+TEST(ClosureTest, OuterFunctionVariablesAreUnsupported)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_for_closures("fn outer() -> int"
+                                  "{"
+                                  "    var x = 1;"
+                                  "    fn inner() -> int { return x; }"
+                                  "    return inner();"
+                                  "}"
+                                  "print outer();",
+                                  error_tracker);
+
+    ClosureCompiler compiler;
+    EXPECT_FALSE(compiler.compile(&ast));
+    EXPECT_EQ(compiler.unsupported, "inner uses x of the function it is nested in");
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+ConstStmt *find_const(std::vector<std::unique_ptr<Stmt>> &ast, std::string name)
+{
+    for (auto &stmt : ast)
+    {
+        auto const_stmt = dynamic_cast<ConstStmt *>(stmt.get());
+        if (const_stmt && const_stmt->identifier.lexeme == name)
+        {
+            return const_stmt;
+        }
+    }
+
+    return nullptr;
+}
+
+TEST(ConstEvaluatorTest, EvaluatePureCallInConstInitializer)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn compute_size(n: int) -> int"
+                   "{"
+                   "var size = 1;"
+                   "for var i = 0; i < n; i += 1 do { size *= 2; }"
+                   "return size;"
+                   "}"
+                   "const table_size = compute_size(10);"
+                   "var x = table_size - 1;"
+                   "print x;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.const_evaluator.evaluated_constants, 1);
+
+        // the constant propagates into the declaration that uses it
+        auto decl_stmt = dynamic_cast<DeclStmt *>(ast[ast.size() - 2].get());
+        ASSERT_NE(decl_stmt, nullptr);
+        auto value = dynamic_cast<Primary *>(decl_stmt->value.get());
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(value->value.lexeme, "1023");
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 1023);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "1023\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ConstEvaluatorTest, EvaluateConstantsBuiltFromConstants)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn twice(n: int) -> int { return n * 2; }"
+                   "fn add(a: int, b: int) -> int { return a + b; }"
+                   "const a = twice(4);"
+                   "const b = add(twice(a), 1);"
+                   "print a;"
+                   "print b;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.const_evaluator.evaluated_constants, 2);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("a")), 8);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("b")), 17);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "8\n17\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ConstEvaluatorTest, StepBudgetLeavesCallForRuntime)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn count(n: int) -> int"
+                   "{"
+                   "var i = 0;"
+                   "while i < n { i += 1; }"
+                   "return i;"
+                   "}"
+                   "const small = count(10);"
+                   "const large = count(20000);"
+                   "print small;"
+                   "print large;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.const_evaluator.evaluated_constants, 1);
+        EXPECT_EQ(optimizer.const_evaluator.exhausted_budgets, 1);
+
+        auto large = find_const(ast, "large");
+        ASSERT_NE(large, nullptr);
+        EXPECT_NE(dynamic_cast<Call *>(large->value.get()), nullptr);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("small")), 10);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("large")), 20000);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "10\n20000\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ConstEvaluatorTest, ImpureAndFailingCallsAreNotEvaluated)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn loud(n: int) -> int { print n; return n; }"
+                   "fn divide(n: int, d: int) -> int { return n / d; }"
+                   "const a = loud(1);"
+                   "const b = divide(1, 0);";
+    options.optimize = true;
+    options.interpret = false;
+    options.compile = false;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.const_evaluator.evaluated_constants, 0);
+
+        auto a = find_const(ast, "a");
+        ASSERT_NE(a, nullptr);
+        EXPECT_NE(dynamic_cast<Call *>(a->value.get()), nullptr);
+
+        // the division by zero is left for the runtime to report
+        auto b = find_const(ast, "b");
+        ASSERT_NE(b, nullptr);
+        EXPECT_EQ(dynamic_cast<Primary *>(b->value.get()), nullptr);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+Primary *decl_value(std::vector<std::unique_ptr<Stmt>> &ast, int index)
+{
+    auto decl_stmt = dynamic_cast<DeclStmt *>(ast[index].get());
+    return decl_stmt ? dynamic_cast<Primary *>(decl_stmt->value.get()) : nullptr;
+}
+
+TEST(ConstantFoldingTest, FoldIntArithmetic)
+{
+    BirdTest::TestOptions options;
+    options.code = "var x = 60 * 60 * 24;"
+                   "print x;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        auto value = decl_value(ast, 0);
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(value->value.token_type, Token::Type::INT_LITERAL);
+        EXPECT_EQ(value->value.lexeme, "86400");
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        ASSERT_TRUE(is_type<int>(interpreter.env.get("x")));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 86400);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "86400\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ConstantFoldingTest, FoldFollowsFloatPromotion)
+{
+    BirdTest::TestOptions options;
+    options.code = "var x = 1 + 2.5 * 2;"
+                   "print x;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        auto value = decl_value(ast, 0);
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(value->value.token_type, Token::Type::FLOAT_LITERAL);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        ASSERT_TRUE(is_type<double>(interpreter.env.get("x")));
+        EXPECT_EQ(as_type<double>(interpreter.env.get("x")), 6.0);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "6\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ConstantFoldingTest, PropagateConst)
+{
+    BirdTest::TestOptions options;
+    options.code = "const k = 3;"
+                   "var x = k * 2;"
+                   "print x;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        auto value = decl_value(ast, 1);
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(value->value.token_type, Token::Type::INT_LITERAL);
+        EXPECT_EQ(value->value.lexeme, "6");
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        ASSERT_TRUE(is_type<int>(interpreter.env.get("x")));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 6);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "6\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ConstantFoldingTest, FoldTernaryAndComparison)
+{
+    BirdTest::TestOptions options;
+    options.code = "const limit = 10;"
+                   "var x = limit >= 5 ? limit - 5 : limit + 5;"
+                   "var y = 2 == 2.0;"
+                   "print x;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        auto x = decl_value(ast, 1);
+        ASSERT_NE(x, nullptr);
+        EXPECT_EQ(x->value.lexeme, "5");
+
+        auto y = decl_value(ast, 2);
+        ASSERT_NE(y, nullptr);
+        EXPECT_EQ(y->value.token_type, Token::Type::BOOL_LITERAL);
+        EXPECT_EQ(y->value.lexeme, "true");
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 5);
+        ASSERT_TRUE(interpreter.env.contains("y"));
+        EXPECT_EQ(as_type<bool>(interpreter.env.get("y")), true);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "5\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ConstantFoldingTest, DivisionByZeroIsNotFolded)
+{
+    BirdTest::TestOptions options;
+    options.code = "var x: int = 10 / (5 - 5);";
+    options.optimize = true;
+    options.compile = false;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        auto decl_stmt = dynamic_cast<DeclStmt *>(ast[0].get());
+        ASSERT_NE(decl_stmt, nullptr);
+
+        auto binary = dynamic_cast<Binary *>(decl_stmt->value.get());
+        ASSERT_NE(binary, nullptr);
+        EXPECT_EQ(dynamic_cast<Primary *>(binary->right.get())->value.lexeme, "0");
+    };
+
+    ASSERT_THROW(BirdTest::compile(options), BirdException);
+}
+
+TEST(ConstantFoldingTest, ShadowedConstIsNotPropagated)
+{
+    BirdTest::TestOptions options;
+    options.code = "const n = 2;"
+                   "fn double(n: int) -> int { return n * 2; }"
+                   "var x = double(5);"
+                   "var y = 0;"
+                   "{ var n = 7; y = n + n; }"
+                   "print x;"
+                   "print y;";
+    options.optimize = true;
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 10);
+        ASSERT_TRUE(interpreter.env.contains("y"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("y")), 14);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "10\n14\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+TEST(CseTest, ReuseRepeatedExpression)
+{
+    BirdTest::TestOptions options;
+    options.code = "var a = 2;"
+                   "var b = 3;"
+                   "var c = 4;"
+                   "var x = (a * b + c) * (a * b + c);"
+                   "var y = c + b * a;"
+                   "print x;"
+                   "print y;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        // a * b + c is reused in x, then a * b is reused by y
+        EXPECT_EQ(optimizer.common_subexpression_eliminator.temporaries, 2);
+        EXPECT_EQ(optimizer.common_subexpression_eliminator.eliminated_expressions, 2);
+
+        auto product = dynamic_cast<DeclStmt *>(ast[3].get());
+        ASSERT_NE(product, nullptr);
+        EXPECT_EQ(product->identifier.lexeme, "cse$1");
+
+        auto sum = dynamic_cast<DeclStmt *>(ast[4].get());
+        ASSERT_NE(sum, nullptr);
+        EXPECT_EQ(sum->identifier.lexeme, "cse$0");
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 100);
+        ASSERT_TRUE(interpreter.env.contains("y"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("y")), 10);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "100\n10\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(CseTest, CommutativeOperandsMatch)
+{
+    BirdTest::TestOptions options;
+    options.code = "var a = 6;"
+                   "var b = 7;"
+                   "var p = a * b;"
+                   "var q = b * a;"
+                   "print p;"
+                   "print q;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.common_subexpression_eliminator.eliminated_expressions, 1);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("q"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("q")), 42);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "42\n42\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(CseTest, AssignmentsAndCallsEndReuse)
+{
+    BirdTest::TestOptions options;
+    options.code = "var a = 2;"
+                   "var b = 3;"
+                   "fn bump() -> int { b += 1; return 0; }"
+                   "var x = a * b;"
+                   "a = 5;"
+                   "var y = a * b;"
+                   "var z = a * b + bump();"
+                   "var w = a * b;"
+                   "print x;"
+                   "print y;"
+                   "print z;"
+                   "print w;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        // only y and z read the same a and b
+        EXPECT_EQ(optimizer.common_subexpression_eliminator.eliminated_expressions, 1);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 6);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("y")), 15);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("z")), 15);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("w")), 20);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "6\n15\n15\n20\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(CseTest, ReuseInFunctionBody)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn f(a: int, b: int) -> int {"
+                   "    var s = a + b;"
+                   "    if a + b > 10 { return (a + b) * s; }"
+                   "    return a + b;"
+                   "}"
+                   "var x = f(3, 9);"
+                   "var y = f(1, 2);"
+                   "print x;"
+                   "print y;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        // the branches are separate basic blocks
+        EXPECT_EQ(optimizer.common_subexpression_eliminator.eliminated_expressions, 1);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 144);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("y")), 3);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "144\n3\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+TEST(DeadCodeTest, RemoveConstantBranch)
+{
+    BirdTest::TestOptions options;
+    options.code = "const debug = false;"
+                   "var x = 0;"
+                   "if debug { x = 1; print 100; } else { x = 2; }"
+                   "while debug { print 200; }"
+                   "print x;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.dead_code_eliminator.removed_branches, 2);
+        ASSERT_EQ(ast.size(), 4);
+        EXPECT_NE(dynamic_cast<Block *>(ast[2].get()), nullptr);
+        EXPECT_NE(dynamic_cast<PrintStmt *>(ast[3].get()), nullptr);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 2);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "2\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(DeadCodeTest, RemoveCodeAfterReturnAndBreak)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn first() -> int { return 1; print 2; print 3; }"
+                   "var x = first();"
+                   "while true { x += 1; break; print x; }"
+                   "print x;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.dead_code_eliminator.removed_unreachable, 3);
+
+        auto func = dynamic_cast<Func *>(ast[0].get());
+        ASSERT_NE(func, nullptr);
+        EXPECT_EQ(dynamic_cast<Block *>(func->block.get())->stmts.size(), 1);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 2);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "2\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(DeadCodeTest, RemoveUnusedLocals)
+{
+    BirdTest::TestOptions options;
+    options.code = "var calls = 0;"
+                   "fn count() -> int { calls += 1; return calls; }"
+                   "fn f(a: int) -> int {"
+                   "    var unused = a * 2;"
+                   "    const scale = 3;"
+                   "    var kept = count();"
+                   "    var used = a + 1;"
+                   "    return used;"
+                   "}"
+                   "var x = f(1);"
+                   "print x;";
+    options.optimize = true;
+    options.specialize_budget = 0; // keeps f instead of a clone for f(1)
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.dead_code_eliminator.removed_declarations, 2);
+
+        auto func = dynamic_cast<Func *>(ast[2].get());
+        ASSERT_NE(func, nullptr);
+        EXPECT_EQ(dynamic_cast<Block *>(func->block.get())->stmts.size(), 3);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 2);
+        ASSERT_TRUE(interpreter.env.contains("calls"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("calls")), 1);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "2\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(DeadCodeTest, RemoveUncalledFunctions)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn helper() -> int { return 2; }"
+                   "fn used() -> int { return helper(); }"
+                   "fn only_from_unused() -> int { return 3; }"
+                   "fn unused() -> int { return only_from_unused(); }"
+                   "var x = used();"
+                   "print x;";
+    options.optimize = true;
+    options.inline_threshold = 0;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.dead_code_eliminator.removed_functions, 2);
+        ASSERT_EQ(ast.size(), 4);
+        EXPECT_EQ(dynamic_cast<Func *>(ast[0].get())->identifier.lexeme, "helper");
+        EXPECT_EQ(dynamic_cast<Func *>(ast[1].get())->identifier.lexeme, "used");
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 2);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "2\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
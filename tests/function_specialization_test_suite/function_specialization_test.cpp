@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+Func *find_func(std::vector<std::unique_ptr<Stmt>> &ast, std::string name)
+{
+    for (auto &stmt : ast)
+    {
+        auto func = dynamic_cast<Func *>(stmt.get());
+        if (func && func->identifier.lexeme == name)
+        {
+            return func;
+        }
+    }
+
+    return nullptr;
+}
+
+TEST(FunctionSpecializationTest, CallsWithTheSameLiteralsShareAClone)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn scale(x: int, factor: int, negate: bool) -> int"
+                   "{"
+                   "var result = x * factor;"
+                   "if negate { result = -result; }"
+                   "return result;"
+                   "}"
+                   "var v = 3;"
+                   "var a = scale(v, 4, true);"
+                   "var b = scale(v + 2, 4, true);"
+                   "var c = scale(v, 3, false);"
+                   "print a;"
+                   "print b;"
+                   "print c;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.function_specializer.specialized_calls, 3);
+        EXPECT_EQ(optimizer.function_specializer.clones, 2);
+
+        auto clone = find_func(ast, "scale$0");
+        ASSERT_NE(clone, nullptr);
+        ASSERT_EQ(clone->param_list.size(), 1);
+        EXPECT_EQ(clone->param_list[0].first.lexeme, "x");
+
+        // every call was specialized, so the original is removed
+        EXPECT_EQ(find_func(ast, "scale"), nullptr);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("a")), -12);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("b")), -20);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("c")), 9);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "-12\n-20\n9\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(FunctionSpecializationTest, RecursiveCallsUseTheirOwnClone)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn power(base: int, exponent: int) -> int"
+                   "{"
+                   "if exponent == 0 { return 1; }"
+                   "return base * power(base, exponent - 1);"
+                   "}"
+                   "var x = 5;"
+                   "var result = power(2, x);"
+                   "print result;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.function_specializer.clones, 1);
+        EXPECT_EQ(optimizer.function_specializer.specialized_calls, 2);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("result")), 32);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "32\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(FunctionSpecializationTest, ClonesStayWithinSizeBudget)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn half(x: float, round: bool) -> float"
+                   "{"
+                   "var result = x / 2.0;"
+                   "if round { return 1.0; }"
+                   "return result;"
+                   "}"
+                   "var y = 3.0;"
+                   "var a = half(y, false);";
+    options.optimize = true;
+    options.specialize_budget = 4;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.function_specializer.clones, 0);
+        EXPECT_EQ(optimizer.function_specializer.specialized_calls, 0);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<double>(interpreter.env.get("a")), 1.5);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(FunctionSpecializationTest, LiteralsOfAnotherTypeAreNotConstant)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn half(x: float) -> float"
+                   "{"
+                   "var result = x / 2.0;"
+                   "return result;"
+                   "}"
+                   "var a = half(4);";
+    options.optimize = true;
+    options.interpret = false;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.function_specializer.clones, 0);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
@@ -66,3 +66,58 @@ TEST(FunctionTest, FunctionWrongReturnType)
 
     ASSERT_FALSE(BirdTest::compile(options));
 }
+
+TEST(FunctionTest, ReturnFromNestedBlockInRecursion)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn fib(n: int) -> int"
+                   "{"
+                   "if n < 2 { return n; }"
+                   "return fib(n - 1) + fib(n - 2);"
+                   "}"
+                   "var result = fib(15);";
+
+    options.compile = false;
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("result"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("result")), 610);
+        // the scopes of every call are closed again
+        EXPECT_EQ(interpreter.env.envs.size(), 1);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(FunctionTest, ReturnFromNestedLoops)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn find(target: int) -> int"
+                   "{"
+                   "    for var i = 0; i < 10; i += 1 do {"
+                   "        var j = 0;"
+                   "        while j < 10 {"
+                   "            j += 1;"
+                   "            if j == 2 { continue; }"
+                   "            if i * 10 + j == target { return i * 100 + j; }"
+                   "            if j > i { break; }"
+                   "        }"
+                   "    }"
+                   "    return -1;"
+                   "}"
+                   "var found = find(34);"
+                   "var missing = find(42);";
+
+    options.compile = false;
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("found")), 304);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("missing")), -1);
+        EXPECT_EQ(interpreter.env.envs.size(), 1);
+        EXPECT_EQ(interpreter.completion, Completion::NORMAL);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
@@ -4,6 +4,12 @@
 #include "visitors/interpreter.h"
 #include "visitors/semantic_analyzer.h"
 #include "visitors/type_checker.h"
+#include "optimizer.h"
+#include "ir/ir_builder.h"
+#include "ir/ir_optimizer.h"
+#include "vm/bytecode_compiler.h"
+#include "vm/vm.h"
+#include "closure/closure_compiler.h"
 #include "../src/parser.cpp"
 #include "../src/lexer.cpp"
 #include "../src/callable.cpp"
@@ -11,13 +17,13 @@
 
 #include "binaryen-c.h"
 #include "visitors/code_gen.h"
+#include "wasm/wasm_runner.h"
 
 #include <gtest/gtest.h>
 #include <vector>
 #include <functional>
 #include <filesystem>
-#include <unistd.h>
-#include <wait.h>
+#include <sstream>
 
 namespace BirdTest
 {
@@ -28,14 +34,29 @@ namespace BirdTest
         bool parse = true;
         bool type_check = true;
         bool semantic_analyze = true;
+        bool optimize = false;
+        int inline_threshold = Inliner::default_inline_threshold;
+        int step_budget = ConstEvaluator::default_step_budget;
+        int specialize_budget = FunctionSpecializer::default_size_budget;
+        bool ir = false; // compiles through the Bird IR, optimized when optimize is set
         bool interpret = true;
+        bool memoize = false; // memoizes pure functions in the interpreter
+        bool vm = true;       // also runs the bytecode vm and expects the output of the interpreter
+        bool closure = true;  // also runs the closure engine and expects the output of the interpreter
+        bool jit = true;      // also interprets with the functions the JIT supports compiled on their first call and expects the same output
         bool compile = true;
+        unsigned int type_check_threads = 0; // checks function bodies in parallel when set
 
         std::optional<std::function<void(UserErrorTracker &, Lexer &)>> after_lex;
         std::optional<std::function<void(UserErrorTracker &, Parser &, const std::vector<std::unique_ptr<Stmt>> &)>> after_parse;
         std::optional<std::function<void(UserErrorTracker &, SemanticAnalyzer &)>> after_semantic_analyze;
         std::optional<std::function<void(UserErrorTracker &, TypeChecker &)>> after_type_check;
+        std::optional<std::function<void(Optimizer &, std::vector<std::unique_ptr<Stmt>> &)>> after_optimize;
+        std::optional<std::function<void(IrBuilder &, IrOptimizer &)>> after_ir;
         std::optional<std::function<void(Interpreter &)>> after_interpret;
+        std::optional<std::function<void(std::string &, Vm &)>> after_vm;
+        std::optional<std::function<void(std::string &, ClosureRuntime &)>> after_closure;
+        std::optional<std::function<void(std::string &, Interpreter &)>> after_jit;
         std::optional<std::function<void(std::string &, CodeGen &)>> after_compile;
 
         TestOptions() = default;
@@ -88,7 +109,14 @@ namespace BirdTest
         if (options.type_check)
         {
             TypeChecker type_checker(&error_tracker);
-            type_checker.check_types(&ast);
+            if (options.type_check_threads > 0)
+            {
+                type_checker.check_types_parallel(&ast, options.type_check_threads);
+            }
+            else
+            {
+                type_checker.check_types(&ast);
+            }
 
             if (options.after_type_check.has_value())
             {
@@ -102,60 +130,184 @@ namespace BirdTest
             }
         }
 
-        if (options.interpret)
+        if (options.optimize)
         {
-            Interpreter interpreter;
-            interpreter.evaluate(&ast);
+            Optimizer optimizer(options.inline_threshold, options.step_budget, options.specialize_budget);
+            optimizer.optimize(&ast);
 
-            if (options.after_interpret.has_value())
+            if (options.after_optimize.has_value())
             {
-                options.after_interpret.value()(interpreter);
+                options.after_optimize.value()(optimizer, ast);
             }
         }
 
-        if (options.compile)
+        IrBuilder ir_builder;
+        IrOptimizer ir_optimizer;
+        if (options.ir)
         {
-            CodeGen code_gen;
-            code_gen.generate(&ast);
+            if (!ir_builder.build(&ast))
+            {
+                std::cerr << ir_builder.unsupported << std::endl;
+                return false;
+            }
 
-            std::ifstream file(std::string("./output.wasm"));
-            file.close();
+            if (options.optimize)
+            {
+                ir_optimizer.optimize(&ir_builder.module);
+            }
 
-            char *args[] = {(char *)"node", (char *)RUN_WASM_FILE_LOCATION, NULL};
+            if (options.after_ir.has_value())
+            {
+                options.after_ir.value()(ir_builder, ir_optimizer);
+            }
+        }
 
-            pid_t pid = fork();
-            if (pid < 0)
+        if (options.interpret)
+        {
+            Interpreter interpreter;
+            if (options.memoize)
             {
-                std::cerr << "Fork failed" << std::endl;
-                exit(EXIT_FAILURE);
+                EffectAnalyzer effects;
+                effects.analyze_effects(&ast);
+                interpreter.memoize = true;
             }
 
-            if (pid == 0) // child process
+            std::stringstream interpreter_output;
+            auto cout_buffer = std::cout.rdbuf(interpreter_output.rdbuf());
+            try
             {
-                execvp("node", args);
+                interpreter.evaluate(&ast);
             }
-            else // parent process
+            catch (...)
             {
-                wait(NULL);
+                std::cout.rdbuf(cout_buffer);
+                std::cout << interpreter_output.str();
+                throw;
+            }
+            std::cout.rdbuf(cout_buffer);
+            std::cout << interpreter_output.str();
+
+            if (options.after_interpret.has_value())
+            {
+                options.after_interpret.value()(interpreter);
+            }
 
-                std::ifstream output("./output.txt");
-                std::string code;
-                if (output.is_open())
+            // programs the vm does not support only run on the interpreter
+            BytecodeCompiler bytecode_compiler;
+            if (options.vm && bytecode_compiler.compile(&ast))
+            {
+                Vm vm;
+                std::stringstream vm_output;
+                cout_buffer = std::cout.rdbuf(vm_output.rdbuf());
+                try
+                {
+                    vm.run(&bytecode_compiler.program);
+                }
+                catch (...)
                 {
-                    std::string line;
-                    while (output.good())
-                    {
-                        getline(output, line);
-                        code += line += '\n';
-                    }
+                    std::cout.rdbuf(cout_buffer);
+                    throw;
                 }
+                std::cout.rdbuf(cout_buffer);
 
-                if (options.after_compile.has_value())
+                auto output = vm_output.str();
+                EXPECT_EQ(output, interpreter_output.str());
+
+                if (options.after_vm.has_value())
                 {
-                    options.after_compile.value()(code, code_gen);
+                    options.after_vm.value()(output, vm);
                 }
+            }
 
-                output.close();
+            // and so do the programs the closure engine does not support
+            ClosureCompiler closure_compiler;
+            if (options.closure && closure_compiler.compile(&ast))
+            {
+                ClosureRuntime runtime;
+                std::stringstream closure_output;
+                cout_buffer = std::cout.rdbuf(closure_output.rdbuf());
+                try
+                {
+                    runtime.run(&closure_compiler.program);
+                }
+                catch (...)
+                {
+                    std::cout.rdbuf(cout_buffer);
+                    throw;
+                }
+                std::cout.rdbuf(cout_buffer);
+
+                auto output = closure_output.str();
+                EXPECT_EQ(output, interpreter_output.str());
+
+                if (options.after_closure.has_value())
+                {
+                    options.after_closure.value()(output, runtime);
+                }
+            }
+
+            if (options.jit)
+            {
+                Interpreter jit_interpreter;
+                jit_interpreter.memoize = options.memoize;
+                jit_interpreter.jit = true;
+                jit_interpreter.jit_threshold = 0;
+
+                std::stringstream jit_output;
+                cout_buffer = std::cout.rdbuf(jit_output.rdbuf());
+                try
+                {
+                    jit_interpreter.evaluate(&ast);
+                }
+                catch (...)
+                {
+                    std::cout.rdbuf(cout_buffer);
+                    throw;
+                }
+                std::cout.rdbuf(cout_buffer);
+
+                auto output = jit_output.str();
+                EXPECT_EQ(output, interpreter_output.str());
+
+                if (options.after_jit.has_value())
+                {
+                    options.after_jit.value()(output, jit_interpreter);
+                }
+            }
+        }
+
+        if (options.compile)
+        {
+            CodeGen code_gen;
+            code_gen.write_file = false;
+            if (options.ir)
+            {
+                code_gen.generate(&ir_builder.module);
+            }
+            else
+            {
+                code_gen.generate(&ast);
+            }
+
+            // runs in process, a trap ends the output like it ends the program
+            std::stringstream wasm_output;
+            try
+            {
+                WasmRunner runner(code_gen.binary, wasm_output);
+                runner.run();
+            }
+            catch (BirdException &e)
+            {
+                std::cerr << e.what() << std::endl;
+            }
+
+            // every line of the output ends in a newline and an empty line follows the last one
+            auto code = wasm_output.str() + "\n";
+            std::cout << wasm_output.str();
+
+            if (options.after_compile.has_value())
+            {
+                options.after_compile.value()(code, code_gen);
             }
         }
 
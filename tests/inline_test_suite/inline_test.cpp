@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+TEST(InlineTest, InlineSmallFunction)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn square(x: int) -> int { return x * x; }"
+                   "var a = 3;"
+                   "var b = square(a);"
+                   "print b;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.inliner.inlined_calls, 1);
+        EXPECT_EQ(optimizer.dead_code_eliminator.removed_functions, 1);
+
+        ASSERT_EQ(ast.size(), 3);
+        auto decl_stmt = dynamic_cast<DeclStmt *>(ast[1].get());
+        ASSERT_NE(decl_stmt, nullptr);
+        EXPECT_NE(dynamic_cast<Binary *>(decl_stmt->value.get()), nullptr);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("b"));
+        ASSERT_TRUE(is_type<int>(interpreter.env.get("b")));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("b")), 9);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "9\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(InlineTest, InlinedBodyFoldsConstantArguments)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn area(w: float, h: float) -> float { return w * h; }"
+                   "fn double_area(w: float, h: float) -> float { return area(w, h) * 2.0; }"
+                   "var x = double_area(2.0, 3.5);"
+                   "print x;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.inliner.inlined_calls, 2);
+
+        ASSERT_EQ(ast.size(), 2);
+        auto decl_stmt = dynamic_cast<DeclStmt *>(ast[0].get());
+        ASSERT_NE(decl_stmt, nullptr);
+
+        auto value = dynamic_cast<Primary *>(decl_stmt->value.get());
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(value->value.token_type, Token::Type::FLOAT_LITERAL);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        ASSERT_TRUE(is_type<double>(interpreter.env.get("x")));
+        EXPECT_EQ(as_type<double>(interpreter.env.get("x")), 14.0);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "14\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(InlineTest, RecursiveFunctionIsNotInlined)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn fact(n: int) -> int { return n <= 1 ? 1 : n * fact(n - 1); }"
+                   "var x = fact(5);"
+                   "print x;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.inliner.inlined_calls, 0);
+        EXPECT_NE(dynamic_cast<Func *>(ast[0].get()), nullptr);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("x")), 120);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "120\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(InlineTest, ArgumentWithSideEffectsIsNotDuplicated)
+{
+    BirdTest::TestOptions options;
+    options.code = "var calls = 0;"
+                   "fn next() -> int { calls += 1; return calls; }"
+                   "fn twice(x: int) -> int { return x + x; }"
+                   "fn inc(x: int) -> int { return x + 1; }"
+                   "var y = twice(next());"
+                   "var base: int = calls;"
+                   "var z = inc(base * 10);"
+                   "print y;"
+                   "print z;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        // only inc(base * 10), its argument is pure and used once
+        EXPECT_EQ(optimizer.inliner.inlined_calls, 1);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("calls"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("calls")), 1);
+        ASSERT_TRUE(interpreter.env.contains("y"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("y")), 2);
+        ASSERT_TRUE(interpreter.env.contains("z"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("z")), 11);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "2\n11\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(InlineTest, ThresholdLimitsInlining)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn poly(x: int) -> int { return x * x * x + 2 * x * x + 3 * x + 4; }"
+                   "var a = 2;"
+                   "var y = poly(a);"
+                   "print y;";
+    options.optimize = true;
+    options.inline_threshold = 5;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.inliner.inlined_calls, 0);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("y"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("y")), 26);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "26\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+TEST(IrTest, LoopVariablesBecomePhis)
+{
+    BirdTest::TestOptions options;
+    options.code = "var total = 0;"
+                   "for var i = 0; i < 5; i += 1 do { total += i; }"
+                   "print total;";
+    options.ir = true;
+
+    options.after_ir = [&](IrBuilder &builder, IrOptimizer &optimizer)
+    {
+        auto main = builder.module.get("main");
+        ASSERT_NE(main, nullptr);
+
+        // entry, header, body, increment and exit
+        ASSERT_EQ(main->blocks.size(), 5);
+
+        auto &header = main->blocks[1];
+        EXPECT_EQ(header.predecessors.size(), 2);
+        ASSERT_EQ(header.phis.size(), 2);
+        EXPECT_EQ(header.phis[0].type, BirdType::INT);
+        EXPECT_EQ(header.terminator.kind, IrTerminatorKind::BRANCH);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("total"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("total")), 10);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "10\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(IrTest, ConstantBranchFoldsIntoOneBlock)
+{
+    BirdTest::TestOptions options;
+    options.code = "var x = 3;"
+                   "if x > 2 { print 1; } else { print 2; }";
+    options.ir = true;
+    options.optimize = true;
+
+    options.after_ir = [&](IrBuilder &builder, IrOptimizer &optimizer)
+    {
+        EXPECT_EQ(optimizer.folded_branches, 1);
+
+        auto main = builder.module.get("main");
+        ASSERT_EQ(main->blocks.size(), 1);
+
+        // only the print of the taken branch is left
+        auto &instructions = main->blocks[0].instructions;
+        ASSERT_EQ(instructions.size(), 2);
+        EXPECT_EQ(instructions[0].op, IrOp::CONST);
+        EXPECT_EQ(as_type<int>(instructions[0].constant), 1);
+        EXPECT_EQ(instructions[1].op, IrOp::PRINT);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "1\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(IrTest, FunctionsWithTernaryAndRecursion)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn max(a: int, b: int) -> int { return a > b ? a : b; }"
+                   "fn fact(n: int) -> int { if n < 2 { return 1; } return n * fact(n - 1); }"
+                   "var m = max(3, 7);"
+                   "var f = fact(10);"
+                   "print m;"
+                   "print f;";
+    options.ir = true;
+    options.optimize = true;
+    options.inline_threshold = 0;
+
+    options.after_ir = [&](IrBuilder &builder, IrOptimizer &optimizer)
+    {
+        auto max = builder.module.get("max");
+        ASSERT_NE(max, nullptr);
+        EXPECT_EQ(max->params.size(), 2);
+        EXPECT_EQ(max->return_type, BirdType::INT);
+
+        int phis = 0;
+        for (auto &block : max->blocks)
+        {
+            phis += block.phis.size();
+        }
+        EXPECT_EQ(phis, 1);
+
+        EXPECT_NE(builder.module.get("fact"), nullptr);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("m")), 7);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("f")), 3628800);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "7\n3628800\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(IrTest, BreakAndContinue)
+{
+    BirdTest::TestOptions options;
+    options.code = "var i = 0;"
+                   "var sum = 0;"
+                   "while true {"
+                   "    i += 1;"
+                   "    if i > 10 { break; }"
+                   "    if i % 2 == 0 { continue; }"
+                   "    sum += i;"
+                   "}"
+                   "print sum;";
+    options.ir = true;
+    options.optimize = true;
+
+    options.after_ir = [&](IrBuilder &builder, IrOptimizer &optimizer)
+    {
+        // the loop condition is always true, so the loop is only left through the break
+        EXPECT_EQ(optimizer.folded_branches, 1);
+        EXPECT_GT(optimizer.removed_blocks, 0);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("sum")), 25);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "25\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(IrTest, FunctionReadingOuterVariableIsUnsupported)
+{
+    BirdTest::TestOptions options;
+    options.code = "var g = 1;"
+                   "fn f() -> int { return g; }"
+                   "print f();";
+    options.ir = true;
+    options.interpret = false;
+    options.compile = false;
+
+    ASSERT_FALSE(BirdTest::compile(options));
+}
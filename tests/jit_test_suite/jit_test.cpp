@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+std::vector<std::unique_ptr<Stmt>> parse_for_jit(std::string code, UserErrorTracker &error_tracker)
+{
+    Lexer lexer(code, &error_tracker);
+    auto tokens = lexer.lex();
+
+    Parser parser(tokens, &error_tracker);
+    return parser.parse();
+}
+
+TEST(JitTest, RecursiveFunctionsAreCompiled)
+{
+    BirdTest::TestOptions options;
+    options.optimize = false; // keeps the functions the optimizer would inline
+    options.code = "fn fib(n: int) -> int"
+                   "{"
+                   "    if n < 2 { return n; }"
+                   "    return fib(n - 1) + fib(n - 2);"
+                   "}"
+                   "fn is_even(n: int) -> bool { return n % 2 == 0 ? true : false; }"
+                   "print fib(20);"
+                   "print is_even(fib(6));";
+
+    options.after_jit = [&](std::string &output, Interpreter &interpreter)
+    {
+        EXPECT_EQ(output, "6765\n1\n");
+        EXPECT_NE(interpreter.call_table.get_reference("fib").native, nullptr);
+        EXPECT_NE(interpreter.call_table.get_reference("is_even").native, nullptr);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(JitTest, LoopsBreakAndContinue)
+{
+    BirdTest::TestOptions options;
+    options.optimize = false; // keeps the functions the optimizer would inline
+    options.code = "fn sum_odd(limit: int) -> int"
+                   "{"
+                   "    var total = 0;"
+                   "    for var i = 0; i < 100; i += 1 do {"
+                   "        if i % 2 == 0 { continue; }"
+                   "        if i > limit { break; }"
+                   "        var j = 0;"
+                   "        while j < i { j += 1; total += j; }"
+                   "    }"
+                   "    return total;"
+                   "}"
+                   "print sum_odd(9);";
+
+    options.after_jit = [&](std::string &output, Interpreter &interpreter)
+    {
+        EXPECT_EQ(output, "95\n");
+        EXPECT_NE(interpreter.call_table.get_reference("sum_odd").native, nullptr);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(JitTest, UnsupportedFunctionsStayInterpreted)
+{
+    BirdTest::TestOptions options;
+    options.optimize = false; // keeps the functions the optimizer would inline
+    options.code = "var calls = 0;"
+                   "fn count(n: int) -> int { calls += 1; return n; }"
+                   "fn show(n: int) -> int { print n; return n; }"
+                   "fn half(n: float) -> float { return n / 2.0; }"
+                   "print count(1) + show(2), half(3.0), calls;";
+
+    options.after_jit = [&](std::string &output, Interpreter &interpreter)
+    {
+        EXPECT_EQ(output, "2\n31.51\n");
+
+        for (auto name : {"count", "show", "half"})
+        {
+            EXPECT_EQ(interpreter.call_table.get_reference(name).native, nullptr);
+            EXPECT_TRUE(interpreter.call_table.get_reference(name).jit_failed);
+        }
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(JitTest, FunctionsAreCompiledOnceHot)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_for_jit("fn add(a: int, b: int) -> int { return a + b; }"
+                             "var total = 0;"
+                             "for var i = 0; i < 5; i += 1 do { total = add(total, i); }",
+                             error_tracker);
+
+    Interpreter interpreter;
+    interpreter.jit = true;
+    interpreter.jit_threshold = 10;
+    interpreter.evaluate(&ast);
+
+    EXPECT_EQ(interpreter.call_table.get_reference("add").native, nullptr);
+
+    auto more = parse_for_jit("for var i = 0; i < 20; i += 1 do { total = add(total, i); }", error_tracker);
+    interpreter.evaluate(&more);
+
+    EXPECT_NE(interpreter.call_table.get_reference("add").native, nullptr);
+    EXPECT_EQ(as_type<int>(interpreter.env.get("total")), 200);
+}
+
+TEST(JitTest, DivisionByZeroThrows)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_for_jit("fn divide(a: int, b: int) -> int { return a / b; }"
+                             "fn remainder(a: int, b: int) -> int { return divide(a, 1) % b; }"
+                             "print remainder(7, 0);",
+                             error_tracker);
+
+    Interpreter interpreter;
+    interpreter.jit = true;
+    interpreter.jit_threshold = 0;
+
+    try
+    {
+        interpreter.evaluate(&ast);
+        FAIL() << "expected a BirdException";
+    }
+    catch (BirdException &error)
+    {
+        EXPECT_STREQ(error.what(), "Modulo by zero.");
+    }
+
+    EXPECT_NE(interpreter.call_table.get_reference("remainder").native, nullptr);
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+TEST(LicmTest, HoistInvariantArithmetic)
+{
+    BirdTest::TestOptions options;
+    options.code = "var n = 5;"
+                   "var k = 3;"
+                   "var total = 0;"
+                   "var i = 0;"
+                   "while i < n * 2 { total += k * k + 1; i += 1; }"
+                   "print total;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.loop_invariant_code_motion.hoisted_expressions, 2);
+
+        auto block = dynamic_cast<Block *>(ast[4].get());
+        ASSERT_NE(block, nullptr);
+        ASSERT_EQ(block->stmts.size(), 3);
+        EXPECT_NE(dynamic_cast<DeclStmt *>(block->stmts[0].get()), nullptr);
+        EXPECT_NE(dynamic_cast<DeclStmt *>(block->stmts[1].get()), nullptr);
+        EXPECT_NE(dynamic_cast<WhileStmt *>(block->stmts[2].get()), nullptr);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("total"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("total")), 100);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "100\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(LicmTest, HoistPureCallFromCondition)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn limit(x: int) -> int { var y = x * 2; return y; }"
+                   "var m = 4;"
+                   "var i = 0;"
+                   "while i < limit(m) { i += 1; }"
+                   "print i;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.loop_invariant_code_motion.hoisted_expressions, 1);
+        EXPECT_TRUE(optimizer.loop_invariant_code_motion.effects.is_pure("limit"));
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("i"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("i")), 8);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "8\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(LicmTest, MutatedAndImpureExpressionsStay)
+{
+    BirdTest::TestOptions options;
+    options.code = "var calls = 0;"
+                   "fn bump() -> int { calls += 1; return calls; }"
+                   "var scale = 1;"
+                   "fn grow() { scale += 1; }"
+                   "var k = 2;"
+                   "var sum = 0;"
+                   "for var i = 0; i < 3; i += 1 do { k = k + 1; sum += k * 2 + bump(); }"
+                   "var total = 0;"
+                   "var j = 0;"
+                   "while j < 3 { grow(); total += scale * 10; j += 1; }"
+                   "print sum;"
+                   "print total;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.loop_invariant_code_motion.hoisted_expressions, 0);
+        EXPECT_FALSE(optimizer.loop_invariant_code_motion.effects.is_pure("bump"));
+        EXPECT_FALSE(optimizer.loop_invariant_code_motion.effects.is_pure("grow"));
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("sum"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("sum")), 30);
+        ASSERT_TRUE(interpreter.env.contains("total"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("total")), 90);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "30\n90\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(LicmTest, DivisionIsNotHoistedFromBody)
+{
+    BirdTest::TestOptions options;
+    options.code = "var d = 0;"
+                   "var i = 0;"
+                   "while i < 0 { print 10 / d; i += 1; }"
+                   "print i;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.loop_invariant_code_motion.hoisted_expressions, 0);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("i"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("i")), 0);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "0\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+TEST(MemoizeTest, MemoizesPureRecursiveFunction)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn fib(n: int) -> int"
+                   "{"
+                   "if n < 2 { return n; }"
+                   "return fib(n - 1) + fib(n - 2);"
+                   "}"
+                   "var result = fib(20);"
+                   "print result;";
+    options.memoize = true;
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("result"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("result")), 6765);
+
+        ASSERT_EQ(interpreter.memo_caches.size(), 1);
+        EXPECT_EQ(interpreter.memo_caches[0].first, "fib");
+
+        // every argument from 20 down to 0 is computed once, the rest are hits
+        auto memo = interpreter.memo_caches[0].second;
+        EXPECT_EQ(memo->misses, 21);
+        EXPECT_EQ(memo->hits, 18);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "6765\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(MemoizeTest, ImpureFunctionsAreNotMemoized)
+{
+    BirdTest::TestOptions options;
+    options.code = "var g = 1;"
+                   "fn prints(n: int) -> int { print n; return n; }"
+                   "fn reads(n: int) -> int { return n + g; }"
+                   "fn calls(n: int) -> int { return prints(n); }"
+                   "var a = prints(1);"
+                   "var b = reads(2);"
+                   "var c = calls(3);";
+    options.memoize = true;
+    options.compile = false;
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_TRUE(interpreter.memo_caches.empty());
+        EXPECT_EQ(as_type<int>(interpreter.env.get("a")), 1);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("b")), 3);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("c")), 3);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(MemoizeTest, CacheForgetsOldestResult)
+{
+    MemoCache memo(2);
+    std::vector<Value> one = {Value(1)};
+    std::vector<Value> two = {Value(2)};
+    std::vector<Value> three = {Value(3)};
+
+    auto one_key = MemoCache::key(one.data(), one.size());
+    auto two_key = MemoCache::key(two.data(), two.size());
+    auto three_key = MemoCache::key(three.data(), three.size());
+
+    memo.put(one_key, Value(10));
+    memo.put(two_key, Value(20));
+    memo.put(three_key, Value(30));
+
+    EXPECT_FALSE(memo.get(one_key).has_value());
+    ASSERT_TRUE(memo.get(two_key).has_value());
+    EXPECT_EQ(as_type<int>(memo.get(three_key).value()), 30);
+    EXPECT_EQ(memo.hits, 2);
+    EXPECT_EQ(memo.misses, 1);
+
+    std::vector<Value> text = {Value(std::string("text"))};
+    EXPECT_FALSE(MemoCache::is_cacheable(text.data(), text.size()));
+}
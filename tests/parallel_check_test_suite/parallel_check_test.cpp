@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+std::vector<std::tuple<std::string, Token>> type_check_errors(std::string code, unsigned int type_check_threads)
+{
+    std::vector<std::tuple<std::string, Token>> errors;
+
+    BirdTest::TestOptions options;
+    options.code = code;
+    options.type_check_threads = type_check_threads;
+    options.interpret = false;
+    options.compile = false;
+
+    options.after_type_check = [&](UserErrorTracker &error_tracker, TypeChecker &type_checker)
+    {
+        errors = error_tracker.get_errors();
+    };
+
+    BirdTest::compile(options);
+    return errors;
+}
+
+TEST(ParallelCheckTest, ParallelCheckInterpret)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn add(a: int, b: int) -> int { return a + b; }"
+                   "fn twice(a: int) -> int { return add(a, a); }"
+                   "var result: int = twice(add(1, 2));";
+    options.type_check_threads = 4;
+    options.compile = false;
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("result"));
+        ASSERT_TRUE(is_type<int>(interpreter.env.get("result")));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("result")), 6);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ParallelCheckTest, ParallelCheckErrorsMatchSerial)
+{
+    auto code = "var x = 1 + \"a\";"
+                "fn first() -> int { return \"string\"; }"
+                "var y = true + 1;"
+                "fn second(i: int) -> str { var z = i + \"b\"; return z; }"
+                "fn third() -> int { return 3; }"
+                "var w = 2.0 + \"c\";"
+                "fn fourth() { return 4; }";
+
+    auto serial = type_check_errors(code, 0);
+    auto parallel = type_check_errors(code, 4);
+
+    ASSERT_EQ(serial.size(), 7);
+    ASSERT_EQ(parallel.size(), serial.size());
+
+    for (int i = 0; i < serial.size(); i++)
+    {
+        EXPECT_EQ(std::get<0>(parallel[i]), std::get<0>(serial[i]));
+    }
+}
+
+TEST(ParallelCheckTest, ParallelCheckManyFunctions)
+{
+    std::string code;
+    for (int i = 0; i < 500; i++)
+    {
+        auto name = "f" + std::to_string(i);
+        code += "fn " + name + "(a: int) -> int { var b = a * 2; return b + " + std::to_string(i) + "; }";
+
+        if (i % 50 == 0)
+        {
+            code += "fn g" + std::to_string(i) + "() -> bool { return " + std::to_string(i) + "; }";
+        }
+    }
+
+    auto serial = type_check_errors(code, 0);
+    auto parallel = type_check_errors(code, 8);
+
+    ASSERT_EQ(serial.size(), 10);
+    ASSERT_EQ(parallel.size(), serial.size());
+
+    for (int i = 0; i < serial.size(); i++)
+    {
+        EXPECT_EQ(std::get<0>(parallel[i]), std::get<0>(serial[i]));
+    }
+}
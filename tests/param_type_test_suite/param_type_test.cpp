@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+std::vector<std::unique_ptr<Stmt>> parse_code(std::string code, UserErrorTracker &error_tracker)
+{
+    Lexer lexer(code, &error_tracker);
+    auto tokens = lexer.lex();
+
+    Parser parser(tokens, &error_tracker);
+    return parser.parse();
+}
+
+Call *call_at(std::vector<std::unique_ptr<Stmt>> &ast, int index)
+{
+    return dynamic_cast<Call *>(dynamic_cast<ExprStmt *>(ast[index].get())->expr.get());
+}
+
+TEST(ParamTypeTest, ExactArgumentsAreMarkedChecked)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_code("type number = float;"
+                          "fn scale(a: int, b: number) -> float { return b; }"
+                          "scale(1, 2.0);"
+                          "scale(1, 2);",
+                          error_tracker);
+
+    TypeChecker type_checker(&error_tracker);
+    type_checker.check_types(&ast);
+    ASSERT_FALSE(error_tracker.has_errors());
+
+    EXPECT_TRUE(call_at(ast, 2)->arguments_checked);
+    EXPECT_FALSE(call_at(ast, 3)->arguments_checked); // the int is converted to a float
+}
+
+TEST(ParamTypeTest, AliasParametersAreCheckedAtRuntime)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_code("type number = float;"
+                          "fn half(n: number) -> float { return n / 2.0; }"
+                          "half(\"two\");",
+                          error_tracker);
+
+    Interpreter interpreter;
+    EXPECT_THROW(interpreter.evaluate(&ast), BirdException);
+}
+
+TEST(ParamTypeTest, CheckedCallsRunThroughTheInterpreter)
+{
+    BirdTest::TestOptions options;
+    options.code = "type number = float;"
+                   "fn half(n: number) -> float { return n / 2.0; }"
+                   "var x = half(3.0);"
+                   "print x;";
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("x"));
+        EXPECT_EQ(as_type<double>(interpreter.env.get("x")), 1.5);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "1.5\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
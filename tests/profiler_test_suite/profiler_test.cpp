@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+void profile(std::string code, Profiler &profiler)
+{
+    UserErrorTracker error_tracker(code);
+    Lexer lexer(code, &error_tracker);
+    auto tokens = lexer.lex();
+
+    Parser parser(tokens, &error_tracker);
+    auto ast = parser.parse();
+
+    Interpreter interpreter;
+    interpreter.profiler = &profiler;
+
+    std::stringstream output;
+    auto cout_buffer = std::cout.rdbuf(output.rdbuf());
+    try
+    {
+        interpreter.evaluate(&ast);
+    }
+    catch (BirdException &)
+    {
+    }
+    std::cout.rdbuf(cout_buffer);
+
+    profiler.finish();
+}
+
+TEST(ProfilerTest, CountsCallsAndLines)
+{
+    Profiler profiler;
+    profile("fn fib(n: int) -> int\n"
+            "{\n"
+            "    if n < 2 {\n"
+            "        return n;\n"
+            "    }\n"
+            "    return fib(n - 1) + fib(n - 2);\n"
+            "}\n"
+            "var i = 0;\n"
+            "while i < 3 { i += 1; }\n"
+            "print fib(10);\n",
+            profiler);
+
+    EXPECT_EQ(profiler.functions["fib"].calls, 177);
+    EXPECT_EQ(profiler.functions["<main>"].calls, 1);
+
+    EXPECT_EQ(profiler.lines[1], 1);
+    EXPECT_EQ(profiler.lines[3], 177);
+    EXPECT_EQ(profiler.lines[4], 89);
+    EXPECT_EQ(profiler.lines[6], 88);
+    EXPECT_EQ(profiler.lines[9], 4); // the while and the three iterations of its body
+    EXPECT_EQ(profiler.lines[10], 1);
+}
+
+TEST(ProfilerTest, RecursionAddsToTheInclusiveTimeOnce)
+{
+    Profiler profiler;
+    profile("fn fib(n: int) -> int { if n < 2 { return n; } return fib(n - 1) + fib(n - 2); }"
+            "fn work() -> int { return fib(15); }"
+            "print work();",
+            profiler);
+
+    auto &main = profiler.functions["<main>"];
+    auto &work = profiler.functions["work"];
+    auto &fib = profiler.functions["fib"];
+
+    EXPECT_LE(fib.inclusive, work.inclusive);
+    EXPECT_LE(work.inclusive, main.inclusive);
+    EXPECT_EQ(fib.inclusive, fib.exclusive);
+    EXPECT_EQ(main.exclusive + work.exclusive + fib.exclusive, main.inclusive);
+}
+
+TEST(ProfilerTest, CollapsedStacksSumTheExclusiveTimes)
+{
+    Profiler profiler;
+    profile("fn leaf() -> int { return 1; }"
+            "fn branch() -> int { return leaf() + leaf(); }"
+            "print branch();"
+            "print leaf();",
+            profiler);
+
+    EXPECT_EQ(profiler.stacks.size(), 4);
+    EXPECT_EQ(profiler.stacks.count("<main>;branch;leaf"), 1);
+    EXPECT_EQ(profiler.stacks.count("<main>;leaf"), 1);
+
+    Profiler::Clock::duration total = Profiler::Clock::duration::zero();
+    for (auto &[stack, duration] : profiler.stacks)
+    {
+        total += duration;
+    }
+    EXPECT_EQ(total, profiler.functions["<main>"].inclusive);
+
+    std::stringstream collapsed;
+    profiler.write_collapsed(collapsed);
+
+    std::string line;
+    int lines = 0;
+    while (std::getline(collapsed, line))
+    {
+        EXPECT_NE(line.rfind(' '), std::string::npos);
+        lines++;
+    }
+    EXPECT_EQ(lines, 4);
+}
+
+TEST(ProfilerTest, ErrorsEndTheOpenCalls)
+{
+    Profiler profiler;
+    profile("fn divide(n: int) -> int { return n / 0; }"
+            "fn outer() -> int { return divide(1); }"
+            "print outer();",
+            profiler);
+
+    EXPECT_TRUE(profiler.frames.empty());
+    EXPECT_EQ(profiler.functions["divide"].calls, 1);
+    EXPECT_EQ(profiler.stacks.count("<main>;outer;divide"), 1);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+std::vector<std::unique_ptr<Stmt>> parse_code(std::string code, UserErrorTracker &error_tracker)
+{
+    Lexer lexer(code, &error_tracker);
+    auto tokens = lexer.lex();
+
+    Parser parser(tokens, &error_tracker);
+    return parser.parse();
+}
+
+Expr *value_at(std::vector<std::unique_ptr<Stmt>> &ast, int index)
+{
+    return dynamic_cast<DeclStmt *>(ast[index].get())->value.get();
+}
+
+TEST(QuickeningTest, NodesSpecializeToTheirFirstOperands)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_code("var a = 1 + 2;"
+                          "var b = 1.5 * 2.0;"
+                          "var c = \"bi\" + \"rd\";"
+                          "var d = 1 + 2.5;"
+                          "var e = -a;"
+                          "var f = -b;",
+                          error_tracker);
+
+    Interpreter interpreter;
+    interpreter.evaluate(&ast);
+
+    EXPECT_EQ(dynamic_cast<Binary *>(value_at(ast, 0))->quickened, Quickened::INT);
+    EXPECT_EQ(dynamic_cast<Binary *>(value_at(ast, 1))->quickened, Quickened::FLOAT);
+    EXPECT_EQ(dynamic_cast<Binary *>(value_at(ast, 2))->quickened, Quickened::GENERIC);
+    EXPECT_EQ(dynamic_cast<Binary *>(value_at(ast, 3))->quickened, Quickened::GENERIC);
+    EXPECT_EQ(dynamic_cast<Unary *>(value_at(ast, 4))->quickened, Quickened::INT);
+    EXPECT_EQ(dynamic_cast<Unary *>(value_at(ast, 5))->quickened, Quickened::FLOAT);
+
+    EXPECT_EQ(as_type<int>(interpreter.env.get("a")), 3);
+    EXPECT_EQ(as_type<double>(interpreter.env.get("b")), 3.0);
+    EXPECT_EQ(as_type<std::string>(interpreter.env.get("c")), "bird");
+    EXPECT_EQ(as_type<double>(interpreter.env.get("d")), 3.5);
+    EXPECT_EQ(as_type<int>(interpreter.env.get("e")), -3);
+    EXPECT_EQ(as_type<double>(interpreter.env.get("f")), -3.0);
+}
+
+TEST(QuickeningTest, FailedGuardFallsBackToGenericOperators)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_code("var x = 2;"
+                          "fn twice() -> int { return x * 2; }"
+                          "var first = twice();"
+                          "x = 1.5;"
+                          "var second = twice();",
+                          error_tracker);
+
+    Interpreter interpreter;
+    interpreter.evaluate(&ast);
+
+    EXPECT_EQ(as_type<int>(interpreter.env.get("first")), 4);
+    EXPECT_EQ(as_type<double>(interpreter.env.get("second")), 3.0);
+
+    auto body = dynamic_cast<Block *>(dynamic_cast<Func *>(ast[1].get())->block.get());
+    auto product = dynamic_cast<Binary *>(dynamic_cast<ReturnStmt *>(body->stmts[0].get())->expr.value().get());
+    EXPECT_EQ(product->quickened, Quickened::GENERIC);
+}
+
+TEST(QuickeningTest, QuickenedDivisionChecksForZero)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_code("var divisor = 1;"
+                          "fn divide() -> int { return 4 / divisor; }"
+                          "var first = divide();"
+                          "divisor = 0;"
+                          "var second = divide();",
+                          error_tracker);
+
+    Interpreter interpreter;
+    EXPECT_THROW(interpreter.evaluate(&ast), BirdException);
+    EXPECT_EQ(as_type<int>(interpreter.env.get("first")), 4);
+}
+
+TEST(QuickeningTest, CompoundAssignmentsSpecialize)
+{
+    BirdTest::TestOptions options;
+    options.code = "var total = 0;"
+                   "var scale = 1.0;"
+                   "for var i = 0; i < 4; i += 1 do"
+                   "{"
+                   "    total += i;"
+                   "    scale *= 2.0;"
+                   "}"
+                   "print total, scale;";
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("total"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("total")), 6);
+        EXPECT_EQ(as_type<double>(interpreter.env.get("scale")), 16.0);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+class DivisionCollector : public AstWalker
+{
+public:
+    std::vector<Binary *> divisions;
+
+    void visit_binary(Binary *binary)
+    {
+        AstWalker::visit_binary(binary);
+
+        if (binary->op.token_type == Token::Type::SLASH || binary->op.token_type == Token::Type::PERCENT)
+        {
+            this->divisions.push_back(binary);
+        }
+    }
+};
+
+TEST(RangeAnalysisTest, LoopDivisorsAreNonzero)
+{
+    BirdTest::TestOptions options;
+    options.code = "var total = 0;"
+                   "for var i = 0; i < 10; i += 1 do {"
+                   "    total += 100 / (i + 1) + i % 4;"
+                   "}"
+                   "print total;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.range_analyzer.nonzero_divisors, 2);
+
+        DivisionCollector collector;
+        collector.walk(&ast);
+        ASSERT_EQ(collector.divisions.size(), 2);
+        for (auto division : collector.divisions)
+        {
+            EXPECT_TRUE(division->int_operands);
+            EXPECT_TRUE(division->nonzero_divisor);
+            EXPECT_TRUE(division->non_negative_operands);
+        }
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("total")), 304);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "304\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(RangeAnalysisTest, DivisorThatCanBeZeroIsChecked)
+{
+    BirdTest::TestOptions options;
+    options.code = "var total = 0;"
+                   "for var i = 0; i < 10; i += 1 do {"
+                   "    if i != 3 { total += 60 / (i - 3); }"
+                   "}"
+                   "print total;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.range_analyzer.nonzero_divisors, 0);
+
+        DivisionCollector collector;
+        collector.walk(&ast);
+        ASSERT_EQ(collector.divisions.size(), 1);
+        EXPECT_TRUE(collector.divisions[0]->int_operands);
+        EXPECT_FALSE(collector.divisions[0]->nonzero_divisor);
+        EXPECT_FALSE(collector.divisions[0]->non_negative_operands);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("total")), 37);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "37\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(RangeAnalysisTest, CallsForgetAssignedVariables)
+{
+    BirdTest::TestOptions options;
+    options.code = "var d = 4;"
+                   "fn reset() { d = 0; }"
+                   "var a = 100 / d;"
+                   "reset();"
+                   "var b = 100 / d;"
+                   "print a;"
+                   "print b;";
+    options.optimize = true;
+    options.interpret = false;
+    options.compile = false;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.range_analyzer.nonzero_divisors, 1);
+
+        DivisionCollector collector;
+        collector.walk(&ast);
+        ASSERT_EQ(collector.divisions.size(), 2);
+        EXPECT_TRUE(collector.divisions[0]->nonzero_divisor);
+        EXPECT_FALSE(collector.divisions[1]->nonzero_divisor);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(RangeAnalysisTest, FloatOperandsAreNotInts)
+{
+    BirdTest::TestOptions options;
+    options.code = "var x = 3.0;"
+                   "for var i = 1; i < 4; i += 1 do {"
+                   "    x = x / 2.0 + i;"
+                   "}"
+                   "print x;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        DivisionCollector collector;
+        collector.walk(&ast);
+        ASSERT_EQ(collector.divisions.size(), 1);
+        EXPECT_FALSE(collector.divisions[0]->int_operands);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<double>(interpreter.env.get("x")), 4.625);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
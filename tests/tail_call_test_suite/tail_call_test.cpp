@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+TEST(TailCallTest, DeepTailRecursionBecomesLoop)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn count(n: int, total: int) -> int"
+                   "{"
+                   "if n == 0 { return total; }"
+                   "return count(n - 1, total + 1);"
+                   "}"
+                   "var result = count(100000, 0);"
+                   "print result;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.tail_call_eliminator.eliminated_calls, 1);
+        EXPECT_EQ(optimizer.tail_call_eliminator.transformed_functions, 1);
+
+        auto func = dynamic_cast<Func *>(ast[0].get());
+        ASSERT_NE(func, nullptr);
+        auto &stmts = dynamic_cast<Block *>(func->block.get())->stmts;
+        ASSERT_EQ(stmts.size(), 1);
+        EXPECT_NE(dynamic_cast<WhileStmt *>(stmts[0].get()), nullptr);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        ASSERT_TRUE(interpreter.env.contains("result"));
+        EXPECT_EQ(as_type<int>(interpreter.env.get("result")), 100000);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "100000\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(TailCallTest, ArgumentsReadTheOldParameters)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn gcd(a: int, b: int) -> int"
+                   "{"
+                   "if b == 0 { return a; }"
+                   "return gcd(b, a % b);"
+                   "}"
+                   "var result = gcd(1071, 462);"
+                   "print result;";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.tail_call_eliminator.eliminated_calls, 1);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("result")), 21);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "21\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(TailCallTest, TrailingCallInVoidFunction)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn countdown(n: int)"
+                   "{"
+                   "if n == 0 { return; }"
+                   "print n;"
+                   "countdown(n - 1);"
+                   "}"
+                   "countdown(3);";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.tail_call_eliminator.eliminated_calls, 1);
+    };
+
+    options.after_compile = [&](std::string &output, CodeGen &codegen)
+    {
+        ASSERT_EQ(output, "3\n2\n1\n\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(TailCallTest, CallsOutsideTailPositionAreKept)
+{
+    BirdTest::TestOptions options;
+    options.code = "fn fib(n: int) -> int"
+                   "{"
+                   "if n < 2 { return n; }"
+                   "return fib(n - 1) + fib(n - 2);"
+                   "}"
+                   "fn find(n: int) -> int"
+                   "{"
+                   "while n > 10 { return find(n - 1); }"
+                   "return n;"
+                   "}"
+                   "var a = fib(10);"
+                   "var b = find(15);";
+    options.optimize = true;
+
+    options.after_optimize = [&](Optimizer &optimizer, std::vector<std::unique_ptr<Stmt>> &ast)
+    {
+        EXPECT_EQ(optimizer.tail_call_eliminator.eliminated_calls, 0);
+    };
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<int>(interpreter.env.get("a")), 55);
+        EXPECT_EQ(as_type<int>(interpreter.env.get("b")), 10);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
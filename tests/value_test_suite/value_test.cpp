@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+TEST(ValueTest, ValuesAreOneWord)
+{
+    EXPECT_EQ(sizeof(Value), 8);
+}
+
+TEST(ValueTest, ValuesKeepTheirType)
+{
+    Value negative(-42);
+    EXPECT_TRUE(is_type<int>(negative));
+    EXPECT_EQ(as_type<int>(negative), -42);
+
+    Value zero(-0.0);
+    EXPECT_TRUE(is_type<double>(zero));
+    EXPECT_TRUE(std::signbit(as_type<double>(zero)));
+
+    Value nan(std::nan(""));
+    EXPECT_TRUE(is_type<double>(nan));
+    EXPECT_TRUE(std::isnan(as_type<double>(nan)));
+
+    Value infinity(-INFINITY);
+    EXPECT_TRUE(is_type<double>(infinity));
+    EXPECT_EQ(as_type<double>(infinity), -INFINITY);
+
+    Value truth(true);
+    EXPECT_TRUE(is_type<bool>(truth));
+    EXPECT_TRUE(as_type<bool>(truth));
+
+    Value text("bird");
+    EXPECT_TRUE(is_type<std::string>(text));
+    EXPECT_EQ(as_type<std::string>(text), "bird");
+
+    EXPECT_THROW(as_type<int>(text), std::bad_variant_access);
+}
+
+TEST(ValueTest, CopiesShareTheirStrings)
+{
+    Value original("bird");
+    Value copy = original;
+    EXPECT_EQ(copy.bits, original.bits);
+
+    original = Value(1);
+    EXPECT_EQ(as_type<std::string>(copy), "bird");
+    EXPECT_EQ(as_type<int>(original), 1);
+
+    Value moved = std::move(copy);
+    EXPECT_EQ(as_type<std::string>(moved), "bird");
+}
+
+TEST(ValueTest, LiteralsAreInterned)
+{
+    Value first = Value::intern("sparrow");
+    Value second = Value::intern("sparrow");
+    EXPECT_EQ(first.bits, second.bits);
+
+    EXPECT_TRUE(as_type<bool>(first == second));
+    EXPECT_FALSE(as_type<bool>(first == Value::intern("swallow")));
+    EXPECT_TRUE(as_type<bool>(first == Value("spar") + Value("row")));
+    EXPECT_TRUE(as_type<bool>(first != Value("sparrows")));
+}
+
+TEST(ValueTest, InterpreterSharesStringLiterals)
+{
+    BirdTest::TestOptions options;
+    options.code = "var a = \"robin\";"
+                   "var b = \"robin\";"
+                   "var c = a + \"\";"
+                   "print a == b, b == c;";
+    options.compile = false;
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(interpreter.env.get("a").bits, interpreter.env.get("b").bits);
+        EXPECT_NE(interpreter.env.get("a").bits, interpreter.env.get("c").bits);
+    };
+
+    options.after_vm = [&](std::string &output, Vm &vm)
+    {
+        EXPECT_EQ(output, "11\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(ValueTest, OperatorsMixIntsAndFloats)
+{
+    EXPECT_EQ(as_type<int>(Value(7) / Value(2)), 3);
+    EXPECT_EQ(as_type<double>(Value(7) / Value(2.0)), 3.5);
+    EXPECT_EQ(as_type<std::string>(Value("bi") + Value("rd")), "bird");
+    EXPECT_TRUE(as_type<bool>(Value(2) == Value(2.0)));
+    EXPECT_THROW(Value(1) / Value(0), BirdException);
+}
+
+TEST(ValueTest, AppendGrowsUnsharedStringsInPlace)
+{
+    Value text("bi");
+    auto bits = text.bits;
+    text.append(Value("rd"));
+    EXPECT_EQ(text.bits, bits);
+    EXPECT_EQ(as_type<std::string>(text), "bird");
+
+    Value copy = text;
+    text.append(Value("s"));
+    EXPECT_NE(text.bits, copy.bits);
+    EXPECT_EQ(as_type<std::string>(text), "birds");
+    EXPECT_EQ(as_type<std::string>(copy), "bird");
+
+    Value literal = Value::intern("bird");
+    literal.append(Value("s"));
+    EXPECT_EQ(as_type<std::string>(literal), "birds");
+    EXPECT_EQ(as_type<std::string>(Value::intern("bird")), "bird");
+}
+
+TEST(ValueTest, ConcatenationLoopsKeepAliasesIntact)
+{
+    BirdTest::TestOptions options;
+    options.code = "var text = \"\";"
+                   "var snapshot = \"\";"
+                   "for var i = 0; i < 5; i += 1 do {"
+                   "    text += \"ab\";"
+                   "    if i == 2 { snapshot = text; }"
+                   "}"
+                   "fn grow() { text += \"!\"; }"
+                   "grow();"
+                   "print text, \" \", snapshot;";
+    options.compile = false;
+
+    options.after_interpret = [&](Interpreter &interpreter)
+    {
+        EXPECT_EQ(as_type<std::string>(interpreter.env.get("text")), "ababababab!");
+        EXPECT_EQ(as_type<std::string>(interpreter.env.get("snapshot")), "ababab");
+    };
+
+    options.after_vm = [&](std::string &output, Vm &vm)
+    {
+        EXPECT_EQ(output, "ababababab! ababab\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+std::vector<std::unique_ptr<Stmt>> parse_for_vm(std::string code, UserErrorTracker &error_tracker)
+{
+    Lexer lexer(code, &error_tracker);
+    auto tokens = lexer.lex();
+
+    Parser parser(tokens, &error_tracker);
+    return parser.parse();
+}
+
+TEST(VmTest, FunctionsReadAndWriteGlobals)
+{
+    BirdTest::TestOptions options;
+    options.code = "var calls = 0;"
+                   "fn fib(n: int) -> int"
+                   "{"
+                   "    calls += 1;"
+                   "    if n < 2 { return n; }"
+                   "    return fib(n - 1) + fib(n - 2);"
+                   "}"
+                   "print fib(15);"
+                   "print calls;";
+
+    options.after_vm = [&](std::string &output, Vm &vm)
+    {
+        EXPECT_EQ(output, "610\n1973\n");
+        EXPECT_EQ(as_type<int>(vm.registers[0]), 1973);
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(VmTest, LoopsBreakAndContinue)
+{
+    BirdTest::TestOptions options;
+    options.code = "var total = 0;"
+                   "for var i = 0; i < 100; i += 1 do {"
+                   "    if i % 2 == 0 { continue; }"
+                   "    if i > 9 { break; }"
+                   "    var j = 0;"
+                   "    while j < i { j += 1; total += j; }"
+                   "}"
+                   "print total;";
+
+    options.after_vm = [&](std::string &output, Vm &vm)
+    {
+        EXPECT_EQ(output, "95\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(VmTest, TypedDeclarationsConvert)
+{
+    BirdTest::TestOptions options;
+    options.code = "type number = float;"
+                   "var x: number = 3;"
+                   "var y: float = 2;"
+                   "fn half(n: float) -> float { return n / 2.0; }"
+                   "print x, y, half(x);";
+
+    options.after_vm = [&](std::string &output, Vm &vm)
+    {
+        EXPECT_EQ(output, "321.5\n");
+    };
+
+    ASSERT_TRUE(BirdTest::compile(options));
+}
+
+TEST(VmTest, ArgumentOfTheWrongTypeThrows)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_for_vm("fn twice(n: int) -> int { return n * 2; }"
+                            "print twice(1.5);",
+                            error_tracker);
+
+    BytecodeCompiler compiler;
+    ASSERT_TRUE(compiler.compile(&ast));
+
+    Vm vm;
+    EXPECT_THROW(vm.run(&compiler.program), BirdException);
+}
+
+TEST(VmTest, OuterFunctionVariablesAreUnsupported)
+{
+    UserErrorTracker error_tracker("");
+    auto ast = parse_for_vm("fn outer() -> int"
+                            "{"
+                            "    var x = 1;"
+                            "    fn inner() -> int { return x; }"
+                            "    return inner();"
+                            "}"
+                            "print outer();",
+                            error_tracker);
+
+    BytecodeCompiler compiler;
+    EXPECT_FALSE(compiler.compile(&ast));
+    EXPECT_EQ(compiler.unsupported, "inner uses x of the function it is nested in");
+}
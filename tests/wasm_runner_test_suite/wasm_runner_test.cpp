@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include "helpers/compile_helper.hpp"
+
+// hand assembled modules, so the runner is tested apart from CodeGen
+
+std::vector<uint8_t> unsigned_leb(uint32_t value)
+{
+    std::vector<uint8_t> bytes;
+    do
+    {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        bytes.push_back(value ? byte | 0x80 : byte);
+    } while (value);
+
+    return bytes;
+}
+
+std::vector<uint8_t> signed_leb(int32_t value)
+{
+    std::vector<uint8_t> bytes;
+    while (true)
+    {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40)))
+        {
+            bytes.push_back(byte);
+            return bytes;
+        }
+
+        bytes.push_back(byte | 0x80);
+    }
+}
+
+std::vector<uint8_t> f64_bytes(double value)
+{
+    std::vector<uint8_t> bytes(8);
+    std::memcpy(bytes.data(), &value, 8);
+    return bytes;
+}
+
+std::vector<uint8_t> name(std::string text)
+{
+    auto bytes = unsigned_leb(text.size());
+    bytes.insert(bytes.end(), text.begin(), text.end());
+    return bytes;
+}
+
+void append(std::vector<uint8_t> &bytes, std::vector<uint8_t> more)
+{
+    bytes.insert(bytes.end(), more.begin(), more.end());
+}
+
+std::vector<uint8_t> section(uint8_t id, std::vector<uint8_t> contents)
+{
+    std::vector<uint8_t> bytes = {id};
+    append(bytes, unsigned_leb(contents.size()));
+    append(bytes, contents);
+    return bytes;
+}
+
+/*
+ * A module with the three print imports (functions 0 to 2), one page of memory
+ * holding "bird" at 16, an exported main (function 3) and fib (function 4)
+ */
+std::vector<uint8_t> module(std::vector<uint8_t> main_body)
+{
+    std::vector<uint8_t> binary = {0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+    append(binary, section(1, {4, 0x60, 1, 0x7F, 0, 0x60, 1, 0x7C, 0, 0x60, 0, 0, 0x60, 1, 0x7F, 1, 0x7F}));
+
+    std::vector<uint8_t> imports = {3};
+    for (auto [field, type] : std::vector<std::pair<std::string, uint8_t>>{{"print_i32", 0}, {"print_f64", 1}, {"print_str", 0}})
+    {
+        append(imports, name("env"));
+        append(imports, name(field));
+        append(imports, {0, type});
+    }
+    append(binary, section(2, imports));
+
+    append(binary, section(3, {2, 2, 3}));
+    append(binary, section(5, {1, 0, 1}));
+
+    std::vector<uint8_t> exports = {1};
+    append(exports, name("main"));
+    append(exports, {0, 3});
+    append(binary, section(7, exports));
+
+    // fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2)
+    std::vector<uint8_t> fib = {0, 0x20, 0, 0x41, 2, 0x48, 0x04, 0x7F, 0x20, 0, 0x05,
+                                0x20, 0, 0x41, 1, 0x6B, 0x10, 4, 0x20, 0, 0x41, 2, 0x6B, 0x10, 4, 0x6A, 0x0B, 0x0B};
+
+    std::vector<uint8_t> code = {2};
+    append(code, unsigned_leb(main_body.size()));
+    append(code, main_body);
+    append(code, unsigned_leb(fib.size()));
+    append(code, fib);
+    append(binary, section(10, code));
+
+    std::vector<uint8_t> data = {1, 0, 0x41, 16, 0x0B};
+    append(data, name(std::string("bird\0", 5)));
+    append(binary, section(11, data));
+
+    return binary;
+}
+
+std::string run(std::vector<uint8_t> main_body)
+{
+    std::stringstream output;
+    WasmRunner runner(module(main_body), output);
+    runner.run();
+
+    return output.str();
+}
+
+TEST(WasmRunnerTest, PrintsLikeConsoleLog)
+{
+    std::vector<uint8_t> body = {0};
+    append(body, {0x41});
+    append(body, signed_leb(-5));
+    append(body, {0x10, 0});
+    append(body, {0x41, 16, 0x10, 2});
+    append(body, {0x44});
+    append(body, f64_bytes(0.1));
+    append(body, {0x44});
+    append(body, f64_bytes(0.2));
+    append(body, {0xA0, 0x10, 1});
+    append(body, {0x41, 3, 0xB7, 0x10, 1});
+    append(body, {0x0B});
+
+    EXPECT_EQ(run(body), "-5\nbird\n0.30000000000000004\n3\n");
+}
+
+TEST(WasmRunnerTest, CallsAndLoops)
+{
+    // locals i and total, total += i while i counts to 10 and breaks out of the block
+    std::vector<uint8_t> body = {1, 2, 0x7F};
+    append(body, {0x41, 20, 0x10, 4, 0x10, 0});
+    append(body, {0x02, 0x40, 0x03, 0x40,
+                  0x20, 0, 0x41, 10, 0x4E, 0x0D, 1,
+                  0x20, 0, 0x41, 1, 0x6A, 0x22, 0, 0x20, 1, 0x6A, 0x21, 1,
+                  0x0C, 0, 0x0B, 0x0B});
+    append(body, {0x20, 1, 0x10, 0, 0x0B});
+
+    EXPECT_EQ(run(body), "6765\n55\n");
+}
+
+TEST(WasmRunnerTest, MemoryLoadsWhatWasStored)
+{
+    std::vector<uint8_t> body = {0};
+    append(body, {0x41, 32, 0x41});
+    append(body, signed_leb(-12345));
+    append(body, {0x36, 2, 0});
+    append(body, {0x41, 28, 0x28, 2, 4, 0x10, 0});
+    append(body, {0x41, 16, 0x41});
+    append(body, signed_leb('A'));
+    append(body, {0x3A, 0, 0});
+    append(body, {0x41, 16, 0x10, 2, 0x0B});
+
+    EXPECT_EQ(run(body), "-12345\nAird\n");
+}
+
+TEST(WasmRunnerTest, TrapsThrowAfterTheOutputSoFar)
+{
+    std::vector<uint8_t> body = {0};
+    append(body, {0x41, 1, 0x10, 0});
+    append(body, {0x41, 7, 0x41, 0, 0x6D, 0x10, 0, 0x0B});
+
+    std::stringstream output;
+    WasmRunner runner(module(body), output);
+
+    try
+    {
+        runner.run();
+        FAIL() << "expected a trap";
+    }
+    catch (BirdException &error)
+    {
+        EXPECT_STREQ(error.what(), "wasm trap: integer divide by zero");
+    }
+
+    EXPECT_EQ(output.str(), "1\n");
+}
+
+TEST(WasmRunnerTest, FormatsFloatsLikeJavaScript)
+{
+    EXPECT_EQ(WasmRunner::number_to_string(42.42), "42.42");
+    EXPECT_EQ(WasmRunner::number_to_string(-0.5), "-0.5");
+    EXPECT_EQ(WasmRunner::number_to_string(100), "100");
+    EXPECT_EQ(WasmRunner::number_to_string(1e21), "1e+21");
+    EXPECT_EQ(WasmRunner::number_to_string(1.5e-7), "1.5e-7");
+    EXPECT_EQ(WasmRunner::number_to_string(0.000001), "0.000001");
+    EXPECT_EQ(WasmRunner::number_to_string(1.0 / 0.0), "Infinity");
+}